@@ -28,6 +28,21 @@ std::vector<art::Ptr<recob::SpacePoint>> DUNEAnaHitUtils::GetSpacePoints(const a
     return DUNEAnaHitUtils::GetAssocProductVector<recob::SpacePoint>(pHit,evt,hitLabel,hitToSpacePointLabel);
 }
 
+std::vector<std::vector<art::Ptr<recob::SpacePoint>>> DUNEAnaHitUtils::GetSpacePoints(const std::vector<art::Ptr<recob::Hit>> &hits,
+    const art::Event &evt, const std::string &hitToSpacePointLabel)
+{
+    std::vector<std::vector<art::Ptr<recob::SpacePoint>>> spacePoints(hits.size());
+    if (hits.empty())
+        return spacePoints;
+
+    const art::FindManyP<recob::SpacePoint> findSpacePoints(hits, evt, hitToSpacePointLabel);
+
+    for (unsigned int iHit = 0; iHit < hits.size(); ++iHit)
+        spacePoints[iHit] = findSpacePoints.at(iHit);
+
+    return spacePoints;
+}
+
 std::vector<art::Ptr<recob::Hit>> DUNEAnaHitUtils::GetHitsOnPlane(const std::vector<art::Ptr<recob::Hit>> &hits, 
     const geo::PlaneID::PlaneID_t planeID)
 {
@@ -62,6 +77,17 @@ double DUNEAnaHitUtils::LifetimeCorrection(detinfo::DetectorClocksData const& cl
     return std::exp(timeCorrectedForT0/tauLifetime);
 }
 
+std::vector<double> DUNEAnaHitUtils::LifetimeCorrections(detinfo::DetectorClocksData const& clockData,
+                                                         detinfo::DetectorPropertiesData const& detProp,
+                                                         const unsigned int nTicks, const double t0InMicroS)
+{
+    std::vector<double> corrections(nTicks);
+    for (unsigned int iTick = 0; iTick < nTicks; ++iTick)
+        corrections[iTick] = DUNEAnaHitUtils::LifetimeCorrection(clockData, detProp, iTick, t0InMicroS);
+
+    return corrections;
+}
+
 double DUNEAnaHitUtils::LifetimeCorrectedTotalHitCharge(detinfo::DetectorClocksData const& clockData,
                                                         detinfo::DetectorPropertiesData const& detProp,
                                                         const std::vector<art::Ptr<recob::Hit> > &hits)
@@ -43,6 +43,18 @@ public:
     static std::vector<art::Ptr<recob::SpacePoint>> GetSpacePoints(const art::Ptr<recob::Hit> &pHit, 
         const art::Event &evt, const std::string &hitLabel, const std::string &hitToSpacePointLabel);
 
+    /**
+    * @brief  Get the space points associated with each of a set of hits, looking up the association once
+    *
+    * @param  hits the hits for which we want the space points
+    * @param  evt is the underlying art event
+    * @param  hitToSpacePointLabel is the label for the association between hit and space point
+    * 
+    * @return vector of space point vectors, in the same order as the hits
+    */
+    static std::vector<std::vector<art::Ptr<recob::SpacePoint>>> GetSpacePoints(const std::vector<art::Ptr<recob::Hit>> &hits, 
+        const art::Event &evt, const std::string &hitToSpacePointLabel);
+
     /**
     * @brief  Get all hits on a specific plane
     *
@@ -77,6 +89,18 @@ public:
                                      detinfo::DetectorPropertiesData const& detProp,
                                      const double timeInTicks, const double t0InMicroS);
 
+    /**
+    * @brief  get the lifetime corrections for ticks 0 to nTicks-1, equal to calling LifetimeCorrection for each tick
+    *
+    * @param  nTicks the number of ticks
+    * @param  t0InMicroS the t0 time in micro seconds
+    * 
+    * @return the charge normalisation corrections, indexed by tick
+    */
+    static std::vector<double> LifetimeCorrections(detinfo::DetectorClocksData const& clockData,
+                                                   detinfo::DetectorPropertiesData const& detProp,
+                                                   const unsigned int nTicks, const double t0InMicroS);
+
     /**
     * @brief  get the total hit charge, corrected for lifetime
     *
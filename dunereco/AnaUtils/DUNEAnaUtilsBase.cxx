@@ -0,0 +1,65 @@
+/**
+*
+* @file dunereco/AnaUtils/DUNEAnaUtilsBase.cxx
+*
+* @brief Base class containing functionality to extract products from the event
+*/
+
+//STL
+#include <utility>
+//DUNE
+#include "dunereco/AnaUtils/DUNEAnaUtilsBase.h"
+
+namespace dune_ana
+{
+
+thread_local DUNEAnaAssocCache *DUNEAnaAssocCache::fCurrent = nullptr;
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaAssocCache::DUNEAnaAssocCache(const art::Event &evt) :
+    fEvent(evt),
+    fPrevious(fCurrent)
+{
+    fCurrent = this;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaAssocCache::~DUNEAnaAssocCache()
+{
+    fCurrent = fPrevious;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+DUNEAnaAssocCache *DUNEAnaAssocCache::Get(const art::Event &evt)
+{
+    // Each event is alive for as long as its cache, so its address cannot have been reused
+    for (DUNEAnaAssocCache *cache = fCurrent; cache; cache = cache->fPrevious)
+    {
+        if (&cache->fEvent == &evt)
+            return cache;
+    }
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const void> DUNEAnaAssocCache::Find(const Key &key) const
+{
+    const auto iter = fEntries.find(key);
+
+    return iter == fEntries.end() ? nullptr : iter->second;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+void DUNEAnaAssocCache::Insert(const Key &key, std::shared_ptr<const void> finder)
+{
+    fEntries[key] = std::move(finder);
+}
+
+} // namespace dune_ana
+
@@ -12,11 +12,57 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "canvas/Persistency/Common/FindManyP.h"
 
+#include <map>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
 #include <vector>
 
 namespace dune_ana
 {
+/**
+ *
+ * @brief Store of the association finders built by the dune_ana utilities for one event
+ *
+ * Create one on the stack at the start of a module's produce or analyze. While it exists, the
+ * utilities called with that event on the same thread build each art::FindManyP once and reuse it.
+ * Everything is dropped when it goes out of scope, so no finder outlives the event it was made
+ * for. Without one the finders are built for every lookup, as before.
+ *
+*/
+class DUNEAnaAssocCache
+{
+public:
+    explicit DUNEAnaAssocCache(const art::Event &evt);
+    ~DUNEAnaAssocCache();
+
+    DUNEAnaAssocCache(const DUNEAnaAssocCache &) = delete;
+    DUNEAnaAssocCache &operator=(const DUNEAnaAssocCache &) = delete;
+
+private:
+    friend class DUNEAnaUtilsBase;
+
+    /// (associated type, product type, product label, association label)
+    typedef std::tuple<std::type_index, std::type_index, std::string, std::string> Key;
+
+    /// The cache of the calling thread made for this event, nullptr if there is none
+    static DUNEAnaAssocCache *Get(const art::Event &evt);
+
+    /// The finder stored for this key, nullptr if there is none
+    std::shared_ptr<const void> Find(const Key &key) const;
+
+    void Insert(const Key &key, std::shared_ptr<const void> finder);
+
+    /// Innermost cache of each thread, a thread can run another module while it waits on tasks
+    static thread_local DUNEAnaAssocCache *fCurrent;
+
+    const art::Event                               &fEvent;    ///< The event the finders are made for
+    DUNEAnaAssocCache                              *fPrevious; ///< Cache of this thread when this one was made
+    std::map<Key, std::shared_ptr<const void>>      fEntries;  ///< The art::FindManyP of each key
+};
+
 /**
  *
  * @brief DUNEAnaUtilsBase class containing some template functions
@@ -61,9 +107,21 @@ template <typename T, typename U> std::vector<art::Ptr<T>> DUNEAnaUtilsBase::Get
         return std::vector<art::Ptr<T>>();
     }
 
-    const art::FindManyP<T> findParticleAssocs(products,evt,assocLabel);
+    // Finding the associations goes through all of them, so only do it once per event if the module keeps a cache
+    DUNEAnaAssocCache *cache = DUNEAnaAssocCache::Get(evt);
+    const DUNEAnaAssocCache::Key key(typeid(T),typeid(U),label,assocLabel);
+
+    std::shared_ptr<const art::FindManyP<T>> findParticleAssocs;
+    if (cache)
+        findParticleAssocs = std::static_pointer_cast<const art::FindManyP<T>>(cache->Find(key));
+    if (!findParticleAssocs)
+    {
+        findParticleAssocs = std::make_shared<const art::FindManyP<T>>(products,evt,assocLabel);
+        if (cache)
+            cache->Insert(key,findParticleAssocs);
+    }
 
-    return findParticleAssocs.at(pProd.key());
+    return findParticleAssocs->at(pProd.key());
 }
 
 // Implementation of the template function to get the associated product from the event
@@ -7,15 +7,17 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // Framework includes
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art_root_io/TFileDirectory.h"
 #include "art_root_io/TFileService.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Utilities/Globals.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art/Framework/Core/ModuleMacros.h"
@@ -23,6 +25,7 @@
 
 #include "dunereco/CVN/func/Result.h"
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SparsePixelMap.h"
 //#include "dunereco/CVN/art/CaffeNetHandler.h"
 #include "dunereco/CVN/art/TFNetHandler.h"
 #include "dunereco/CVN/func/AssignLabels.h"
@@ -30,14 +33,14 @@
 
 namespace cvn {
 
-  class CVNEvaluator : public art::EDProducer {
+  class CVNEvaluator : public art::SharedProducer {
   public:
-    explicit CVNEvaluator(fhicl::ParameterSet const& pset);
+    explicit CVNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
     ~CVNEvaluator();
 
-    void produce(art::Event& evt);
-    void beginJob();
-    void endJob();
+    void produce(art::Event& evt, art::ProcessingFrame const& frame) override;
+    void beginJob(art::ProcessingFrame const&) override;
+    void endJob(art::ProcessingFrame const&) override;
 
 
 
@@ -51,7 +54,9 @@ namespace cvn {
     std::string fCVNType;
 
     //cvn::CaffeNetHandler fCaffeHandler;
-    cvn::TFNetHandler fTFHandler;
+    /// One handler per schedule, each holding its own input tensors. They all
+    /// share a single Tensorflow session through the session pool.
+    std::vector< std::unique_ptr<cvn::TFNetHandler> > fTFHandlers;
 
     /// Number of outputs fron neural net
     //unsigned int fNOutput;
@@ -59,6 +64,9 @@ namespace cvn {
     /// If there are multiple pixel maps per event can we use them?
     bool fMultiplePMs;
 
+    /// Read the sorted sparse maps written by CVNMapper with SparseOutput
+    bool fSparsePixelMaps;
+
     unsigned int fTotal;
     unsigned int fCorrect;
     unsigned int fFullyCorrect;
@@ -76,16 +84,23 @@ namespace cvn {
   };
 
   //.......................................................................
-  CVNEvaluator::CVNEvaluator(fhicl::ParameterSet const& pset): EDProducer{pset},
+  CVNEvaluator::CVNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&): SharedProducer{pset},
     fPixelMapInput (pset.get<std::string>         ("PixelMapInput")),
     fResultLabel (pset.get<std::string>         ("ResultLabel")),
     fCVNType     (pset.get<std::string>         ("CVNType")),
     //fCaffeHandler       (pset.get<fhicl::ParameterSet> ("CaffeNetHandler")),
-    fTFHandler       (pset.get<fhicl::ParameterSet> ("TFNetHandler")),
     //fNOutput       (fCaffeHandler.NOutput()),
-    fMultiplePMs (pset.get<bool> ("MultiplePMs"))
+    fMultiplePMs (pset.get<bool> ("MultiplePMs")),
+    fSparsePixelMaps (pset.get<bool> ("SparsePixelMaps", false))
   {
     produces< std::vector<cvn::Result>   >(fResultLabel);
+
+    const fhicl::ParameterSet handlerPars = pset.get<fhicl::ParameterSet>("TFNetHandler");
+    for(unsigned int s = 0; s < art::Globals::instance()->nschedules(); ++s){
+      fTFHandlers.push_back(std::make_unique<cvn::TFNetHandler>(handlerPars, fMultiplePMs));
+    }
+    async<art::InEvent>();
+
     fTotal = 0;
     fCorrect = 0;
     fFullyCorrect = 0;
@@ -109,12 +124,16 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNEvaluator::beginJob()
+  void CVNEvaluator::beginJob(art::ProcessingFrame const&)
   {  }
 
   //......................................................................
-  void CVNEvaluator::endJob()
+  void CVNEvaluator::endJob(art::ProcessingFrame const&)
   {
+    // One report for the job, summed over the handlers of all schedules
+    cvn::TFNetHandler::Summary summary;
+    for(auto const& handler : fTFHandlers) summary += handler->GetSummary();
+    cvn::TFNetHandler::PrintSummary(summary);
     /*
     float tot = static_cast<float>(fTotal);
     std::cout << "Total of " << fTotal << " events passed the fiducial volume cut and were classified" << std::endl;
@@ -131,7 +150,7 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNEvaluator::produce(art::Event& evt)
+  void CVNEvaluator::produce(art::Event& evt, art::ProcessingFrame const& frame)
   {
 
     /// Define containers for the things we're going to produce
@@ -140,10 +159,18 @@ namespace cvn {
 
     /// Load in the pixel maps
     std::vector< art::Ptr< cvn::PixelMap > > pixelmaplist;
+    std::vector< art::Ptr< cvn::SparsePixelMap > > sparsemaplist;
     art::InputTag itag1(fPixelMapInput, fPixelMapInput);
-    auto pixelmapListHandle = evt.getHandle< std::vector< cvn::PixelMap > >(itag1);
-    if (pixelmapListHandle)
-      art::fill_ptr_vector(pixelmaplist, pixelmapListHandle);
+    if(fSparsePixelMaps){
+      auto sparsemapListHandle = evt.getHandle< std::vector< cvn::SparsePixelMap > >(itag1);
+      if (sparsemapListHandle)
+        art::fill_ptr_vector(sparsemaplist, sparsemapListHandle);
+    }
+    else{
+      auto pixelmapListHandle = evt.getHandle< std::vector< cvn::PixelMap > >(itag1);
+      if (pixelmapListHandle)
+        art::fill_ptr_vector(pixelmaplist, pixelmapListHandle);
+    }
 
     /// Make sure we have a valid name for the CVN type
     /*
@@ -158,12 +185,30 @@ namespace cvn {
       }
     }*/
     if(fCVNType == "TF" || fCVNType == "Tensorflow" || fCVNType == "TensorFlow"){
+      // Sparse maps are only made dense inside the network input tensors
+      if(sparsemaplist.size() > 0){
+        std::vector<const cvn::SparsePixelMap*> batch;
+        const unsigned int nMaps = fMultiplePMs ? sparsemaplist.size() : 1;
+        for(unsigned int p = 0; p < nMaps; ++p){
+          batch.push_back(sparsemaplist[p].get());
+        }
+
+        std::vector<Result> networkResults = fTFHandlers[frame.scheduleID().id()]->Predict(batch);
+        resultCol->insert(resultCol->end(), networkResults.begin(), networkResults.end());
+      }
       // If we have a pixel map then use the TF interface to give us a prediction
-      if(pixelmaplist.size() > 0){
-        
-        std::vector< std::vector<float> > networkOutput = fTFHandler.Predict(*pixelmaplist[0]);
-        // cvn::Result can now take a vector of floats and works out the number of outputs
-        resultCol->emplace_back(networkOutput);
+      else if(pixelmaplist.size() > 0){
+
+        // Classify other pixel maps too if they exist. All maps are handed to
+        // the TF interface together so that it can evaluate them in batches.
+        std::vector<const cvn::PixelMap*> batch;
+        const unsigned int nMaps = fMultiplePMs ? pixelmaplist.size() : 1;
+        for(unsigned int p = 0; p < nMaps; ++p){
+          batch.push_back(pixelmaplist[p].get());
+        }
+
+        std::vector<Result> networkResults = fTFHandlers[frame.scheduleID().id()]->Predict(batch);
+        resultCol->insert(resultCol->end(), networkResults.begin(), networkResults.end());
 
         /*
         for(auto const& resaux: (*resultCol))
@@ -204,14 +249,6 @@ namespace cvn {
         }
         */
 
-        // Classify other pixel maps if they exist
-        if(fMultiplePMs){
-          for(unsigned int p = 1; p < pixelmaplist.size(); ++p){
-            std::vector< std::vector<float> > output = fTFHandler.Predict(*pixelmaplist[p]);
-            resultCol->emplace_back(output);
-          }
-        }
-
       }
     }
     else{
@@ -91,6 +91,9 @@ namespace cvn {
     /// For protoDUNE vertex finding, we only want the beam slice
     bool fUseBeamSliceOnly;
 
+    /// Allocate the combined charge and truth arrays, for training samples
+    bool fPixelMapTruth;
+
     /// PixelMapProducer does the work for us
     PixelMapProducer fProducer;
 
@@ -113,6 +116,7 @@ namespace cvn {
   fTrackLengthCut(pset.get<unsigned short> ("TrackLengthCut")),
   fUseWholeEvent(pset.get<bool> ("UseWholeEvent")),
   fUseBeamSliceOnly(pset.get<bool> ("UseBeamSliceOnly")),
+  fPixelMapTruth(pset.get<bool>          ("PixelMapTruth", false)),
   fProducer      (fWireLength, fTdcWidth, fTimeResolution)
   {
 
@@ -148,6 +152,7 @@ namespace cvn {
     // For protoDUNE unwrapped if > 0
     fProducer.SetUnwrapped(fUnwrappedPixelMap);
     fProducer.SetProtoDUNE();
+    fProducer.SetWithTruth(fPixelMapTruth);
 
     // Use the whole event just like we would for the FD
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
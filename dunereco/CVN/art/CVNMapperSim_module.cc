@@ -73,6 +73,9 @@ namespace cvn {
     /// ADC threshold for calculating charge from wires directly
     double fThreshold;
 
+    /// Allocate the combined charge and truth arrays, for training samples
+    bool fPixelMapTruth;
+
     /// PixelMapProducer does the work for us
     PixelMapSimProducer fProducer;
 
@@ -90,6 +93,7 @@ namespace cvn {
   fTimeResolution   (pset.get<unsigned short> ("TimeResolution")),
   fUnwrappedPixelMap(pset.get<unsigned short> ("UnwrappedPixelMap")),
   fThreshold        (pset.get<double>("Threshold")),
+  fPixelMapTruth(pset.get<bool>          ("PixelMapTruth", false)),
   fProducer      (fWireLength, fTdcWidth, fTimeResolution, fThreshold)
   {
 
@@ -120,6 +124,7 @@ namespace cvn {
     // Use unwrapped pixel maps if requested
     // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
     fProducer.SetUnwrapped(fUnwrappedPixelMap);
+    fProducer.SetWithTruth(fPixelMapTruth);
 
     std::vector< art::Ptr< sim::SimChannel > > hitlist;
     auto hitListHandle = evt.getHandle< std::vector< sim::SimChannel > >(fHitsModuleLabel);
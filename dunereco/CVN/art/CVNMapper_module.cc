@@ -25,6 +25,7 @@
 
 #include "dunereco/CVN/art/PixelMapProducer.h"
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SparsePixelMap.h"
 #include "dunereco/CVN/func/TrainingData.h"
 
 
@@ -70,6 +71,12 @@ namespace cvn {
     // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
     unsigned short fUnwrappedPixelMap;
 
+    /// Store sorted sparse maps instead of dense ones?
+    bool fSparseOutput;
+
+    /// Allocate the combined charge and truth arrays, for training samples
+    bool fPixelMapTruth;
+
     /// PixelMapProducer does the work for us
     PixelMapProducer fProducer;
 
@@ -86,10 +93,13 @@ namespace cvn {
   fWireLength   (pset.get<unsigned short> ("WireLength")),
   fTimeResolution   (pset.get<unsigned short> ("TimeResolution")),
   fUnwrappedPixelMap(pset.get<unsigned short> ("UnwrappedPixelMap")),
+  fSparseOutput (pset.get<bool>           ("SparseOutput", false)),
+  fPixelMapTruth(pset.get<bool>          ("PixelMapTruth", false)),
   fProducer      (fWireLength, fTdcWidth, fTimeResolution)
   {
 
-    produces< std::vector<cvn::PixelMap>   >(fClusterPMLabel);
+    if(fSparseOutput) produces< std::vector<cvn::SparsePixelMap> >(fClusterPMLabel);
+    else produces< std::vector<cvn::PixelMap>   >(fClusterPMLabel);
 
   }
 
@@ -116,6 +126,7 @@ namespace cvn {
     // Use unwrapped pixel maps if requested
     // 0 means no unwrap, 1 means unwrap in wire, 2 means unwrap in wire and time
     fProducer.SetUnwrapped(fUnwrappedPixelMap);
+    fProducer.SetWithTruth(fPixelMapTruth);
 
     std::vector< art::Ptr< recob::Hit > > hitlist;
     auto hitListHandle = evt.getHandle< std::vector< recob::Hit > >(fHitsModuleLabel);
@@ -123,6 +134,18 @@ namespace cvn {
       art::fill_ptr_vector(hitlist, hitListHandle);
     unsigned short nhits = hitlist.size();
 
+    // Sparse maps only hold the non-empty pixels, and are made dense in the evaluator
+    if(fSparseOutput){
+      std::unique_ptr< std::vector<cvn::SparsePixelMap> >
+        spmCol(new std::vector<cvn::SparsePixelMap>);
+      if (nhits > fMinClusterHits) {
+        auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt);
+        spmCol->push_back(fProducer.CreateSparseMap(detProp, hitlist));
+      }
+      evt.put(std::move(spmCol), fClusterPMLabel);
+      return;
+    }
+
     //Declaring containers for things to be stored in event
     std::unique_ptr< std::vector<cvn::PixelMap> >
       pmCol(new std::vector<cvn::PixelMap>);
@@ -8,6 +8,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include "boost/filesystem.hpp"
 
 // Framework includes
@@ -25,6 +26,7 @@
 #include "dunereco/CVN/func/AssignLabels.h"
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/ZlibArchive.h"
 
 // Compression
 #include "zlib.h"
@@ -40,6 +42,7 @@ namespace cvn {
     ~CVNZlibMakerProtoDUNE();
 
     void beginJob() override;
+    void endJob() override;
     void analyze(const art::Event& evt) override;
     void reconfigure(const fhicl::ParameterSet& pset);
 
@@ -68,7 +71,13 @@ namespace cvn {
 
     std::string fLArG4ModuleLabel;
 
+    bool fUseArchive;
+    std::string fArchivePrefix;
+    unsigned int fShardSizeMB;
+    bool fAsyncCompression;
+
     std::string out_dir;
+    std::unique_ptr<ZlibArchiveWriter> fArchive;
 
     void write_files(const PrimaryTrainingInfo &primary, const art::Ptr<cvn::PixelMap> pm, unsigned int n) const;
 
@@ -93,6 +102,11 @@ namespace cvn {
     fSetLog = pset.get<bool>("SetLog");
     fReverseViews = pset.get<std::vector<bool>>("ReverseViews");
     fLArG4ModuleLabel = pset.get<std::string>("LArG4ModuleLabel");
+
+    fUseArchive = pset.get<bool>("UseArchive", false);
+    fArchivePrefix = pset.get<std::string>("ArchivePrefix", "cvn_protodune");
+    fShardSizeMB = pset.get<unsigned int>("ShardSizeMB", 1024);
+    fAsyncCompression = pset.get<bool>("AsyncCompression", true);
   }
 
   //......................................................................
@@ -127,6 +141,12 @@ namespace cvn {
     // std::cout << "Writing files to output directory " << out_dir << std::endl;
   }
 
+  //......................................................................
+  void CVNZlibMakerProtoDUNE::endJob()
+  {
+    if (fArchive) fArchive->Close();
+  }
+
   //......................................................................
   void CVNZlibMakerProtoDUNE::analyze(const art::Event& evt)
   {
@@ -171,6 +191,13 @@ namespace cvn {
 
     const PrimaryTrainingInfo beamPrimary(beamParticleVtx,beamParticleInteraction,beamParticlePDG,beamParticleEnergy);
 
+    // One archive per job, named after its first event so parallel jobs don't collide
+    if (fUseArchive && !fArchive){
+      std::string prefix = fArchivePrefix + "_r" + std::to_string(evt.run()) + "_s" + std::to_string(evt.subRun())
+        + "_e" + std::to_string(evt.event());
+      fArchive = std::make_unique<ZlibArchiveWriter>(out_dir, prefix, (uint64_t)fShardSizeMB << 20, fAsyncCompression);
+    }
+
     this->write_files(beamPrimary, pixelmaps.at(0), evt.event());
   }
 
@@ -185,11 +212,22 @@ namespace cvn {
     image_utils.SetViewReversal(fReverseViews);
     image_utils.ConvertPixelMapToPixelArray(*(pm.get()),pixel_array);
 
+    // Archive index values, in the order of the lines of the .info file
+    const std::vector<double> info = {
+      primary.vertex.X(), primary.vertex.Y(), primary.vertex.Z(),
+      primary.energy, (double)primary.interaction, (double)primary.pdgCode
+    };
+
+    if (fArchive) {
+      fArchive->Write("cvn_event_" + std::to_string(n), std::move(pixel_array), info);
+      return;
+    }
+
     ulong src_len = 3 * pm->NWire() * pm->NTdc(); // pixelArray length
     ulong dest_len = compressBound(src_len);     // calculate size of the compressed data               
-    char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
+    std::vector<char> ostream(dest_len);         // memory for the compressed data
 
-    int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &pixel_array[0], src_len);
+    int res = compress((Bytef *) ostream.data(), &dest_len, (Bytef *) &pixel_array[0], src_len);
 
     // Buffer error
 
@@ -214,7 +252,7 @@ namespace cvn {
 
         // Write compressed data to file
 
-        image_file.write(ostream, dest_len);
+        image_file.write(ostream.data(), dest_len);
 
         image_file.close(); // close file
 
@@ -243,8 +281,6 @@ namespace cvn {
             << "Unable to open file " << info_file_name << "!" << std::endl;
       }
     }
-    
-    free(ostream);  // free allocated memory
 
   } // cvn::CVNZlibMakerProtoDUNE::write_files
 
@@ -8,6 +8,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 
 #include "boost/filesystem.hpp"
 
@@ -28,6 +29,7 @@
 #include "dunereco/CVN/func/InteractionType.h"
 #include "dunereco/CVN/func/PixelMap.h"
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/ZlibArchive.h"
 
 // Compression
 #include "zlib.h"
@@ -43,6 +45,7 @@ namespace cvn {
     ~CVNZlibMaker();
 
     void beginJob() override;
+    void endJob() override;
     void analyze(const art::Event& evt) override;
     void reconfigure(const fhicl::ParameterSet& pset);
 
@@ -62,9 +65,15 @@ namespace cvn {
     unsigned int fPlaneLimit;
     unsigned int fTDCLimit;
 
+    bool fUseArchive;
+    std::string fArchivePrefix;
+    unsigned int fShardSizeMB;
+    bool fAsyncCompression;
+
     std::string out_dir;
+    std::unique_ptr<ZlibArchiveWriter> fArchive;
 
-    void write_files(TrainingData td, unsigned int n, std::string evtid);
+    void write_files(const TrainingData& td, unsigned int n, const std::string& evtid);
 
   };
 
@@ -95,6 +104,11 @@ namespace cvn {
 
     fPlaneLimit = pset.get<unsigned int>("PlaneLimit");
     fTDCLimit = pset.get<unsigned int>("TDCLimit");
+
+    fUseArchive = pset.get<bool>("UseArchive", false);
+    fArchivePrefix = pset.get<std::string>("ArchivePrefix", "cvn");
+    fShardSizeMB = pset.get<unsigned int>("ShardSizeMB", 1024);
+    fAsyncCompression = pset.get<bool>("AsyncCompression", true);
   }
 
   //......................................................................
@@ -129,6 +143,12 @@ namespace cvn {
     // std::cout << "Writing files to output directory " << out_dir << std::endl;
   }
 
+  //......................................................................
+  void CVNZlibMaker::endJob()
+  {
+    if (fArchive) fArchive->Close();
+  }
+
   //......................................................................
   void CVNZlibMaker::analyze(const art::Event& evt)
   {
@@ -211,7 +231,7 @@ namespace cvn {
   }
 
   //......................................................................
-  void CVNZlibMaker::write_files(TrainingData td, unsigned int n, std::string evtid)
+  void CVNZlibMaker::write_files(const TrainingData& td, unsigned int n, const std::string& evtid)
   {
     // cropped from 2880 x 500 to 500 x 500 here 
     std::vector<unsigned char> pixel_array(3 * fPlaneLimit * fTDCLimit);
@@ -222,11 +242,34 @@ namespace cvn {
     image_utils.SetViewReversal(fReverseViews);
     image_utils.ConvertPixelMapToPixelArray(td.fPMap, pixel_array);
 
+    // Archive index values, in the order of the lines of the .info file
+    const std::vector<double> info = {
+      // Category
+      (double)td.fInt,
+      // Energy
+      td.fNuEnergy, td.fLepEnergy, td.fRecoNueEnergy, td.fRecoNumuEnergy,
+      td.fRecoNutauEnergy, td.fEventWeight,
+      // Topology
+      (double)td.fNuPDG, (double)td.fNProton, (double)td.fNPion,
+      (double)td.fNPizero, (double)td.fNNeutron,
+      (double)td.fTopologyType, (double)td.fTopologyTypeAlt,
+      (double)td.fPMap.GetTotHits()
+    };
+
+    if (fUseArchive) {
+      // One archive per job, named after its first event so parallel jobs don't collide
+      if (!fArchive)
+        fArchive = std::make_unique<ZlibArchiveWriter>(out_dir, fArchivePrefix + "_" + evtid,
+          (uint64_t)fShardSizeMB << 20, fAsyncCompression);
+      fArchive->Write("event_" + evtid, std::move(pixel_array), info);
+      return;
+    }
+
     ulong src_len = 3 * fPlaneLimit * fTDCLimit; // pixelArray length
     ulong dest_len = compressBound(src_len);     // calculate size of the compressed data               
-    char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
+    std::vector<char> ostream(dest_len);         // memory for the compressed data
 
-    int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &pixel_array[0], src_len);
+    int res = compress((Bytef *) ostream.data(), &dest_len, (Bytef *) &pixel_array[0], src_len);
 
     // Buffer error
 
@@ -251,7 +294,7 @@ namespace cvn {
 
         // Write compressed data to file
 
-        image_file.write(ostream, dest_len);
+        image_file.write(ostream.data(), dest_len);
 
         image_file.close(); // close file
 
@@ -299,8 +342,6 @@ namespace cvn {
             << "Unable to open file " << info_file_name << "!" << std::endl;
       }
     }
-    
-    free(ostream);  // free allocated memory
 
   } // cvn::CVNZlibMaker::write_files
 
@@ -5,6 +5,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 // C/C++ includes
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -124,12 +125,6 @@ namespace cvn {
     // Get the utility to help us calculate features
     cvn::GCNFeatureUtils graphUtil;
 
-    // We can calculate the number of neighbours for each space point with some radius
-    // Store the number of neighbours for each spacepoint ID, for each slice. If we
-    // only want the beam slice, or all of the slices together, this will have one
-    // element
-    std::map<unsigned int,std::vector<std::map<int,unsigned int>>> neighbourMap;
-
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
     if(fUseAllSlices || fUseBeamSliceOnly){
       // We need to get a vector of space points from the beam slice
@@ -159,7 +154,6 @@ namespace cvn {
           }
         }
         allGraphSpacePoints[sliceID] = sliceSpacePoints;
-        neighbourMap.insert(std::make_pair(sliceID,graphUtil.GetNeighboursForRadii(evt,fNeighbourRadii,sliceSpacePoints)));
       }
     }
     else{
@@ -173,12 +167,11 @@ namespace cvn {
       for(art::Ptr<recob::SpacePoint> p : eventSpacePoints){
         mapVec.insert(std::make_pair(p->ID(),p));
       }
-      neighbourMap.insert(std::make_pair(0,graphUtil.GetNeighboursForRadii(evt,fNeighbourRadii,eventSpacePoints)));
       allGraphSpacePoints.insert(std::make_pair(0,mapVec));
     }
 
     // Get some maps we'll need to fill our features
-    std::cout << "Found all neighbours for " << neighbourMap.size() << " slices, building graphs..." << std::endl;
+    std::cout << "Found space points for " << allGraphSpacePoints.size() << " slices, building graphs..." << std::endl;
 
     // Function is linear in number of points so just do it once
     std::map<unsigned int,float> chargeMap = graphUtil.GetSpacePointChargeMap(evt,fSpacePointLabel);
@@ -195,15 +188,28 @@ namespace cvn {
        
         cvn::GCNGraph newGraph;
 
-        std::map<int,std::pair<int,int>> twoNearest = graphUtil.GetTwoNearestNeighbours(evt,sps.second);
+        // Index the slice space points once, in ID order, for all of the neighbour queries
+        std::vector<art::Ptr<recob::SpacePoint>> sliceSpacePoints;
+        sliceSpacePoints.reserve(sps.second.size());
+        for(const std::pair<const unsigned int,art::Ptr<recob::SpacePoint>> &sp : sps.second){
+          sliceSpacePoints.push_back(sp.second);
+        }
+        float maxRadius = 0.;
+        for(const float r : fNeighbourRadii) maxRadius = std::max(maxRadius, r);
+        const cvn::SpacePointGrid grid(sliceSpacePoints, maxRadius);
+
+        // The number of neighbours for each space point within each radius
+        const std::vector<std::vector<unsigned int>> neighbours = graphUtil.GetNeighboursForRadii(grid,fNeighbourRadii);
+        const std::vector<std::pair<int,int>> twoNearest = graphUtil.GetTwoNearestNeighbours(grid);
 
         std::cout << "Constructing graph for slice " << sps.first << " with " << sps.second.size() << " nodes." << std::endl;
-        for(const std::pair<unsigned int,art::Ptr<recob::SpacePoint>> &sp : sps.second){
+        for(unsigned int i = 0; i < sliceSpacePoints.size(); ++i){
+          const art::Ptr<recob::SpacePoint> &sp = sliceSpacePoints[i];
   
           // Get the position
           std::vector<float> position;
           // Why does this use an array... we want a vector in any case
-          const double *pos = sp.second->XYZ();
+          const double *pos = sp->XYZ();
           for(unsigned int p = 0; p < 3; ++p) position.push_back(pos[p]);
   
           // Calculate some features
@@ -211,31 +217,31 @@ namespace cvn {
   
           // The neighbour map gives us our first feature(s)
           for(unsigned int m = 0; m < fNeighbourRadii.size(); ++m){
-            features.push_back(neighbourMap.at(sps.first)[m].at(sp.second->ID()));
+            features.push_back(neighbours[m][i]);
           }
   
           // How about charge?
-          features.push_back(chargeMap.at(sp.second->ID()));
+          features.push_back(chargeMap.at(sp->ID()));
   
           // Now the hit width
-//          features.push_back(hitRMSMap.at(sp.second->ID()));
+//          features.push_back(hitRMSMap.at(sp->ID()));
 
           // Angle and dot product between node and its two nearest neighbours
           float angle = -999.;
           float dotProduct = -999.;
-          int n1ID = twoNearest[sp.second->ID()].first;
-          int n2ID = twoNearest[sp.second->ID()].second;
-          const recob::SpacePoint n1 = *(sps.second.at(n1ID).get());
-          const recob::SpacePoint n2 = *(sps.second.at(n2ID).get());
-          graphUtil.GetAngleAndDotProduct(*(sp.second.get()),n1,n2,dotProduct,angle);
+          const int n1 = twoNearest[i].first;
+          const int n2 = twoNearest[i].second;
+          if(n1 >= 0 && n2 >= 0){
+            graphUtil.GetAngleAndDotProduct(*sp,*sliceSpacePoints[n1],*sliceSpacePoints[n2],dotProduct,angle);
+          }
           features.push_back(dotProduct);
           features.push_back(angle);
   
           // We set the "ground truth" as the particle PDG code in this case
           std::vector<float> truePDG;
-          truePDG.push_back(static_cast<float>(trueIDMap.at(sp.second->ID())));
+          truePDG.push_back(static_cast<float>(trueIDMap.at(sp->ID())));
           newGraph.AddNode(position,features,truePDG);
-//          if(abs(trueIDMap.at(sp.second->ID())) != 13) std::cout << "Adding node " << sp.second->ID() << " with neighbours " << n1ID << " and " << n2ID << " and PDG = " << truePDG[0] << std::endl;
+//          if(abs(trueIDMap.at(sp->ID())) != 13) std::cout << "Adding node " << sp->ID() << " with neighbours " << n1 << " and " << n2 << " and PDG = " << truePDG[0] << std::endl;
         }
   
         std::cout << "GCNGraphMakerProtoDUNE: produced GCNGraph object with " << newGraph.GetNumberOfNodes() << " nodes" << std::endl;
@@ -9,6 +9,7 @@
 // C/C++ includes
 #include <iostream>
 #include <sstream>
+#include <memory>
 #include "boost/filesystem.hpp"
 
 // Framework includes
@@ -26,6 +27,7 @@
 #include "dunereco/CVN/func/AssignLabels.h"
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/InteractionType.h"
+#include "dunereco/CVN/func/ZlibArchive.h"
 
 // Compression
 #include "zlib.h"
@@ -41,6 +43,7 @@ namespace cvn {
     ~GCNZlibMaker();
 
     void beginJob() override;
+    void endJob() override;
     void analyze(const art::Event& evt) override;
     void reconfigure(const fhicl::ParameterSet& pset);
 
@@ -55,7 +58,13 @@ namespace cvn {
     std::string fEnergyNumuLabel;
     std::string fEnergyNutauLabel;
 
+    bool fUseArchive;
+    std::string fArchivePrefix;
+    unsigned int fShardSizeMB;
+    bool fAsyncCompression;
+
     std::string out_dir;
+    std::unique_ptr<ZlibArchiveWriter> fArchive;
 
   };
 
@@ -81,6 +90,11 @@ namespace cvn {
     fEnergyNueLabel = pset.get<std::string>("EnergyNueLabel");
     fEnergyNumuLabel = pset.get<std::string>("EnergyNumuLabel");
     fEnergyNutauLabel = pset.get<std::string>("EnergyNutauLabel");
+
+    fUseArchive = pset.get<bool>("UseArchive", false);
+    fArchivePrefix = pset.get<std::string>("ArchivePrefix", "gcn");
+    fShardSizeMB = pset.get<unsigned int>("ShardSizeMB", 1024);
+    fAsyncCompression = pset.get<bool>("AsyncCompression", true);
   }
 
   //......................................................................
@@ -100,6 +114,12 @@ namespace cvn {
     // std::cout << "Writing files to output directory " << out_dir << std::endl;
   }
 
+  //......................................................................
+  void GCNZlibMaker::endJob()
+  {
+    if (fArchive) fArchive->Close();
+  }
+
   //......................................................................
   void GCNZlibMaker::analyze(const art::Event& evt)
   {
@@ -179,12 +199,47 @@ namespace cvn {
       // We need to extract all of the information into a single vector to write
       // into the compressed file format
       const std::vector<float> vectorToWrite = g->ConvertGraphToVector();
+
+      std::stringstream modifier;
+      if(graphs.size() > 1){
+        modifier << "_" << i;
+      }
+
+      // Archive index values, in the order of the lines of the .info file
+      const std::vector<double> info = {
+        // Interaction type first
+        (double)interaction,
+        // True and reconstructed energy variables
+        nu_energy, lep_energy, reco_nue_energy, reco_numu_energy,
+        reco_nutau_energy, event_weight,
+        (double)labels.GetPDG(), (double)labels.GetNProtons(), (double)labels.GetNPions(),
+        (double)labels.GetNPizeros(), (double)labels.GetNNeutrons(),
+        (double)labels.GetTopologyType(), (double)labels.GetTopologyTypeAlt(),
+        // Number of nodes and node features is needed for unpacking
+        (double)g->GetNumberOfNodes(), (double)g->GetNumberOfNodeCoordinates(),
+        (double)g->GetNumberOfNodeFeatures()
+      };
+
+      if (fUseArchive) {
+        // One archive per job, named after its first event so parallel jobs don't collide
+        if (!fArchive){
+          std::stringstream prefix;
+          prefix << fArchivePrefix << "_r" << evt.run() << "_s" << evt.subRun() << "_e" << evt.event();
+          fArchive = std::make_unique<ZlibArchiveWriter>(out_dir, prefix.str(),
+            (uint64_t)fShardSizeMB << 20, fAsyncCompression);
+        }
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vectorToWrite.data());
+        std::stringstream key;
+        key << "event_" << evt.event() << modifier.str();
+        fArchive->Write(key.str(), std::vector<unsigned char>(bytes, bytes + vectorToWrite.size()*sizeof(float)), info);
+        continue;
+      }
    
       ulong src_len = vectorToWrite.size() *sizeof(float);
       ulong dest_len = compressBound(src_len);     // calculate size of the compressed data               
-      char* ostream = (char *) malloc(dest_len);  // allocate memory for the compressed data
+      std::vector<char> ostream(dest_len);         // memory for the compressed data
   
-      int res = compress((Bytef *) ostream, &dest_len, (Bytef *) &vectorToWrite[0], src_len);
+      int res = compress((Bytef *) ostream.data(), &dest_len, (Bytef *) &vectorToWrite[0], src_len);
   
       // Buffer error
       if (res == Z_BUF_ERROR)
@@ -195,11 +250,6 @@ namespace cvn {
       // Compression ok 
       else {
 
-        std::stringstream modifier;
-        if(graphs.size() > 1){
-          modifier << "_" << i;
-        }
-  
         // Create output files 
         std::stringstream image_file_name; 
         image_file_name << out_dir << "/event_" << evt.event() << modifier.str() << ".gz";
@@ -212,7 +262,7 @@ namespace cvn {
         if(image_file.is_open() && info_file.is_open()) {
   
           // Write the graph to the file and close it
-          image_file.write(ostream, dest_len);
+          image_file.write(ostream.data(), dest_len);
           image_file.close(); // close file
   
           // Write the auxillary information to the text file
@@ -256,8 +306,6 @@ namespace cvn {
               << "Unable to open file " << info_file_name.str() << "!" << std::endl;
         }
       }
-      free(ostream);  // free allocated memory
-      ostream = nullptr;
     }
     
     return;
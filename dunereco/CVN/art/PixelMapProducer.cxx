@@ -12,6 +12,7 @@
 #include  <list>
 #include  <algorithm>
 #include <numeric>
+#include <cmath>
 
 #include "dunereco/CVN/art/PixelMapProducer.h"
 #include "dunereco/CVN/func/AssignLabels.h"
@@ -34,18 +35,29 @@ namespace cvn
     fNTdc(nTdc),
     fTRes(tRes),
     fUnwrapped(2),
-    fProtoDUNE(false)
+    fProtoDUNE(false),
+    fWithTruth(false),
+    fUnwrapDriftVel(0.)
   {
 
     fGeometry = &*(art::ServiceHandle<geo::Geometry>());  
-    if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos)
+    // The geometry is fixed for the job, so only look at its name once
+    fIs10kt = (fGeometry->DetectorName() == "dune10kt_v1");
+    fIsVD3View = (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos);
+    if (fIsVD3View)
       _cacheIntercepts();
   }
 
-  PixelMapProducer::PixelMapProducer()
+  PixelMapProducer::PixelMapProducer():
+    fUnwrapped(2),
+    fProtoDUNE(false),
+    fWithTruth(false),
+    fUnwrapDriftVel(0.)
   {
     fGeometry = &*(art::ServiceHandle<geo::Geometry>());  
-    if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos)
+    fIs10kt = (fGeometry->DetectorName() == "dune10kt_v1");
+    fIsVD3View = (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos);
+    if (fIsVD3View)
       _cacheIntercepts();
   }
 
@@ -62,64 +74,205 @@ namespace cvn
   PixelMap PixelMapProducer::CreateMap(detinfo::DetectorPropertiesData const& detProp,
                                        const std::vector<const recob::Hit* >& cluster)
   {
-    if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos){
-      fVDPlane0.clear();
-      fVDPlane1.clear();
-      _cacheIntercepts();
-    }
-    
-    Boundary bound = DefineBoundary(detProp, cluster);
-    return CreateMapGivenBoundary(detProp, cluster, bound);
+    // Each hit is unwrapped once, for both the boundary and the map
+    UnwrapHits(detProp, cluster);
+    Boundary bound = DefineBoundary(fUnwrappedHits);
+    return FillMap(fUnwrappedHits, bound);
   }
 
   PixelMap PixelMapProducer::CreateMapGivenBoundary(detinfo::DetectorPropertiesData const& detProp,
                                                     const std::vector<const recob::Hit*>& cluster,
       const Boundary& bound)
   {
+    UnwrapHits(detProp, cluster);
+    return FillMap(fUnwrappedHits, bound);
+  }
 
-    PixelMap pm(fNWire, fNTdc, bound);
+  PixelMap PixelMapProducer::FillMap(const std::vector<UnwrappedHit>& hits, const Boundary& bound) const
+  {
 
-    for(size_t iHit = 0; iHit < cluster.size(); ++iHit)
+    PixelMap pm(fNWire, fNTdc, bound, fWithTruth);
+
+    for(const UnwrappedHit& hit : hits)
     {
+      pm.Add(hit.wire, hit.tdc, hit.plane, hit.pe);
+    }
+    return pm;
+  }
 
-      geo::WireID wireid     = cluster[iHit]->WireID();
-      double temptdc         = cluster[iHit]->PeakTime();
-      unsigned int tempWire  = wireid.Wire;
-      unsigned int tempPlane = wireid.Plane;
-      // Leigh: Simple modification to unwrap the collection view wire plane
-      if(!fProtoDUNE){
-        if(fUnwrapped == 1){
-          // Jeremy: Autodetect geometry for DUNE 10kt module. Is this a bad idea??
-          if (fGeometry->DetectorName() == "dune10kt_v1") {
-            if (wireid.TPC%6 == 0 or wireid.TPC%6 == 5) continue; // Skip dummy TPCs in 10kt module
-            GetDUNE10ktGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),
-              wireid.Plane,wireid.TPC,tempWire,tempPlane,temptdc);
-          }
-          else if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos){
-            GetDUNEVertDrift3ViewGlobalWire(wireid.Wire, wireid.Plane,wireid.TPC,tempWire,tempPlane);
+  SparsePixelMap PixelMapProducer::CreateSparseMap(detinfo::DetectorPropertiesData const& detProp,
+                                                   const std::vector< art::Ptr< recob::Hit > >& cluster)
+  {
+    std::vector<const recob::Hit*> newCluster;
+    for(const art::Ptr<recob::Hit> hit : cluster){
+      newCluster.push_back(hit.get());
+    }
+    return CreateSparseMap(detProp, newCluster);
+  }
+
+  SparsePixelMap PixelMapProducer::CreateSparseMap(detinfo::DetectorPropertiesData const& detProp,
+                                                   const std::vector<const recob::Hit* >& cluster)
+  {
+    UnwrapHits(detProp, cluster);
+    Boundary bound = DefineBoundary(fUnwrappedHits);
+    return FillSparseMap(fUnwrappedHits, bound);
+  }
+
+  SparsePixelMap PixelMapProducer::CreateSparseMapGivenBoundary(detinfo::DetectorPropertiesData const& detProp,
+                                                                const std::vector<const recob::Hit*>& cluster,
+                                                                const Boundary& bound)
+  {
+    UnwrapHits(detProp, cluster);
+    return FillSparseMap(fUnwrappedHits, bound);
+  }
+
+  SparsePixelMap PixelMapProducer::FillSparseMap(const std::vector<UnwrappedHit>& hits, const Boundary& bound) const
+  {
+    // Pixel index and charge of each hit inside the boundary, per view. The
+    // indexing matches PixelMap::GlobalToIndexSingle so that the dense image
+    // made from this map is identical to the one made from CreateMap.
+    std::vector< std::vector< std::pair<unsigned int, double> > > viewHits(3);
+
+    for(const UnwrappedHit& hit : hits)
+    {
+      if(hit.plane > 2 || !bound.IsWithin(hit.wire, hit.tdc, hit.plane)) continue;
+
+      const double lowerTL  = bound.FirstTDC(hit.plane);
+      const double timestep = (bound.LastTDC(hit.plane) - lowerTL)/double(fNTdc);
+      const unsigned int internalWire = hit.wire - bound.FirstWire(hit.plane);
+      const unsigned int internalTdc  = round((hit.tdc - lowerTL)/timestep);
+
+      viewHits[hit.plane].emplace_back(internalWire * fNTdc + internalTdc % fNTdc, hit.pe);
+    }
+
+    SparsePixelMap map(2, 3);
+    map.SetExtent({fNWire, fNTdc});
+
+    for(unsigned int view = 0; view < viewHits.size(); ++view)
+    {
+      // Stable sort keeps the hit order within a pixel, so the summed charge
+      // is rounded exactly as in PixelMap::Add
+      std::vector< std::pair<unsigned int, double> >& pixelHits = viewHits[view];
+      std::stable_sort(pixelHits.begin(), pixelHits.end(),
+                       [](const std::pair<unsigned int, double>& a, const std::pair<unsigned int, double>& b)
+                       { return a.first < b.first; });
+
+      for(size_t i = 0; i < pixelHits.size(); )
+      {
+        const unsigned int index = pixelHits[i].first;
+        float pe = 0.;
+        for(; i < pixelHits.size() && pixelHits[i].first == index; ++i) pe += pixelHits[i].second;
+        map.AddHit(view, {(float)(index / fNTdc), (float)(index % fNTdc)}, {pe});
+      }
+    }
+
+    return map;
+  }
+
+  void PixelMapProducer::UpdateUnwrapTable(detinfo::DetectorPropertiesData const& detProp)
+  {
+    // Only the tdc unwrapping depends on the event, through the drift velocity
+    if(!fUnwrapTable.empty() && detProp.DriftVelocity() == fUnwrapDriftVel) return;
+
+    fUnwrapDriftVel = detProp.DriftVelocity();
+    const unsigned int nTPC = fGeometry->NTPC(0);
+    fUnwrapTable.assign(3*nTPC, UnwrapEntry());
+
+    for(unsigned int tpc = 0; tpc < nTPC; ++tpc)
+    {
+      for(unsigned int plane = 0; plane < 3; ++plane)
+      {
+        UnwrapEntry& entry = fUnwrapTable[3*tpc + plane];
+        if(plane >= fGeometry->Nplanes(tpc, 0)){
+          entry.skip = true;
+          continue;
+        }
+
+        // The unwrapping is linear in the local wire and tdc, so two points fix
+        // it. Going through the existing functions keeps the table in step with them.
+        unsigned int wire0 = 0, wire1 = 1, plane0 = plane, plane1 = plane;
+        double tdc0 = 0., tdc1 = 1.;
+        if(!fProtoDUNE){
+          if(fUnwrapped == 1){
+            if (fIs10kt) {
+              if (tpc%6 == 0 or tpc%6 == 5){ // Skip dummy TPCs in 10kt module
+                entry.skip = true;
+                continue;
+              }
+              GetDUNE10ktGlobalWireTDC(detProp, 0, 0., plane, tpc, wire0, plane0, tdc0);
+              GetDUNE10ktGlobalWireTDC(detProp, 1, 1., plane, tpc, wire1, plane1, tdc1);
+            }
+            else if (fIsVD3View){
+              // The induction views are matched to the diagonal CRMs wire by wire
+              if(plane < 2){
+                entry.wireMap.resize(fGeometry->Nwires(plane, tpc, 0));
+                for(unsigned int localWire = 0; localWire < entry.wireMap.size(); ++localWire){
+                  GetDUNEVertDrift3ViewGlobalWire(localWire, plane, tpc, entry.wireMap[localWire], plane0);
+                }
+              }
+              else{
+                GetDUNEVertDrift3ViewGlobalWire(0, plane, tpc, wire0, plane0);
+                GetDUNEVertDrift3ViewGlobalWire(1, plane, tpc, wire1, plane1);
+              }
+            }
+            // Default to 1x2x6. Should probably specifically name this function as such
+            else {
+              GetDUNEGlobalWireTDC(detProp, 0, 0., plane, tpc, wire0, plane0, tdc0);
+              GetDUNEGlobalWireTDC(detProp, 1, 1., plane, tpc, wire1, plane1, tdc1);
+            }
           }
-          // Default to 1x2x6. Should probably specifically name this function as such
-          else {
-            GetDUNEGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),
-              wireid.Plane,wireid.TPC,tempWire,tempPlane,temptdc);
+          else if(fUnwrapped == 2){
+            // Old method that has problems with the APA crossers, kept for old times' sake
+            GetDUNEGlobalWire(0, plane, tpc, wire0, plane0);
+            GetDUNEGlobalWire(1, plane, tpc, wire1, plane1);
           }
         }
-        else if(fUnwrapped == 2){
-          // Old method that has problems with the APA crossers, kept for old times' sake
-          GetDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,tempWire,tempPlane);
+        else{
+          GetProtoDUNEGlobalWire(0, plane, tpc, wire0, plane0);
+          GetProtoDUNEGlobalWire(1, plane, tpc, wire1, plane1);
         }
+
+        entry.plane = plane0;
+        entry.wireOffset = wire0;
+        entry.wireSign = (int)wire1 - (int)wire0;
+        entry.tdcOffset = tdc0;
+        entry.tdcSign = tdc1 - tdc0;
       }
-      else{
-        GetProtoDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,tempWire,tempPlane);
-      }
-      const double pe  = cluster[iHit]->Integral();
-      const unsigned int wire = tempWire;
-      const unsigned int wirePlane = tempPlane;
-      const double tdc = temptdc;
-      pm.Add(wire, tdc, wirePlane, pe);
+    }
+  }
+
+  void PixelMapProducer::UnwrapHits(detinfo::DetectorPropertiesData const& detProp,
+                                    const std::vector<const recob::Hit*>& cluster)
+  {
+    UpdateUnwrapTable(detProp);
 
+    fUnwrappedHits.clear();
+    fUnwrappedHits.reserve(cluster.size());
+    for(const recob::Hit* hit : cluster)
+    {
+      UnwrappedHit unwrapped;
+      if(!GetGlobalWireTDC(*hit, unwrapped.wire, unwrapped.plane, unwrapped.tdc)) continue;
+      unwrapped.pe = hit->Integral();
+      fUnwrappedHits.push_back(unwrapped);
     }
-    return pm;
+  }
+
+  bool PixelMapProducer::GetGlobalWireTDC(const recob::Hit& hit,
+                                          unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const
+  {
+    const geo::WireID& wireid = hit.WireID();
+    const size_t index = 3*wireid.TPC + wireid.Plane;
+    if(wireid.Plane > 2 || index >= fUnwrapTable.size()) return false;
+
+    const UnwrapEntry& entry = fUnwrapTable[index];
+    if(entry.skip) return false;
+
+    globalPlane = entry.plane;
+    if(entry.wireMap.empty()) globalWire = entry.wireOffset + entry.wireSign*(int)wireid.Wire;
+    else if(wireid.Wire < entry.wireMap.size()) globalWire = entry.wireMap[wireid.Wire];
+    else return false;
+    globalTDC = entry.tdcOffset + entry.tdcSign*hit.PeakTime();
+    return true;
   }
 
   std::ostream& operator<<(std::ostream& os, const PixelMapProducer& p)
@@ -173,93 +326,41 @@ namespace cvn
   Boundary PixelMapProducer::DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
                                             const std::vector< const recob::Hit*>& cluster)
   {
+    UnwrapHits(detProp, cluster);
+    return DefineBoundary(fUnwrappedHits);
+  }
 
-    std::vector<double> time_0;
-    std::vector<double> time_1;
-    std::vector<double> time_2;
-    //std::vector<int> wire;
+  Boundary PixelMapProducer::DefineBoundary(const std::vector<UnwrappedHit>& hits) const
+  {
 
-    std::vector<int> wire_0;
-    std::vector<int> wire_1;
-    std::vector<int> wire_2;
-    
+    // Running sums and minima per view, in hit order
+    double tsum[3] = {0., 0., 0.};
+    unsigned int nhits[3] = {0, 0, 0};
+    int minwire[3] = {0, 0, 0};
 
-    for(size_t iHit = 0; iHit < cluster.size(); ++iHit)
+    for(const UnwrappedHit& hit : hits)
     {
-      geo::WireID wireid = cluster[iHit]->WireID();
-      
-      unsigned int globalWire = wireid.Wire;
-      unsigned int globalPlane = wireid.Plane;
-      double globalTime = cluster[iHit]->PeakTime();
-      if(!fProtoDUNE){
-        if(fUnwrapped == 1) {
-          if (fGeometry->DetectorName() == "dune10kt_v1") {
-            if (wireid.TPC%6 == 0 or wireid.TPC%6 == 5) continue; // Skip dummy TPCs in 10kt module
-            GetDUNE10ktGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),wireid.Plane,wireid.TPC,globalWire,globalPlane,globalTime);
-          }
-          else if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos){
-            GetDUNEVertDrift3ViewGlobalWire(wireid.Wire, wireid.Plane,wireid.TPC,globalWire,globalPlane);
-          }
-          else {
-            GetDUNEGlobalWireTDC(detProp, wireid.Wire,cluster[iHit]->PeakTime(),wireid.Plane,wireid.TPC,globalWire,globalPlane,globalTime);
-          }
-        }
-        else if(fUnwrapped == 2){
-          GetDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,globalWire,globalPlane);
-        }
-      }
-      else{
-        GetProtoDUNEGlobalWire(wireid.Wire,wireid.Plane,wireid.TPC,globalWire,globalPlane);
-      }
-
-      if(globalPlane==0){
-        time_0.push_back(globalTime);
-        wire_0.push_back(globalWire);
-      }
-      if(globalPlane==1){
-        time_1.push_back(globalTime);
-        wire_1.push_back(globalWire);
-      }
-      if(globalPlane==2){
-        time_2.push_back(globalTime);
-        wire_2.push_back(globalWire);
-      }
+      if(hit.plane > 2) continue;
+      tsum[hit.plane] += hit.tdc;
+      if(nhits[hit.plane] == 0 || (int)hit.wire < minwire[hit.plane]) minwire[hit.plane] = hit.wire;
+      ++nhits[hit.plane];
     }
 
-    double tsum_0 = std::accumulate(time_0.begin(), time_0.end(), 0.0);
-    double tmean_0 = tsum_0 / time_0.size();
-
-    double tsum_1 = std::accumulate(time_1.begin(), time_1.end(), 0.0);
-    double tmean_1 = tsum_1 / time_1.size();
-
-    double tsum_2 = std::accumulate(time_2.begin(), time_2.end(), 0.0);
-    double tmean_2 = tsum_2 / time_2.size();
-
-    std::cout << "Boundary wire vector sizes: " << wire_0.size() << ", " << wire_1.size() << ", " << wire_2.size() << std::endl;
-
-    auto minwireelement_0= std::min_element(wire_0.begin(), wire_0.end());
-    std::cout<<"minwire 0: "<<*minwireelement_0<<std::endl;
-    auto minwireelement_1= std::min_element(wire_1.begin(), wire_1.end());
-    std::cout<<"minwire 1: "<<*minwireelement_1<<std::endl;
-    auto minwireelement_2= std::min_element(wire_2.begin(), wire_2.end());
-    std::cout<<"minwire 2: "<<*minwireelement_2<<std::endl;
-
-    //auto maxwireelement_0= std::max_element(wire_0.begin(), wire_0.end());
-    //std::cout<<"maxwire 0: "<<*maxwireelement_0<<std::endl;
-    //auto maxwireelement_1= std::max_element(wire_1.begin(), wire_1.end());
-    //std::cout<<"maxwire 1: "<<*maxwireelement_1<<std::endl;
-    //auto maxwireelement_2= std::max_element(wire_2.begin(), wire_2.end());
-    //std::cout<<"maxwire 2: "<<*maxwireelement_2<<std::endl;
+    double tmean[3];
+    for(unsigned int view = 0; view < 3; ++view){
+      tmean[view] = tsum[view] / nhits[view];
+    }
 
+    std::cout << "Boundary wire vector sizes: " << nhits[0] << ", " << nhits[1] << ", " << nhits[2] << std::endl;
+    for(unsigned int view = 0; view < 3; ++view){
+      if(nhits[view] > 0) std::cout<<"minwire "<<view<<": "<<minwire[view]<<std::endl;
+    }
 
-    int minwire_0 = 0;
-    int minwire_1 = 0;
-    int minwire_2 = 0;
-    if(wire_0.size() > 0) minwire_0 = *minwireelement_0-1;
-    if(wire_1.size() > 0) minwire_1 = *minwireelement_1-1;
-    if(wire_2.size() > 0) minwire_2 = *minwireelement_2-1;
+    for(unsigned int view = 0; view < 3; ++view){
+      if(nhits[view] > 0) minwire[view] -= 1;
+    }
 
-    Boundary bound(fNWire,fTRes,minwire_0,minwire_1,minwire_2,tmean_0,tmean_1,tmean_2);
+    Boundary bound(fNWire,fTRes,minwire[0],minwire[1],minwire[2],tmean[0],tmean[1],tmean[2]);
 
     return bound;
   }
@@ -517,6 +618,9 @@ namespace cvn
       if(globalPlane == 0){
         start = std::lower_bound(fVDPlane0.begin(), fVDPlane0.end(), wire_intercept) - fVDPlane0.begin() - 1;
         end = std::upper_bound(fVDPlane0.begin(), fVDPlane0.end(), wire_intercept) - fVDPlane0.begin();
+        // Wires at the very edge of the plane would otherwise read outside the cache
+        start = std::max(start, 0);
+        end = std::min(end, (int)fVDPlane0.size() - 1);
         low_bound = fVDPlane0[start];
         upper_bound = fVDPlane0[end];
         diag_tpc = (start/2);
@@ -524,6 +628,8 @@ namespace cvn
       else{
         end = std::lower_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin() - 1;
         start = std::upper_bound(fVDPlane1.begin(), fVDPlane1.end(), wire_intercept) - fVDPlane1.begin();
+        end = std::max(end, 0);
+        start = std::min(start, (int)fVDPlane1.size() - 1);
         low_bound = fVDPlane1[end];
         upper_bound = fVDPlane1[start];
         diag_tpc = (nCRM_row-(end/2) - 1);
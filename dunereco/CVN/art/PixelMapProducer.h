@@ -33,8 +33,11 @@ namespace cvn
     PixelMapProducer(unsigned int nWire, unsigned int nTdc, double tRes);
     PixelMapProducer();
 
-    void SetUnwrapped(unsigned short unwrap){fUnwrapped = unwrap;};
-    void SetProtoDUNE(){fProtoDUNE = true;};
+    // Changing the unwrapping invalidates the lookup table
+    void SetUnwrapped(unsigned short unwrap){if(unwrap != fUnwrapped) fUnwrapTable.clear(); fUnwrapped = unwrap;};
+    void SetProtoDUNE(){if(!fProtoDUNE) fUnwrapTable.clear(); fProtoDUNE = true;};
+    /// Allocate the combined charge and truth arrays of the maps (training only)
+    void SetWithTruth(bool withTruth){fWithTruth = withTruth;};
 
     /// Get boundaries for pixel map representation of cluster
     Boundary DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -69,6 +72,18 @@ namespace cvn
                                     const std::vector< const recob::Hit* >& cluster,
                                     const Boundary& bound);
 
+    /// Create the same map as CreateMap in sorted sparse (COO) form: per view, the
+    /// (wire, tdc) pixel indices and charges of the non-empty pixels, ordered by
+    /// wire then tdc. The extent of the map is stored as {NWire, NTdc}.
+    SparsePixelMap CreateSparseMap(detinfo::DetectorPropertiesData const& detProp,
+                                   const std::vector< art::Ptr< recob::Hit > >& slice);
+    SparsePixelMap CreateSparseMap(detinfo::DetectorPropertiesData const& detProp,
+                                   const std::vector< const recob::Hit* >& slice);
+
+    SparsePixelMap CreateSparseMapGivenBoundary(detinfo::DetectorPropertiesData const& detProp,
+                                                const std::vector< const recob::Hit* >& cluster,
+                                                const Boundary& bound);
+
     /// Create sparse pixel map for SCN applications
     void GetHitTruth(detinfo::DetectorClocksData const& clockData,
                      art::Ptr<recob::Hit>& hit, std::vector<int>& pdgs, std::vector<int>& tracks,
@@ -80,11 +95,41 @@ namespace cvn
                                      std::vector< art::Ptr< recob::SpacePoint> >& sp, std::vector<std::vector<art::Ptr<recob::Hit>>>& hit);
 
   private:
+    /// Hit after unwrapping, as used to define and fill the maps
+    struct UnwrappedHit
+    {
+      unsigned int wire;
+      unsigned int plane;
+      double tdc;
+      double pe;
+    };
+
+    /// Unwrapping of one (TPC, plane): globalWire = wireOffset + wireSign*localWire
+    /// and globalTDC = tdcOffset + tdcSign*localTDC. The VD induction views are not
+    /// linear in the local wire, so they get a per-wire table instead.
+    struct UnwrapEntry
+    {
+      bool skip = false;           ///< Dummy TPC, hits are dropped
+      unsigned int plane = 0;      ///< Global plane
+      int wireOffset = 0;
+      int wireSign = 1;
+      double tdcOffset = 0.;
+      double tdcSign = 1.;
+      std::vector<unsigned int> wireMap; ///< Global wire of each local wire, if not linear
+    };
+
     unsigned int      fNWire;  ///< Number of wires, length for pixel maps
     unsigned int      fNTdc;   ///< Number of tdcs, width of pixel map
     double            fTRes;   ///< Timing resolution for pixel map
     unsigned short    fUnwrapped; ///< Use unwrapped pixel maps?
     bool              fProtoDUNE; ///< Do we want to use this for particle extraction from protoDUNE?
+    bool              fWithTruth; ///< Allocate the truth arrays of the pixel maps?
+    bool              fIs10kt;    ///< Geometry is the DUNE 10kt horizontal drift module
+    bool              fIsVD3View; ///< Geometry is a 3 view vertical drift module
+
+    std::vector<UnwrapEntry> fUnwrapTable; ///< Unwrapping of each (TPC, plane), index 3*tpc + plane
+    double            fUnwrapDriftVel;     ///< Drift velocity the table was built for
+    std::vector<UnwrappedHit> fUnwrappedHits; ///< Scratch space for the current cluster
 
     geo::GeometryCore const* fGeometry;
     std::vector<double> fVDPlane0;
@@ -92,6 +137,22 @@ namespace cvn
     // std::vector<int> fPlane0GapWires;
     // std::vector<int> fPlane1GapWires;
 
+    /// Build the unwrapping table from the Get*Global* functions, once per geometry,
+    /// unwrapping mode and drift velocity
+    void UpdateUnwrapTable(detinfo::DetectorPropertiesData const& detProp);
+
+    /// Unwrap a cluster in a single pass over its hits into fUnwrappedHits
+    void UnwrapHits(detinfo::DetectorPropertiesData const& detProp,
+                    const std::vector< const recob::Hit* >& cluster);
+
+    /// Unwrapped wire, plane and tdc of a hit, false if the hit should be skipped
+    bool GetGlobalWireTDC(const recob::Hit& hit,
+                          unsigned int& globalWire, unsigned int& globalPlane, double& globalTDC) const;
+
+    Boundary DefineBoundary(const std::vector<UnwrappedHit>& hits) const;
+    PixelMap FillMap(const std::vector<UnwrappedHit>& hits, const Boundary& bound) const;
+    SparsePixelMap FillSparseMap(const std::vector<UnwrappedHit>& hits, const Boundary& bound) const;
+
     double _getIntercept(geo::WireID wireid) const;
     void _cacheIntercepts();
   };
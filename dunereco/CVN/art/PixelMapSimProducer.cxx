@@ -35,6 +35,7 @@ namespace cvn
     fThreshold(threshold),
     fUnwrapped(2),
     fProtoDUNE(false),
+    fWithTruth(false),
     fTotHits(0)
   {
 
@@ -44,7 +45,8 @@ namespace cvn
     
   }
 
-  PixelMapSimProducer::PixelMapSimProducer()
+  PixelMapSimProducer::PixelMapSimProducer():
+    fWithTruth(false)
   {
     fGeometry = &*(art::ServiceHandle<geo::Geometry>());  
     if (fGeometry->DetectorName().find("dunevd10kt_3view") != std::string::npos)
@@ -73,7 +75,7 @@ namespace cvn
       const Boundary& bound)
   {
 
-    PixelMap pm(fNWire, fNTdc, bound);
+    PixelMap pm(fNWire, fNTdc, bound, fWithTruth);
     
     for(size_t iHit = 0; iHit < cluster.size(); ++iHit)
     {
@@ -34,6 +34,8 @@ namespace cvn
 
     void SetUnwrapped(unsigned short unwrap){fUnwrapped = unwrap;};
     void SetProtoDUNE(){fProtoDUNE = true;};
+    /// Allocate the combined charge and truth arrays of the maps (training only)
+    void SetWithTruth(bool withTruth){fWithTruth = withTruth;};
 
     /// Get boundaries for pixel map representation of cluster
     Boundary DefineBoundary(detinfo::DetectorPropertiesData const& detProp,
@@ -78,6 +80,7 @@ namespace cvn
     double            fThreshold; ///< charge threshold for each time tick, below which isn't added to pixel map
     unsigned short    fUnwrapped; ///< Use unwrapped pixel maps?
     bool              fProtoDUNE; ///< Do we want to use this for particle extraction from protoDUNE?
+    bool              fWithTruth; ///< Allocate the truth arrays of the pixel maps?
 
     unsigned int fTotHits;  ///<How many ROIs above threshold?
 
@@ -8,6 +8,8 @@
 
 #include  <iostream>
 #include  <string>
+#include  <algorithm>
+#include  <chrono>
 #include "cetlib/getenv.h"
 
 #include "canvas/Utilities/Exception.h"
@@ -19,23 +21,49 @@
 namespace cvn
 {
 
-  TFNetHandler::TFNetHandler(const fhicl::ParameterSet& pset):
+  // Upper edges of the batch latency histogram bins in ms, the last bin is overflow
+  const std::vector<double> TFNetHandler::fLatencyEdges = {1., 2., 5., 10., 20., 50., 100., 200., 500., 1000., 2000., 5000.};
+
+  TFNetHandler::TFNetHandler(const fhicl::ParameterSet& pset, bool multipleMaps):
     fLibPath(cet::getenv(pset.get<std::string>("LibPath", ""))),
     fTFProtoBuf  (fLibPath+"/"+pset.get<std::string>("TFProtoBuf")),
     fUseLogChargeScale(pset.get<bool>("ChargeLogScale")),
     fImageWires(pset.get<unsigned int>("NImageWires")),
     fImageTDCs(pset.get<unsigned int>("NImageTDCs")),
-    fReverseViews(pset.get<std::vector<bool> >("ReverseViews"))
+    fReverseViews(pset.get<std::vector<bool> >("ReverseViews")),
+    fMaxBatchSize(multipleMaps ? std::max(1u, pset.get<unsigned int>("MaxBatchSize", 1)) : 1),
+    fProductionMode(pset.get<bool>("ProductionMode", false)),
+    fSummaryInterval(pset.get<unsigned int>("SummaryInterval", 100)),
+    fNBatches(0),
+    fNMaps(0),
+    fNRetries(0),
+    fNSaturated(0),
+    fLatencyHist(fLatencyEdges.size() + 1, 0)
   {
 
     // Construct the TF Graph object. The empty vector {} is used since the protobuf
     // file gives the names of the output layer nodes
     mf::LogInfo("TFNetHandler") << "Loading network: " << fTFProtoBuf << std::endl;
-    fTFGraph = tf::Graph::create(fTFProtoBuf.c_str(),{},pset.get<int>("NInputs"),pset.get<int>("NOutputs"));
+    // Handlers using the same file and thread counts share one session
+    fTFGraph = tf::Graph::create(fTFProtoBuf.c_str(),{},pset.get<int>("NInputs"),pset.get<int>("NOutputs"),
+                                 pset.get<int>("IntraOpThreads", 1),pset.get<int>("InterOpThreads", 1));
     if(!fTFGraph){
-      art::Exception(art::errors::Unknown) << "Tensorflow model not found or incorrect";
+      throw art::Exception(art::errors::Unknown) << "Tensorflow model not found or incorrect";
+    }
+    // The images are fed either as one interleaved tensor or as a tensor per view
+    if(fTFGraph->n_inputs != 1 && fTFGraph->n_inputs != 3){
+      throw art::Exception(art::errors::Configuration)
+        << "Tensorflow model " << fTFProtoBuf << " has " << fTFGraph->n_inputs << " inputs, only 1 or 3 are supported";
     }
 
+    // Configure the image utility  
+    fImageUtils.SetViewReversal(fReverseViews);
+    fImageUtils.SetImageSize(fImageWires,fImageTDCs,3);
+    fImageUtils.SetLogScale(fUseLogChargeScale);
+
+    // The input tensors are allocated once and reused for every batch
+    fTFGraph->reserve_batch(fMaxBatchSize,fImageWires,fImageTDCs,3);
+
   }
  
   // Check the network outputs
@@ -68,52 +96,185 @@ namespace cvn
 
   std::vector< std::vector<float> > TFNetHandler::Predict(const PixelMap& pm)
   {
-   
-    CVNImageUtils imageUtils;
+    std::vector<Result> cvnResults = Predict(std::vector<const PixelMap*>{&pm});
+    if(cvnResults.empty()) return std::vector< std::vector<float> >();
+    return cvnResults[0].fOutput;
+  }
 
-    // Configure the image utility  
-    imageUtils.SetViewReversal(fReverseViews);
-    imageUtils.SetImageSize(fImageWires,fImageTDCs,3);
-    imageUtils.SetLogScale(fUseLogChargeScale);
+  template <class T>
+  std::vector<Result> TFNetHandler::PredictBatches(const std::vector<const T*>& pms)
+  {
+    std::vector<Result> allResults;
+    allResults.reserve(pms.size());
 
-    ImageVectorF thisImage;
-    imageUtils.ConvertPixelMapToImageVectorF(pm,thisImage);
-    std::vector<ImageVectorF> vecForTF;
+    // Fill the reusable input tensors and flush them whenever they are full
+    unsigned int nPending = 0;
+    for(unsigned int p = 0; p < pms.size(); ++p){
+      FillBatchSlot(*pms[p], nPending);
+      ++nPending;
+      if(nPending == fMaxBatchSize || p == pms.size() - 1){
+        std::vector<bool> saturated;
+        std::vector< std::vector< std::vector<float> > > batchResults = RunBatch(nPending, saturated);
+        if(batchResults.size() != nPending){
+          mf::LogError("TFNetHandler") << "Expected " << nPending << " results from the network but got " << batchResults.size() << std::endl;
+          batchResults.resize(nPending);
+          saturated.resize(nPending, false);
+        }
+        for(unsigned int s = 0; s < nPending; ++s){
+          allResults.emplace_back(batchResults[s]);
+          allResults.back().SetSaturated(saturated[s]);
+        }
+        nPending = 0;
+      }
+    }
 
-    vecForTF.push_back(thisImage);
+    return allResults;
+  }
 
-    std::vector< std::vector< std::vector< float > > > cvnResults; // shape(samples, #outputs, output_size)
-    bool status = false;
+  std::vector<Result> TFNetHandler::Predict(const std::vector<const PixelMap*>& pms)
+  {
+    return PredictBatches(pms);
+  }
 
-    int counter = 0;
+  std::vector<Result> TFNetHandler::Predict(const std::vector<const SparsePixelMap*>& pms)
+  {
+    return PredictBatches(pms);
+  }
 
-    do{ // do until it gets a correct result
-        // std::cout << "Number of CVN result vectors " << cvnResults.size() << " with " << cvnResults[0].size() << " categories" << std::endl;
-        cvnResults = fTFGraph->run(vecForTF);
-        status = check(cvnResults[0]);
-        //std::cout << "Status: " << status << std::endl;
-        counter++;
+  TFNetHandler::Summary& TFNetHandler::Summary::operator+=(const Summary& other)
+  {
+    nBatches   += other.nBatches;
+    nMaps      += other.nMaps;
+    nRetries   += other.nRetries;
+    nSaturated += other.nSaturated;
+    if(latencyHist.size() < other.latencyHist.size()) latencyHist.resize(other.latencyHist.size(), 0);
+    for(unsigned int b = 0; b < other.latencyHist.size(); ++b) latencyHist[b] += other.latencyHist[b];
+    return *this;
+  }
+
+  TFNetHandler::Summary TFNetHandler::GetSummary() const
+  {
+    Summary summary;
+    summary.nBatches    = fNBatches;
+    summary.nMaps       = fNMaps;
+    summary.nRetries    = fNRetries;
+    summary.nSaturated  = fNSaturated;
+    summary.latencyHist = fLatencyHist;
+    return summary;
+  }
+
+  void TFNetHandler::PrintSummary(const Summary& summary)
+  {
+    mf::LogInfo log("TFNetHandler");
+    log << "Inference summary: " << summary.nMaps << " pixel maps in " << summary.nBatches << " batches, "
+        << summary.nRetries << " batch reruns, " << summary.nSaturated << " saturated results\n";
+    log << "Batch latency (ms):";
+    for(unsigned int b = 0; b < summary.latencyHist.size(); ++b){
+      if(b < fLatencyEdges.size()) log << " <" << fLatencyEdges[b] << ": " << summary.latencyHist[b] << ",";
+      else log << " >=" << fLatencyEdges.back() << ": " << summary.latencyHist[b];
+    }
+  }
+
+  void TFNetHandler::FillBatchSlot(const PixelMap& pm, unsigned int slot)
+  {
+    // Single-input networks take one NHWC tensor, multi-input ones a tensor per view.
+    // Either way the image is written straight into the tensor memory.
+    if(fTFGraph->n_inputs == 1){
+      fImageUtils.ConvertPixelMapToBuffer(pm, ImageViewF::Interleaved(fTFGraph->batch_input(0, slot), fImageTDCs, 3));
+    }
+    else if(fTFGraph->n_inputs == 3){
+      fImageUtils.ConvertPixelMapToBuffer(pm, ImageViewF::Planar(fTFGraph->batch_input(0, slot),
+                                                                 fTFGraph->batch_input(1, slot),
+                                                                 fTFGraph->batch_input(2, slot), fImageTDCs));
+    }
+    else{
+      throw art::Exception(art::errors::LogicError) << "Unsupported number of network inputs " << fTFGraph->n_inputs;
+    }
+  }
+
+  void TFNetHandler::FillBatchSlot(const SparsePixelMap& pm, unsigned int slot)
+  {
+    if(fTFGraph->n_inputs == 1){
+      fImageUtils.ConvertSparsePixelMapToBuffer(pm, ImageViewF::Interleaved(fTFGraph->batch_input(0, slot), fImageTDCs, 3));
+    }
+    else if(fTFGraph->n_inputs == 3){
+      fImageUtils.ConvertSparsePixelMapToBuffer(pm, ImageViewF::Planar(fTFGraph->batch_input(0, slot),
+                                                                       fTFGraph->batch_input(1, slot),
+                                                                       fTFGraph->batch_input(2, slot), fImageTDCs));
+    }
+    else{
+      throw art::Exception(art::errors::LogicError) << "Unsupported number of network inputs " << fTFGraph->n_inputs;
+    }
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::TimedRun(unsigned int nMaps)
+  {
+    auto start = std::chrono::steady_clock::now();
+    std::vector< std::vector< std::vector< float > > > cvnResults = fTFGraph->run_batch(nMaps);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned int bin = std::upper_bound(fLatencyEdges.begin(), fLatencyEdges.end(), ms) - fLatencyEdges.begin();
+    ++fLatencyHist[bin];
+    ++fNBatches;
+
+    return cvnResults;
+  }
+
+  std::vector< std::vector< std::vector<float> > > TFNetHandler::RunBatch(unsigned int nMaps, std::vector<bool>& saturated)
+  {
+    std::vector< std::vector< std::vector< float > > > cvnResults = TimedRun(nMaps); // shape(samples, #outputs, output_size)
+    saturated.assign(nMaps, false);
+    if(cvnResults.size() != nMaps) return cvnResults;
+    fNMaps += nMaps;
+
+    std::vector<bool> status(nMaps);
+    for(unsigned int s = 0; s < nMaps; ++s) status[s] = check(cvnResults[s]);
+
+    // Rerun the batch until every map gets a correct result, only keeping the new
+    // outputs for the maps that were still failing. Production mode skips this
+    // and simply flags the saturated results.
+    int counter = 1;
+    while(!fProductionMode && std::find(status.begin(), status.end(), false) != status.end()){
         if(counter==10){
-            std::cout << "Error, CVN never outputing a correct result. Filling result with zeros.";
-            std::cout << std::endl;
-            fillEmpty(cvnResults[0]);
+            mf::LogWarning("TFNetHandler") << "CVN never outputing a correct result. Filling result with -3.";
+            for(unsigned int s = 0; s < nMaps; ++s){
+              if(!status[s]) fillEmpty(cvnResults[s]);
+            }
             break;
         }
-    }while(status == false);
+        std::vector< std::vector< std::vector< float > > > rerunResults = TimedRun(nMaps);
+        counter++;
+        ++fNRetries;
+        if(rerunResults.size() != nMaps) continue;
+        for(unsigned int s = 0; s < nMaps; ++s){
+          if(status[s]) continue;
+          cvnResults[s] = rerunResults[s];
+          status[s] = check(cvnResults[s]);
+        }
+    }
 
-    std::cout << "Classifier summary: ";
-    std::cout << std::endl;
-    int output_index = 0;
-    for(auto const & output : cvnResults[0])
-    {
-      std::cout << "Output " << output_index++ << ": ";
-      for(auto const v : output)
-          std::cout << v << ", ";
-      std::cout << std::endl;
+    for(unsigned int s = 0; s < nMaps; ++s){
+      saturated[s] = !status[s];
+      if(saturated[s]) ++fNSaturated;
+    }
+
+    // Only log the outputs of one batch in every fSummaryInterval
+    if(fSummaryInterval > 0 && (fNBatches - 1) % fSummaryInterval == 0){
+      mf::LogDebug log("TFNetHandler");
+      log << "Classifier summary for batch " << fNBatches << ":\n";
+      for(auto const & sampleResults : cvnResults){
+        int output_index = 0;
+        for(auto const & output : sampleResults)
+        {
+          log << "Output " << output_index++ << ": ";
+          for(auto const v : output)
+              log << v << ", ";
+          log << "\n";
+        }
+      }
     }
-    std::cout << std::endl;
 
-    return cvnResults[0];
+    return cvnResults;
   }
 
   /* 
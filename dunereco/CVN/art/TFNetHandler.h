@@ -11,7 +11,10 @@
 #include <memory>
 
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SparsePixelMap.h"
 #include "dunereco/CVN/func/InteractionType.h"
+#include "dunereco/CVN/func/Result.h"
+#include "dunereco/CVN/func/CVNImageUtils.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "dunereco/CVN/tf/tf_graph.h"
 
@@ -23,8 +26,10 @@ namespace cvn
   {
   public:
 
-    /// Constructor which takes a pset with DeployProto and ModelFile fields
-    TFNetHandler(const fhicl::ParameterSet& pset);
+    /// Constructor which takes a pset with DeployProto and ModelFile fields.
+    /// Without multipleMaps only one map is evaluated per call, so a single
+    /// batch slot is reserved whatever MaxBatchSize says.
+    TFNetHandler(const fhicl::ParameterSet& pset, bool multipleMaps = true);
 
     /// Number of outputs in neural net
     int NOutput() const;
@@ -35,6 +40,33 @@ namespace cvn
     /// Return prediction arrays for PixelMap
     std::vector< std::vector<float> > Predict(const PixelMap& pm);
 
+    /// Return a Result for each PixelMap, evaluated in batches of up to
+    /// fMaxBatchSize maps per session call. Results are in the input order.
+    std::vector<Result> Predict(const std::vector<const PixelMap*>& pms);
+
+    /// Same as above for sparse maps from PixelMapProducer::CreateSparseMap,
+    /// which are only made dense inside the input tensors
+    std::vector<Result> Predict(const std::vector<const SparsePixelMap*>& pms);
+
+    /// Per-job inference counters and latency histogram
+    struct Summary
+    {
+      unsigned int nBatches = 0;   ///< Number of session calls
+      unsigned int nMaps = 0;      ///< Number of pixel maps evaluated
+      unsigned int nRetries = 0;   ///< Number of batch reruns due to saturated outputs
+      unsigned int nSaturated = 0; ///< Number of results left saturated
+      std::vector<unsigned int> latencyHist; ///< Session call latency counts
+
+      /// Add the counts of another handler, e.g. the one of another schedule
+      Summary& operator+=(const Summary& other);
+    };
+
+    /// Counters of this handler
+    Summary GetSummary() const;
+
+    /// Report the inference counters and latency histogram of one or more handlers
+    static void PrintSummary(const Summary& summary);
+
     /// Return four element vector with summed numu, nue, nutau and NC elements
     std::vector<float> PredictFlavour(const PixelMap& pm);
 
@@ -46,7 +78,31 @@ namespace cvn
     unsigned int fImageWires;  ///< Number of wires for the network to classify
     unsigned int fImageTDCs;   ///< Number of tdcs for the network to classify
     std::vector<bool> fReverseViews; ///< Do we need to reverse any views?
+    unsigned int fMaxBatchSize; ///< Maximum number of maps per session call
+    bool         fProductionMode; ///< Run once and flag saturated outputs instead of rerunning
+    unsigned int fSummaryInterval; ///< Log the outputs of one batch in every fSummaryInterval
+
+    unsigned int fNBatches;   ///< Number of session calls
+    unsigned int fNMaps;      ///< Number of pixel maps evaluated
+    unsigned int fNRetries;   ///< Number of batch reruns due to saturated outputs
+    unsigned int fNSaturated; ///< Number of results left saturated
+    std::vector<unsigned int> fLatencyHist; ///< Session call latency counts
+    static const std::vector<double> fLatencyEdges; ///< Latency bin upper edges in ms
     std::unique_ptr<tf::Graph> fTFGraph; ///< Tensorflow graph
+    CVNImageUtils fImageUtils; ///< Image maker, configured once in the constructor
+
+    /// Fill one slot of the graph's reusable input tensors with a PixelMap
+    void FillBatchSlot(const PixelMap& pm, unsigned int slot);
+    void FillBatchSlot(const SparsePixelMap& pm, unsigned int slot);
+
+    /// Fill and run the batches for a list of dense or sparse maps
+    template <class T> std::vector<Result> PredictBatches(const std::vector<const T*>& pms);
+
+    /// Run the graph on the first nMaps slots of the input tensors, flagging saturated outputs
+    std::vector< std::vector< std::vector<float> > > RunBatch(unsigned int nMaps, std::vector<bool>& saturated);
+
+    /// Single session call, recorded in the latency histogram
+    std::vector< std::vector< std::vector<float> > > TimedRun(unsigned int nMaps);
 
   };
 
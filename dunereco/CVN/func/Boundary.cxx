@@ -42,7 +42,7 @@ namespace cvn
     assert(fLastWire[2] - fFirstWire[2] == nWire - 1);
   }
 
-  bool Boundary::IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view)
+  bool Boundary::IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view) const
   {
     bool inWireRcvne = (int) wire >= fFirstWire[view] && (int) wire <= fLastWire[view];
     bool inTDCRcvne = (double) cell >= fFirstTDC[view] &&
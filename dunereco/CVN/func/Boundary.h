@@ -39,7 +39,7 @@ namespace cvn
 
     Boundary(){};
 
-    bool IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view);
+    bool IsWithin(const unsigned int& wire, const double& cell, const unsigned int& view) const;
 
     int FirstWire(const unsigned int& view) const {return fFirstWire[view];};
     int LastWire(const unsigned int& view) const {return fLastWire[view];};
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
 #include "dunereco/CVN/func/CVNImageUtils.h"
+#include "canvas/Utilities/Exception.h"
 
 cvn::CVNImageUtils::CVNImageUtils(){
   // Set a default image size
@@ -317,6 +319,140 @@ void cvn::CVNImageUtils::ConvertPixelArrayToImageVectorF(const std::vector<unsig
 
 }
 
+cvn::ImageViewF cvn::ImageViewF::Interleaved(float* buffer, unsigned int nTDCs, unsigned int nViews){
+
+  return ImageViewF{{buffer, buffer + 1, buffer + 2}, std::size_t(nTDCs) * nViews, nViews};
+
+}
+
+cvn::ImageViewF cvn::ImageViewF::Planar(float* view0, float* view1, float* view2, unsigned int nTDCs){
+
+  return ImageViewF{{view0, view1, view2}, nTDCs, 1};
+
+}
+
+void cvn::CVNImageUtils::ConvertPixelMapToBuffer(const PixelMap &pm, const cvn::ImageViewF &image){
+
+  SetPixelMapSize(pm.fNWire,pm.fNTdc);
+
+  const std::vector<float>* charges[3] = {&pm.fPEX, &pm.fPEY, &pm.fPEZ};
+
+  for (unsigned int view = 0; view < fNViews; ++view){
+
+    const float* pe = charges[view]->data();
+    float* out = image.data[view];
+
+    // Reversed views are read back to front rather than copied
+    const bool reverse = fViewReverse[view];
+    auto mapWire = [&](unsigned int wire){ return reverse ? fPixelMapWires - wire - 1 : wire; };
+
+    // Integrated charge for each wire and each tdc, in a single pass
+    fWireCharges.assign(fPixelMapWires, 0.);
+    fTDCCharges.assign(fPixelMapTDCs, 0.);
+    for (unsigned int wire = 0; wire < fPixelMapWires; ++wire){
+      const float* wirePE = pe + fPixelMapTDCs * mapWire(wire);
+      float totCharge = 0;
+      for (unsigned int time = 0; time < fPixelMapTDCs; ++time){
+        totCharge += wirePE[time];
+        fTDCCharges[time] += wirePE[time];
+      }
+      fWireCharges[wire] = totCharge;
+    }
+
+    unsigned int startWire = 0;
+    unsigned int endWire = fNWires;
+    unsigned int startTDC = 0;
+    unsigned int endTDC = fNTDCs;
+    if(!fDisableRegionSelection){
+      GetMinMaxWires(fWireCharges,startWire,endWire);
+      GetMinMaxTDCs(fTDCCharges,startTDC,endTDC);
+    }
+
+    // Write the image, padding with zeros wherever the region runs off the pixel map
+    for (unsigned int wire = 0; wire < fNWires; ++wire){
+      float* outWire = out + wire * image.wireStride;
+      const unsigned int pmWire = startWire + wire;
+      if(pmWire >= fPixelMapWires){
+        for (unsigned int time = 0; time < fNTDCs; ++time) outWire[time * image.tdcStride] = 0.;
+        continue;
+      }
+      const float* wirePE = pe + fPixelMapTDCs * mapWire(pmWire);
+      for (unsigned int time = 0; time < fNTDCs; ++time){
+        const unsigned int pmTDC = startTDC + time;
+        outWire[time * image.tdcStride] = (pmTDC < fPixelMapTDCs) ? ConvertChargeToFloat(wirePE[pmTDC]) : 0.f;
+      }
+    }
+  }
+
+}
+
+void cvn::CVNImageUtils::ConvertSparsePixelMapToBuffer(const SparsePixelMap &pm, const cvn::ImageViewF &image){
+
+  const std::vector<unsigned int> extent = pm.GetExtent();
+  if(pm.GetDim() != 2 || extent.size() != 2 || pm.GetViews() < fNViews){
+    throw art::Exception(art::errors::LogicError)
+      << "Sparse pixel map must have (wire, tdc) coordinates, a fixed extent and "
+      << fNViews << " views to be converted to an image";
+  }
+
+  SetPixelMapSize(extent[0],extent[1]);
+
+  for (unsigned int view = 0; view < fNViews; ++view){
+
+    // Pixels are sorted by wire and then tdc
+    const std::vector<std::vector<float> > &coords = pm.GetCoordinates(view);
+    const std::vector<std::vector<float> > &features = pm.GetFeatures(view);
+    const size_t nPixels = coords.size();
+    float* out = image.data[view];
+
+    const bool reverse = fViewReverse[view];
+    auto mapWire = [&](unsigned int wire){ return reverse ? fPixelMapWires - wire - 1 : wire; };
+
+    // Integrated charge for each wire and each tdc. The tdc sums follow the
+    // image wire order so that they match the dense version exactly.
+    fWireCharges.assign(fPixelMapWires, 0.);
+    fTDCCharges.assign(fPixelMapTDCs, 0.);
+    for (size_t p = 0; p < nPixels; ++p){
+      fWireCharges[mapWire(coords[p][0])] += features[p][0];
+    }
+    for (size_t i = 0; i < nPixels; ++i){
+      const size_t p = reverse ? nPixels - i - 1 : i;
+      fTDCCharges[static_cast<unsigned int>(coords[p][1])] += features[p][0];
+    }
+
+    unsigned int startWire = 0;
+    unsigned int endWire = fNWires;
+    unsigned int startTDC = 0;
+    unsigned int endTDC = fNTDCs;
+    if(!fDisableRegionSelection){
+      GetMinMaxWires(fWireCharges,startWire,endWire);
+      GetMinMaxTDCs(fTDCCharges,startTDC,endTDC);
+    }
+
+    // Zero the image and scatter the pixels that fall inside the region
+    for (unsigned int wire = 0; wire < fNWires; ++wire){
+      float* outWire = out + wire * image.wireStride;
+      for (unsigned int time = 0; time < fNTDCs; ++time) outWire[time * image.tdcStride] = 0.;
+    }
+    for (size_t p = 0; p < nPixels; ++p){
+      const unsigned int wire = mapWire(coords[p][0]);
+      const unsigned int time = coords[p][1];
+      if(wire < startWire || wire - startWire >= fNWires) continue;
+      if(time < startTDC || time - startTDC >= fNTDCs) continue;
+      out[(wire - startWire) * image.wireStride + (time - startTDC) * image.tdcStride] = ConvertChargeToFloat(features[p][0]);
+    }
+  }
+
+}
+
+float cvn::CVNImageUtils::ConvertChargeToFloat(float charge){
+
+  // Most pixels are empty, so avoid the log and ceil for those
+  if(charge == 0.) return 0.;
+  return static_cast<float>(ConvertChargeToChar(charge));
+
+}
+
 void cvn::CVNImageUtils::GetMinMaxWires(std::vector<float> &wireCharges, unsigned int &minWire, unsigned int &maxWire){
 
   minWire = 0;
@@ -7,9 +7,12 @@
 #ifndef CVN_IMAGE_UTILS_H
 #define CVN_IMAGE_UTILS_H
 
+#include <array>
+#include <cstddef>
 #include <vector>
 
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SparsePixelMap.h"
 
 namespace cvn
 {
@@ -20,6 +23,22 @@ namespace cvn
   typedef std::vector<std::vector<float> > ViewVectorF;
   typedef std::vector<ViewVectorF> ImageVectorF;
 
+  /// Flat, strided view onto a caller-owned float image. Pixel (wire, tdc) of
+  /// view v lives at data[v] + wire*wireStride + tdc*tdcStride, which covers
+  /// both an interleaved NHWC buffer and one planar buffer per view.
+  struct ImageViewF
+  {
+    std::array<float*, 3> data;
+    std::size_t wireStride;
+    std::size_t tdcStride;
+
+    /// Interleaved <wires, TDCs, views> layout, as used by single-input networks
+    static ImageViewF Interleaved(float* buffer, unsigned int nTDCs, unsigned int nViews);
+
+    /// One <wires, TDCs> plane per view, as used by multi-input networks
+    static ImageViewF Planar(float* view0, float* view1, float* view2, unsigned int nTDCs);
+  };
+
   /// Class containing some utility functions for all things CVN
   class CVNImageUtils
   {
@@ -74,6 +93,16 @@ namespace cvn
     /// Convert a pixel array into a ImageVectorF
     void ConvertPixelArrayToImageVectorF(const std::vector<unsigned char> &pixelArray, ImageVectorF &imageVec);
 
+    /// Write the cropped, scaled and view-reversed image of a pixel map straight into
+    /// a caller-supplied buffer of nWires x nTDCs pixels per view. Gives the same
+    /// values as ConvertPixelMapToImageVectorF without the intermediate copies.
+    void ConvertPixelMapToBuffer(const PixelMap &pm, const ImageViewF &image);
+
+    /// Sparse version of ConvertPixelMapToBuffer for maps made by
+    /// PixelMapProducer::CreateSparseMap. The region is selected from the list of
+    /// non-empty pixels, which are then scattered into the zeroed buffer.
+    void ConvertSparsePixelMapToBuffer(const SparsePixelMap &pm, const ImageViewF &image);
+
   private:
 
     /// Base function for conversion of the Pixel Map to our required output format
@@ -93,6 +122,9 @@ namespace cvn
     /// Funtion to actually reverse the view
     void ReverseView(std::vector<float> &peVec);
 
+    /// Convert the charge of a single pixel, skipping the scaling for empty pixels
+    float ConvertChargeToFloat(float charge);
+
     /// Convert a ViewVector into a ViewVectorF
     ViewVectorF ConvertViewVecToViewVecF(ViewVector view);
 
@@ -121,6 +153,10 @@ namespace cvn
     /// Use a log scale for charge?
     bool fUseLogScale;
 
+    /// Scratch space for the integrated wire and tdc charges, reused between images
+    std::vector<float> fWireCharges;
+    std::vector<float> fTDCCharges;
+
   };
 
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <ctime>
@@ -117,34 +118,25 @@ namespace cvn
 
   std::map<int,unsigned int> GCNFeatureUtils::GetAllNeighbours(art::Event const &evt, const float rangeCut, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
 
-    map<int,unsigned int> neighbourMap;
-
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      neighbourMap[sp0->ID()] = 0;
-
-      for(const Ptr<SpacePoint> sp1 : sps){
-
-        if(sp0->ID() == sp1->ID()) continue;
-
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
+    const SpacePointGrid grid(sps, rangeCut);
+    const vector<unsigned int> counts = GetAllNeighbours(grid, rangeCut);
 
-        if(dist < rangeCut){
-          ++neighbourMap[sp0->ID()];
-        }
-      }
+    map<int,unsigned int> neighbourMap;
+    for(unsigned int i = 0; i < sps.size(); ++i){
+      neighbourMap[sps[i]->ID()] = counts[i];
     }
     return neighbourMap;
   } // function GetAllNeighbours
 
+  std::vector<unsigned int> GCNFeatureUtils::GetAllNeighbours(const SpacePointGrid &grid, const float rangeCut) const{
+
+    vector<unsigned int> counts(grid.Size());
+    for(unsigned int i = 0; i < grid.Size(); ++i){
+      counts[i] = grid.CountWithin(i, rangeCut);
+    }
+    return counts;
+  }
+
   // Sometimes we might want to know the number of neighbours within various radii
   std::vector<std::map<int,unsigned int>> GCNFeatureUtils::GetNeighboursForRadii(art::Event const &evt, const std::vector<float>& rangeCuts, const std::string &spLabel) const{
     // Get the space points from the event and make the map
@@ -159,7 +151,8 @@ namespace cvn
   std::vector<std::map<int,unsigned int>> GCNFeatureUtils::GetNeighboursForRadii(art::Event const &evt,
     const std::vector<float>& rangeCuts, const std::map<unsigned int,art::Ptr<recob::SpacePoint>> &sps) const{
     std::vector<art::Ptr<recob::SpacePoint>> vec;
-    for(auto m : sps){
+    vec.reserve(sps.size());
+    for(auto const& m : sps){
       vec.push_back(m.second);
     }
     return GetNeighboursForRadii(evt, rangeCuts, vec);
@@ -167,32 +160,30 @@ namespace cvn
 
   std::vector<std::map<int,unsigned int>> GCNFeatureUtils::GetNeighboursForRadii(art::Event const &evt,
     const std::vector<float>& rangeCuts, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
-    std::vector<std::map<int,unsigned int>> result;
-    // Initialise a map for each range cut value
-    for(unsigned int m = 0; m < rangeCuts.size(); ++m){
-      result.push_back(map<int,unsigned int>());
-    }
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      for(auto &m : result){
-        m[sp0->ID()] = 0;
+
+    float maxCut = 0.;
+    for(const float cut : rangeCuts) maxCut = std::max(maxCut, cut);
+    const SpacePointGrid grid(sps, maxCut);
+    const vector<vector<unsigned int>> counts = GetNeighboursForRadii(grid, rangeCuts);
+
+    std::vector<std::map<int,unsigned int>> result(rangeCuts.size());
+    for(unsigned int r = 0; r < rangeCuts.size(); ++r){
+      for(unsigned int i = 0; i < sps.size(); ++i){
+        result[r][sps[i]->ID()] = counts[r][i];
       }
-      for(const Ptr<SpacePoint> sp1 : sps){
-        if(sp0->ID() == sp1->ID()) continue;
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-        // Fill the maps if we satify the criteria
-        for(unsigned int r = 0; r < rangeCuts.size(); ++r){
-          if(dist < rangeCuts[r]){
-            result[r][sp0->ID()] = result[r][sp0->ID()] + 1;
-          }
-        }
+    }
+    return result;
+  }
+
+  std::vector<std::vector<unsigned int>> GCNFeatureUtils::GetNeighboursForRadii(const SpacePointGrid &grid,
+    const std::vector<float>& rangeCuts) const{
+
+    vector<vector<unsigned int>> result(rangeCuts.size(), vector<unsigned int>(grid.Size()));
+    for(unsigned int i = 0; i < grid.Size(); ++i){
+      // One pass over the neighbourhood for all of the radii
+      const vector<unsigned int> counts = grid.CountWithin(i, rangeCuts);
+      for(unsigned int r = 0; r < rangeCuts.size(); ++r){
+        result[r][i] = counts[r];
       }
     }
     return result;
@@ -210,33 +201,28 @@ namespace cvn
 
   std::map<int,int> GCNFeatureUtils::GetNearestNeighbours(art::Event const &evt,
     const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
+
+    const SpacePointGrid grid(sps);
+    const vector<int> nearest = GetNearestNeighbours(grid);
+
+    // We want an entry even if there is no neighbour
     std::map<int,int> closestID;
-    std::map<int,float> closestDistance;
-    // Now loop over all of the space points and simultaneously fill our maps
-    // Get the space points from the event and make the map
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      closestID[sp0->ID()] = 0;
-      closestDistance[sp0->ID()] = 99999;
-      for(const Ptr<SpacePoint> sp1 : sps){
-        if(sp0->ID() == sp1->ID()) continue;
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-        if(dist < closestDistance[sp0->ID()]){
-          closestDistance[sp0->ID()] = dist;
-          closestID[sp0->ID()] = sp1->ID();
-        }
-      }
+    for(unsigned int i = 0; i < sps.size(); ++i){
+      closestID[sps[i]->ID()] = nearest[i] < 0 ? 0 : sps[nearest[i]]->ID();
     }
     return closestID;
   }
 
+  std::vector<int> GCNFeatureUtils::GetNearestNeighbours(const SpacePointGrid &grid) const{
+
+    vector<int> nearest(grid.Size(), -1);
+    for(unsigned int i = 0; i < grid.Size(); ++i){
+      const vector<unsigned int> n = grid.Nearest(i, 1);
+      if(!n.empty()) nearest[i] = n[0];
+    }
+    return nearest;
+  }
+
   // Get the two nearest neighbours to use for calcuation of angles between them and the node in question
   std::map<int,std::pair<int,int>> GCNFeatureUtils::GetTwoNearestNeighbours(art::Event const &evt,
     const std::string &spLabel) const{
@@ -252,7 +238,8 @@ namespace cvn
     const std::map<unsigned int, art::Ptr<recob::SpacePoint>> &sps) const{
 
     vector<Ptr<SpacePoint>> vec;
-    for(auto m : sps){
+    vec.reserve(sps.size());
+    for(auto const& m : sps){
       vec.push_back(m.second);
     }
     return GetTwoNearestNeighbours(evt,vec);
@@ -260,48 +247,30 @@ namespace cvn
 
   std::map<int,std::pair<int,int>> GCNFeatureUtils::GetTwoNearestNeighbours(art::Event const &evt,
     const std::vector<art::Ptr<recob::SpacePoint>> &sps) const{
-    std::map<int,int> closestID;
-    std::map<int,int> secondID;
-    // Now loop over all of the space points and simultaneously fill our maps
-    // Get the space points from the event and make the map
-    for(const Ptr<SpacePoint> sp0 : sps){
-      // We want an entry even if it ends up being zero
-      int thisSP = sp0->ID();
-      int closest = -1;
-      int second = -1;
-      float closestDist = 99999;
-      float secondDist = 99999;
-      for(const Ptr<SpacePoint> sp1 : sps){
-        if(thisSP == sp1->ID()) continue;
-        // For some reason we have to use arrays
-        const double *p0 = sp0->XYZ();
-        const double *p1 = sp1->XYZ();
-        // Get the distance between the points
-        const float dx = p1[0] - p0[0];
-        const float dy = p1[1] - p0[1];
-        const float dz = p1[2] - p0[2];
-        const float dist = sqrt(dx*dx + dy*dy + dz*dz);
-        if(dist < closestDist){
-          secondDist = closestDist;
-          closestDist = dist;
-          second = closest;
-          closest = sp1->ID();
-        }
-        else if(dist < secondDist){
-          secondDist = dist;
-          second = sp1->ID();
-        }
-      }
-      closestID.insert(std::make_pair(thisSP,closest));
-      secondID.insert(std::make_pair(thisSP,second));
-    }
+
+    const SpacePointGrid grid(sps);
+    const vector<pair<int,int>> nearest = GetTwoNearestNeighbours(grid);
+
     map<int,pair<int,int>> finalMap;
-    for(unsigned int m = 0; m < closestID.size(); ++m){
-      finalMap[m] = std::make_pair(closestID[m],secondID[m]);
+    for(unsigned int i = 0; i < sps.size(); ++i){
+      const int closest = nearest[i].first < 0 ? -1 : sps[nearest[i].first]->ID();
+      const int second = nearest[i].second < 0 ? -1 : sps[nearest[i].second]->ID();
+      finalMap[sps[i]->ID()] = std::make_pair(closest, second);
     }
     return finalMap;
   }
 
+  std::vector<std::pair<int,int>> GCNFeatureUtils::GetTwoNearestNeighbours(const SpacePointGrid &grid) const{
+
+    vector<pair<int,int>> nearest(grid.Size(), std::make_pair(-1, -1));
+    for(unsigned int i = 0; i < grid.Size(); ++i){
+      const vector<unsigned int> n = grid.Nearest(i, 2);
+      if(n.size() > 0) nearest[i].first = n[0];
+      if(n.size() > 1) nearest[i].second = n[1];
+    }
+    return nearest;
+  }
+
   // Get the angle and the dot product between the vector from the base node to its neighbours
   void GCNFeatureUtils::GetAngleAndDotProduct(const SpacePoint &baseNode,
     const SpacePoint &n1, const SpacePoint &n2, float &dotProduct, float &angle) const{
@@ -26,6 +26,7 @@ namespace detinfo {
 
 #include "dunereco/CVN/func/GCNGraph.h"
 #include "dunereco/CVN/func/PixelMap.h"
+#include "dunereco/CVN/func/SpacePointGrid.h"
 
 namespace cvn
 {
@@ -66,6 +67,14 @@ namespace cvn
     std::map<int,std::pair<int,int>> GetTwoNearestNeighbours(art::Event const &evt, const std::vector<art::Ptr<recob::SpacePoint>> &sps) const;
     std::map<int,std::pair<int,int>> GetTwoNearestNeighbours(art::Event const &evt, const std::map<unsigned int,art::Ptr<recob::SpacePoint>> &sps) const;
 
+    /// Versions of the above using a grid built once per event. The results are indexed
+    /// by the position of the space point in the grid, neighbours are also given as
+    /// positions, with -1 if there are not enough points.
+    std::vector<unsigned int> GetAllNeighbours(const SpacePointGrid &grid, const float rangeCut) const;
+    std::vector<std::vector<unsigned int>> GetNeighboursForRadii(const SpacePointGrid &grid, const std::vector<float>& rangeCuts) const;
+    std::vector<int> GetNearestNeighbours(const SpacePointGrid &grid) const;
+    std::vector<std::pair<int,int>> GetTwoNearestNeighbours(const SpacePointGrid &grid) const;
+
     /// Get the angle and the dot product between the vector from the base node to its neighbours
     void GetAngleAndDotProduct(const recob::SpacePoint &baseNode, const recob::SpacePoint &n1, const recob::SpacePoint &n2, float &dotProduct, float &angle) const;
 
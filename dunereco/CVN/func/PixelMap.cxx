@@ -13,31 +13,54 @@ namespace cvn
 {
 
   PixelMap::PixelMap(unsigned int nWire, unsigned int nTdc,
-                     const Boundary& bound):
+                     const Boundary& bound, bool withTruth):
   fNWire(nWire),
   fNTdc(nTdc),
-  fPE(nWire*nTdc),
   fPEX(nWire*nTdc),
   fPEY(nWire*nTdc),
   fPEZ(nWire*nTdc),
-  fPur(nWire*nTdc),
-  fPurX(nWire*nTdc),
-  fPurY(nWire*nTdc),
-  fPurZ(nWire*nTdc),
-  fLab(nWire*nTdc),
-  fLabX(nWire*nTdc),
-  fLabY(nWire*nTdc),
-  fLabZ(nWire*nTdc),
   fBound(bound)
-  { fTotHits = 0; }
+  {
+    fTotHits = 0;
+    if(withTruth) AllocateTruth();
+  }
 
-  void PixelMap::FillInputVector(float* input) const
+  void PixelMap::AllocateTruth()
   {
-    unsigned int i = 0;
+    if(HasTruth()) return;
 
-    for(const auto& pe:fPE){
-      input[i] = pe;
-      ++i;
+    const unsigned int nPixel = NPixel();
+    fPE.resize(nPixel);
+    for(unsigned int i = 0; i < nPixel; ++i){
+      fPE[i] = fPEX[i] + fPEY[i] + fPEZ[i];
+    }
+    fPur.assign(nPixel, 0.);
+    fPurX.assign(nPixel, 0.);
+    fPurY.assign(nPixel, 0.);
+    fPurZ.assign(nPixel, 0.);
+    fLab.assign(nPixel, kEmptyHit);
+    fLabX.assign(nPixel, kEmptyHit);
+    fLabY.assign(nPixel, kEmptyHit);
+    fLabZ.assign(nPixel, kEmptyHit);
+  }
+
+  float PixelMap::PE(unsigned int index) const
+  {
+    // Maps read from older files may have fPE without the truth arrays
+    if(!fPE.empty()) return fPE[index];
+    return fPEX[index] + fPEY[index] + fPEZ[index];
+  }
+
+  HitType PixelMap::Lab(unsigned int index) const
+  {
+    if(fLab.empty()) return kEmptyHit;
+    return fLab[index];
+  }
+
+  void PixelMap::FillInputVector(float* input) const
+  {
+    for(unsigned int i = 0; i < NPixel(); ++i){
+      input[i] = PE(i);
     }
 
   }
@@ -45,28 +68,33 @@ namespace cvn
 
   void PixelMap::Add(const unsigned int& wire, const double& tdc, const unsigned int& view, const double& pe)
   {
+    if(!fBound.IsWithin(wire, tdc, view)) return;
+
+    const unsigned int index = GlobalToIndexSingle(wire,tdc, view);
+    if(view==0) fPEX[index] += pe;//Why +=?
+    if(view==1) fPEY[index] += pe;
+    if(view==2) fPEZ[index] += pe;
+
+    // Truth arrays only exist for training maps
+    if(!HasTruth()) return;
+
     const HitType label = kEmptyHit;
     const double purity=0.0;
-    if(fBound.IsWithin(wire, tdc, view)){
-      fPE[GlobalToIndex(wire,tdc, view)] += pe;
-      fLab[GlobalToIndex(wire,tdc, view)] = label;
-      fPur[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      if(view==0){
-	fPEX[GlobalToIndexSingle(wire,tdc, view)] += pe;//Why +=?
-	fLabX[GlobalToIndexSingle(wire,tdc, view)] = label;
-	fPurX[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      }
-      if(view==1){
-	fPEY[GlobalToIndexSingle(wire,tdc, view)] += pe;
-	fLabY[GlobalToIndexSingle(wire,tdc, view)] = label;
-	fPurY[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      }
-     if(view==2){
-	fPEZ[GlobalToIndexSingle(wire,tdc, view)] += pe;
-	fLabZ[GlobalToIndexSingle(wire,tdc, view)] = label;
-	fPurZ[GlobalToIndexSingle(wire,tdc, view)] = purity;
-      }
-   }
+    fPE[index] += pe;
+    fLab[index] = label;
+    fPur[index] = purity;
+    if(view==0){
+      fLabX[index] = label;
+      fPurX[index] = purity;
+    }
+    if(view==1){
+      fLabY[index] = label;
+      fPurY[index] = purity;
+    }
+    if(view==2){
+      fLabZ[index] = label;
+      fPurZ[index] = purity;
+    }
   }
 
   unsigned int  PixelMap::GlobalToIndex(const unsigned int& wire,
@@ -85,7 +113,7 @@ namespace cvn
 
     unsigned int index = internalWire * fNTdc + internalTdc % fNTdc;
 
-    assert(index < fPE.size());
+    assert(index < NPixel());
 
     return index;
   }
@@ -95,7 +123,7 @@ namespace cvn
   {
     unsigned int index = wire * fNTdc + tdc % fNTdc;
 
-    assert(index < fPE.size());
+    assert(index < NPixel());
     return index;
   }
 
@@ -130,7 +158,7 @@ namespace cvn
       for(unsigned int iWire = 0; iWire < fNWire; iWire += 2)
       {
         unsigned int index = LocalToIndex(iWire, iTdc);
-        if( fPE[index] > 0)
+        if( PE(index) > 0)
         {
           std::cout << "*";
         }
@@ -148,7 +176,7 @@ namespace cvn
       for(unsigned int iWire = 1; iWire < fNWire; iWire += 2)
       {
         unsigned int index = LocalToIndex(iWire, iTdc);
-        if( fPE[index] > 0)
+        if( PE(index) > 0)
         {
           std::cout << "*";
         }
@@ -176,7 +204,7 @@ namespace cvn
       {
         // Add 1 to in each bin to skip underflow
         hist->SetBinContent(iWire+1, iTdc + fNTdc*(iWire%3) + 1,
-                            fPE[LocalToIndex(iWire, iTdc)]);
+                            PE(LocalToIndex(iWire, iTdc)));
 
       }
     }
@@ -196,7 +224,7 @@ namespace cvn
       {
         // Add 1 to in each bin to skip underflow
         hist->SetBinContent(iWire+1, iTdc + fNTdc*(iWire%3) + 1,
-                            (double)fLab[LocalToIndex(iWire, iTdc)]);
+                            (double)Lab(LocalToIndex(iWire, iTdc)));
 
       }
     }
@@ -22,7 +22,9 @@ namespace cvn
   class PixelMap
   {
   public:
-    PixelMap(unsigned int nWire, unsigned int nTdc, const Boundary& bound);
+    /// Only the per-view charge planes are allocated unless withTruth is set;
+    /// the combined charge, purity and label arrays are otherwise left empty.
+    PixelMap(unsigned int nWire, unsigned int nTdc, const Boundary& bound, bool withTruth = false);
     PixelMap(){ fTotHits = 0; };
 
     /// Length in wires
@@ -32,7 +34,19 @@ namespace cvn
     unsigned int NTdc() const {return fNTdc;};
 
     /// Total number of pixels in map
-    unsigned int NPixel() const {return fPE.size();};
+    unsigned int NPixel() const {return fNWire*fNTdc;};
+
+    /// Are the combined charge and truth arrays allocated?
+    bool HasTruth() const {return !fLab.empty();};
+
+    /// Allocate the combined charge and truth arrays, for training producers
+    void AllocateTruth();
+
+    /// Combined charge of a pixel, summed over the views for compact maps
+    float PE(unsigned int index) const;
+
+    /// Truth label of a pixel, kEmptyHit for compact maps
+    HitType Lab(unsigned int index) const;
 
     /// Map boundary
     Boundary Bound() const {return fBound;};
@@ -65,7 +79,7 @@ namespace cvn
 ;
 
     void SetTotHits(unsigned int tothits){ fTotHits = tothits; } 
-    unsigned int GetTotHits(){ return fTotHits; } 
+    unsigned int GetTotHits() const { return fTotHits; } 
     /// Draw pixel map to the screen.  This is pretty hokey and the aspect ratio
     /// is totally unrealistic.
     void Print() const;
@@ -18,7 +18,8 @@ namespace cvn
 {
 
   Result::Result(const float* output, unsigned int& nOutputs):
-  fOutput(1)
+  fOutput(1),
+  fSaturated(false)
   {
     fOutput[0].resize(nOutputs);
     for(size_t i = 0; i < nOutputs; ++i)
@@ -27,12 +28,15 @@ namespace cvn
     }
   }
 
-  Result::Result(const std::vector< std::vector<float> > output){
+  Result::Result(const std::vector< std::vector<float> > output):
+  fSaturated(false)
+  {
     fOutput = output; 
   }
 
   Result::Result():
-  fOutput()
+  fOutput(),
+  fSaturated(false)
   {}
 
   unsigned int Result::ArgMax(int output_n) const
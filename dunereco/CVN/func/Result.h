@@ -129,7 +129,12 @@ namespace cvn
     /// Number of outputs, i.e. size of vector
     unsigned int NOutput();
 
+    /// Were all of the outputs saturated at 0 or 1?
+    bool IsSaturated() const { return fSaturated; }
+    void SetSaturated(bool saturated) { fSaturated = saturated; }
+
     std::vector< std::vector<float> > fOutput;  ///< Vector of outputs from neural net
+    bool fSaturated;  ///< Network gave only 0/1 outputs for this input
 
   };
 }
@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    SpacePointGrid.cxx
+/// \brief   Uniform grid over space point positions for neighbour queries
+////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "dunereco/CVN/func/SpacePointGrid.h"
+
+namespace cvn
+{
+
+  namespace
+  {
+    // Cell coordinates are packed into 21 bits each
+    const int kMaxCells = 1 << 20;
+
+    // Largest squared distance whose float square root is below r, so that
+    // comparing squares gives the same answer as comparing rounded distances
+    float SquaredThreshold(float r)
+    {
+      float t = r * r;
+      while(t > 0.f && !(std::sqrt(t) < r)) t = std::nextafter(t, 0.f);
+      while(std::sqrt(std::nextafter(t, std::numeric_limits<float>::max())) < r){
+        t = std::nextafter(t, std::numeric_limits<float>::max());
+      }
+      return t;
+    }
+  }
+
+  SpacePointGrid::SpacePointGrid(const std::vector<art::Ptr<recob::SpacePoint>>& sps, float cellSize)
+  {
+    fPositions.reserve(sps.size());
+    for(const art::Ptr<recob::SpacePoint>& sp : sps){
+      const double *p = sp->XYZ();
+      fPositions.push_back({p[0], p[1], p[2]});
+    }
+    Build(cellSize);
+  }
+
+  SpacePointGrid::SpacePointGrid(const std::vector<std::array<double,3>>& positions, float cellSize):
+    fPositions(positions)
+  {
+    Build(cellSize);
+  }
+
+  void SpacePointGrid::Build(float cellSize)
+  {
+    fMin = {0., 0., 0.};
+    std::array<double,3> max = {0., 0., 0.};
+    if(!fPositions.empty()){
+      fMin = max = fPositions.front();
+      for(const std::array<double,3>& p : fPositions){
+        for(unsigned int d = 0; d < 3; ++d){
+          fMin[d] = std::min(fMin[d], p[d]);
+          max[d] = std::max(max[d], p[d]);
+        }
+      }
+    }
+
+    double maxExtent = 0.;
+    double volume = 1.;
+    for(unsigned int d = 0; d < 3; ++d){
+      double extent = max[d] - fMin[d];
+      maxExtent = std::max(maxExtent, extent);
+      volume *= std::max(extent, 1.);
+    }
+
+    // Aim for a couple of points per cell if the points filled the bounding box
+    if(cellSize <= 0.) cellSize = std::cbrt(2. * volume / std::max<size_t>(fPositions.size(), 1));
+    fCellSize = std::max<double>({cellSize, maxExtent / (kMaxCells - 1), 1e-3});
+
+    for(unsigned int d = 0; d < 3; ++d){
+      fNCells[d] = std::min(kMaxCells, (int)((max[d] - fMin[d]) / fCellSize) + 1);
+    }
+
+    // Sort the points by cell so that each cell is a contiguous range
+    std::vector<std::pair<uint64_t,unsigned int>> keyed(fPositions.size());
+    for(unsigned int i = 0; i < fPositions.size(); ++i){
+      std::array<int,3> c = Cell(fPositions[i]);
+      keyed[i] = std::make_pair(Key(c[0], c[1], c[2]), i);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    fOrder.resize(keyed.size());
+    fCells.clear();
+    fCells.reserve(keyed.size());
+    for(unsigned int i = 0; i < keyed.size(); ++i){
+      fOrder[i] = keyed[i].second;
+      if(i == 0 || keyed[i].first != keyed[i-1].first){
+        fCells[keyed[i].first] = std::make_pair(i, i);
+      }
+      ++fCells[keyed[i].first].second;
+    }
+  }
+
+  std::array<int,3> SpacePointGrid::Cell(const std::array<double,3>& pos) const
+  {
+    std::array<int,3> c;
+    for(unsigned int d = 0; d < 3; ++d){
+      c[d] = std::min(fNCells[d] - 1, std::max(0, (int)((pos[d] - fMin[d]) / fCellSize)));
+    }
+    return c;
+  }
+
+  uint64_t SpacePointGrid::Key(int x, int y, int z) const
+  {
+    return ((uint64_t)x << 42) | ((uint64_t)y << 21) | (uint64_t)z;
+  }
+
+  std::pair<unsigned int,unsigned int> SpacePointGrid::CellRange(int x, int y, int z) const
+  {
+    if(x < 0 || y < 0 || z < 0 || x >= fNCells[0] || y >= fNCells[1] || z >= fNCells[2]){
+      return std::make_pair(0u, 0u);
+    }
+    auto it = fCells.find(Key(x, y, z));
+    if(it == fCells.end()) return std::make_pair(0u, 0u);
+    return it->second;
+  }
+
+  float SpacePointGrid::Distance(unsigned int i, unsigned int j) const
+  {
+    const std::array<double,3>& p0 = fPositions[i];
+    const std::array<double,3>& p1 = fPositions[j];
+    const float dx = p1[0] - p0[0];
+    const float dy = p1[1] - p0[1];
+    const float dz = p1[2] - p0[2];
+    return sqrt(dx*dx + dy*dy + dz*dz);
+  }
+
+  unsigned int SpacePointGrid::CountWithin(unsigned int i, float radius) const
+  {
+    return CountWithin(i, std::vector<float>{radius})[0];
+  }
+
+  std::vector<unsigned int> SpacePointGrid::CountWithin(unsigned int i, const std::vector<float>& radii) const
+  {
+    std::vector<unsigned int> counts(radii.size(), 0);
+    if(radii.empty()) return counts;
+
+    std::vector<float> thresholds(radii.size());
+    float maxRadius = 0.f;
+    for(unsigned int r = 0; r < radii.size(); ++r){
+      thresholds[r] = radii[r] > 0.f ? SquaredThreshold(radii[r]) : -1.f;
+      maxRadius = std::max(maxRadius, radii[r]);
+    }
+
+    const std::array<double,3>& p0 = fPositions[i];
+    const std::array<int,3> c = Cell(p0);
+    const int n = (int)std::ceil(maxRadius / fCellSize) + 1;
+    // Cells entirely beyond the largest radius are skipped, with some room for rounding
+    const double maxSq = (double)maxRadius * maxRadius * (1. + 1e-5);
+
+    for(int x = c[0] - n; x <= c[0] + n; ++x){
+      const double gx = std::max({0., fMin[0] + x * fCellSize - p0[0], p0[0] - fMin[0] - (x + 1) * fCellSize});
+      for(int y = c[1] - n; y <= c[1] + n; ++y){
+        const double gy = std::max({0., fMin[1] + y * fCellSize - p0[1], p0[1] - fMin[1] - (y + 1) * fCellSize});
+        for(int z = c[2] - n; z <= c[2] + n; ++z){
+          const double gz = std::max({0., fMin[2] + z * fCellSize - p0[2], p0[2] - fMin[2] - (z + 1) * fCellSize});
+          if(gx*gx + gy*gy + gz*gz > maxSq) continue;
+
+          std::pair<unsigned int,unsigned int> range = CellRange(x, y, z);
+          for(unsigned int o = range.first; o < range.second; ++o){
+            const unsigned int j = fOrder[o];
+            if(j == i) continue;
+            const std::array<double,3>& p1 = fPositions[j];
+            const float dx = p1[0] - p0[0];
+            const float dy = p1[1] - p0[1];
+            const float dz = p1[2] - p0[2];
+            const float sq = dx*dx + dy*dy + dz*dz;
+            for(unsigned int r = 0; r < radii.size(); ++r){
+              if(sq <= thresholds[r]) ++counts[r];
+            }
+          }
+        }
+      }
+    }
+    return counts;
+  }
+
+  std::vector<unsigned int> SpacePointGrid::Nearest(unsigned int i, unsigned int k) const
+  {
+    std::vector<std::pair<float,unsigned int>> best;
+    if(k == 0) return std::vector<unsigned int>();
+    best.reserve(k + 1);
+
+    const std::array<double,3>& p0 = fPositions[i];
+    const std::array<int,3> c = Cell(p0);
+    const int maxRing = std::max({fNCells[0], fNCells[1], fNCells[2]});
+
+    // Visit shells of cells at increasing Chebyshev distance from the point's
+    // cell. Anything beyond ring r is at least r cell sizes away.
+    for(int r = 0; r <= maxRing; ++r){
+      for(int x = c[0] - r; x <= c[0] + r; ++x){
+        for(int y = c[1] - r; y <= c[1] + r; ++y){
+          const bool edge = (std::abs(x - c[0]) == r || std::abs(y - c[1]) == r);
+          for(int z = c[2] - r; z <= c[2] + r; z += (edge ? 1 : std::max(1, 2*r))){
+            std::pair<unsigned int,unsigned int> range = CellRange(x, y, z);
+            if(range.first == range.second) continue;
+            // Skip cells that can't hold anything closer than the current k-th point
+            if(best.size() == k){
+              const double gx = std::max({0., fMin[0] + x * fCellSize - p0[0], p0[0] - fMin[0] - (x + 1) * fCellSize});
+              const double gy = std::max({0., fMin[1] + y * fCellSize - p0[1], p0[1] - fMin[1] - (y + 1) * fCellSize});
+              const double gz = std::max({0., fMin[2] + z * fCellSize - p0[2], p0[2] - fMin[2] - (z + 1) * fCellSize});
+              const double limit = (double)best.back().first * (1. + 1e-5);
+              if(gx*gx + gy*gy + gz*gz > limit * limit) continue;
+            }
+            for(unsigned int o = range.first; o < range.second; ++o){
+              unsigned int j = fOrder[o];
+              if(j == i) continue;
+              std::pair<float,unsigned int> cand(Distance(i, j), j);
+              if(best.size() == k && !(cand < best.back())) continue;
+              best.insert(std::upper_bound(best.begin(), best.end(), cand), cand);
+              if(best.size() > k) best.pop_back();
+            }
+          }
+        }
+      }
+      // Keep a small margin as the distances are rounded to float
+      if(best.size() == k && best.back().first < r * fCellSize * (1. - 1e-5)) break;
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(best.size());
+    for(const std::pair<float,unsigned int>& b : best) result.push_back(b.second);
+    return result;
+  }
+
+}
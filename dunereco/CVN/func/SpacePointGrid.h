@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    SpacePointGrid.h
+/// \brief   Uniform grid over space point positions for neighbour queries
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_SPACEPOINTGRID_H
+#define CVN_SPACEPOINTGRID_H
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "canvas/Persistency/Common/Ptr.h"
+#include "lardataobj/RecoBase/SpacePoint.h"
+
+namespace cvn
+{
+
+  /// Bins a set of points into cubic cells so that radius and nearest
+  /// neighbour queries only look at nearby cells. Points are referred to by
+  /// their position in the input vector. Distances are computed exactly as
+  /// in the original GCNFeatureUtils loops, and ties are resolved in favour
+  /// of the lower index, so the results match the brute force ones.
+  class SpacePointGrid
+  {
+  public:
+
+    /// Build the grid. A cellSize <= 0 picks one from the point density.
+    SpacePointGrid(const std::vector<art::Ptr<recob::SpacePoint>>& sps, float cellSize = 0.);
+    SpacePointGrid(const std::vector<std::array<double,3>>& positions, float cellSize = 0.);
+
+    unsigned int Size() const { return fPositions.size(); };
+    float CellSize() const { return fCellSize; };
+    const std::array<double,3>& Position(unsigned int i) const { return fPositions[i]; };
+
+    /// Distance between two points
+    float Distance(unsigned int i, unsigned int j) const;
+
+    /// Number of other points closer than radius to point i
+    unsigned int CountWithin(unsigned int i, float radius) const;
+
+    /// Number of other points closer than each of the radii to point i
+    std::vector<unsigned int> CountWithin(unsigned int i, const std::vector<float>& radii) const;
+
+    /// Indices of the (up to) k nearest other points to point i, closest first
+    std::vector<unsigned int> Nearest(unsigned int i, unsigned int k) const;
+
+  private:
+
+    void Build(float cellSize);
+    std::array<int,3> Cell(const std::array<double,3>& pos) const;
+    uint64_t Key(int x, int y, int z) const;
+    /// Range of fOrder holding the points of a cell, empty if out of the grid
+    std::pair<unsigned int,unsigned int> CellRange(int x, int y, int z) const;
+
+    std::vector<std::array<double,3>> fPositions;
+    std::array<double,3> fMin;    ///< Low corner of the grid
+    std::array<int,3> fNCells;    ///< Number of cells along each axis
+    float fCellSize;
+
+    std::vector<unsigned int> fOrder; ///< Point indices sorted by cell
+    std::unordered_map<uint64_t, std::pair<unsigned int,unsigned int>> fCells; ///< Occupied cells
+
+  };
+
+}
+
+#endif  // CVN_SPACEPOINTGRID_H
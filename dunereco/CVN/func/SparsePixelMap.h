@@ -26,11 +26,15 @@ namespace cvn
     std::vector<unsigned int> GetNPixels() const;
     unsigned int GetNPixels(size_t view) const { return fFeatures[view].size(); };
 
+    /// Size of the pixel grid in each dimension, empty for maps without a fixed grid
+    void SetExtent(std::vector<unsigned int> extent) { fExtent = extent; };
+    std::vector<unsigned int> GetExtent() const { return fExtent; };
+
     std::vector<std::vector<std::vector<float>>> GetCoordinates() const { return fCoordinates; };
-    std::vector<std::vector<float>> GetCoordinates(size_t view) const { return fCoordinates[view]; };
+    const std::vector<std::vector<float>>& GetCoordinates(size_t view) const { return fCoordinates[view]; };
 
     std::vector<std::vector<std::vector<float>>> GetFeatures() const { return fFeatures; };
-    std::vector<std::vector<float>> GetFeatures(size_t view) const { return fFeatures[view]; };
+    const std::vector<std::vector<float>>& GetFeatures(size_t view) const { return fFeatures[view]; };
 
     std::vector<std::vector<std::vector<int>>> GetPixelPDGs() const { return fPixelPDGs; };
     std::vector<std::vector<int>> GetPixelPDGs(size_t view) const { return fPixelPDGs[view]; };
@@ -66,6 +70,7 @@ namespace cvn
     std::vector<std::vector<std::vector<int>>> fPixelTrackIDs; ///< G4 track IDs responsible for pixelel
     std::vector<std::vector<std::vector<float>>> fPixelEnergies;
     std::vector<std::vector<std::vector<std::string>>> fProcesses; // physics process that created the particle
+    std::vector<unsigned int> fExtent; ///< Size of the pixel grid in each dimension, if it has one
 
   }; // class SparsePixelMap
 } // namespace cvn
@@ -0,0 +1,369 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ZlibArchive.cxx
+/// \brief   Sharded container for zlib compressed training images
+////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include "canvas/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "dunereco/CVN/func/ZlibArchive.h"
+
+#include "zlib.h"
+
+namespace cvn
+{
+
+  namespace
+  {
+    const char kIndexMagic[4] = {'C', 'V', 'N', 'Z'};
+    const uint32_t kIndexVersion = 2;
+
+    template <class T> void WriteValue(std::ofstream& out, const T& value)
+    {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T> T ReadValue(std::ifstream& in)
+    {
+      T value{};
+      in.read(reinterpret_cast<char*>(&value), sizeof(T));
+      return value;
+    }
+  }
+
+  std::string ZlibArchiveShardName(const std::string& dir, const std::string& prefix, uint32_t shard)
+  {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%04u", shard);
+    return dir + "/" + prefix + "_" + number + ".shard";
+  }
+
+  std::string ZlibArchiveIndexName(const std::string& dir, const std::string& prefix, uint32_t shard)
+  {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%04u", shard);
+    return dir + "/" + prefix + "_" + number + ".index";
+  }
+
+  //......................................................................
+  ZlibArchiveWriter::ZlibArchiveWriter(const std::string& dir, const std::string& prefix,
+                                       uint64_t shardSize, bool async):
+    fDir(dir),
+    fPrefix(prefix),
+    fShardSize(shardSize),
+    fAsync(async),
+    fClosed(false),
+    fShardNumber(0),
+    fShardOffset(0),
+    fNRecords(0),
+    fStop(false)
+  {
+    if(fAsync) fThread = std::thread(&ZlibArchiveWriter::Worker, this);
+  }
+
+  ZlibArchiveWriter::~ZlibArchiveWriter()
+  {
+    try{
+      Close();
+    }
+    catch(std::exception& e){
+      mf::LogError("ZlibArchiveWriter") << "Failed to close archive " << fDir << "/" << fPrefix << ": " << e.what();
+    }
+  }
+
+  uint64_t ZlibArchiveWriter::NRecords() const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fNRecords;
+  }
+
+  void ZlibArchiveWriter::Write(const std::string& key, std::vector<unsigned char>&& raw,
+                                const std::vector<double>& info)
+  {
+    if(fClosed){
+      throw art::Exception(art::errors::LogicError)
+        << "Writing record " << key << " to closed archive " << fDir << "/" << fPrefix;
+    }
+
+    Pending rec{key, std::move(raw), info};
+    if(!fAsync){
+      Store(rec);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(fMutex);
+    fQueueCond.wait(lock, [this]{ return fQueue.size() < fMaxQueue || !fError.empty(); });
+    if(!fError.empty()){
+      lock.unlock();
+      CheckError();
+    }
+    fQueue.push_back(std::move(rec));
+    fQueueCond.notify_all();
+  }
+
+  void ZlibArchiveWriter::Close()
+  {
+    if(fClosed) return;
+    fClosed = true;
+
+    if(fAsync){
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fStop = true;
+      }
+      fQueueCond.notify_all();
+      fThread.join();
+      CheckError();
+    }
+
+    // An empty archive still gets an index, so that it reads back as such
+    if(!fShard.is_open()){
+      RemoveIndex(fShardNumber + 1);
+      WriteIndex();
+      return;
+    }
+
+    fShard.close();
+    WriteIndex();
+  }
+
+  void ZlibArchiveWriter::CheckError()
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if(!fError.empty()){
+      throw art::Exception(art::errors::FileWriteError) << fError;
+    }
+  }
+
+  void ZlibArchiveWriter::Worker()
+  {
+    while(true){
+      Pending rec;
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fQueueCond.wait(lock, [this]{ return !fQueue.empty() || fStop; });
+        if(fQueue.empty()) return;
+        rec = std::move(fQueue.front());
+        fQueue.pop_front();
+      }
+      fQueueCond.notify_all();
+
+      try{
+        Store(rec);
+      }
+      catch(std::exception& e){
+        std::lock_guard<std::mutex> lock(fMutex);
+        fError = e.what();
+        fQueue.clear();
+        fQueueCond.notify_all();
+        return;
+      }
+    }
+  }
+
+  void ZlibArchiveWriter::Store(Pending& rec)
+  {
+    uLongf destLen = compressBound(rec.raw.size());
+    if(fBuffer.size() < destLen) fBuffer.resize(destLen);
+
+    int res = compress((Bytef*)fBuffer.data(), &destLen, (const Bytef*)rec.raw.data(), rec.raw.size());
+    if(res != Z_OK){
+      throw art::Exception(art::errors::FileWriteError)
+        << "Compression of record " << rec.key << " failed with zlib error " << res;
+    }
+
+    // Records never straddle shards, so a single oversized record gets a shard of its own
+    if(!fShard.is_open() || (fShardOffset > 0 && fShardOffset + destLen > fShardSize)){
+      OpenShard();
+    }
+
+    fShard.write((const char*)fBuffer.data(), destLen);
+    if(!fShard){
+      throw art::Exception(art::errors::FileWriteError)
+        << "Unable to write record " << rec.key << " to " << ZlibArchiveShardName(fDir, fPrefix, fShardNumber);
+    }
+
+    ZlibArchiveRecord entry;
+    entry.key = std::move(rec.key);
+    entry.shard = fShardNumber;
+    entry.offset = fShardOffset;
+    entry.size = destLen;
+    entry.rawSize = rec.raw.size();
+    entry.info = std::move(rec.info);
+    fShardOffset += destLen;
+    fRecords.push_back(std::move(entry));
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    ++fNRecords;
+  }
+
+  void ZlibArchiveWriter::OpenShard()
+  {
+    if(fShard.is_open()){
+      fShard.close();
+      if(!fShard){
+        throw art::Exception(art::errors::FileWriteError)
+          << "Unable to close " << ZlibArchiveShardName(fDir, fPrefix, fShardNumber);
+      }
+      WriteIndex();
+      ++fShardNumber;
+    }
+    fShardOffset = 0;
+
+    // Readers stop at the first shard without an index
+    RemoveIndex(fShardNumber);
+    RemoveIndex(fShardNumber + 1);
+
+    std::string name = ZlibArchiveShardName(fDir, fPrefix, fShardNumber);
+    fShard.open(name, std::ofstream::binary | std::ofstream::trunc);
+    if(!fShard.is_open()){
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to open file " << name << "!";
+    }
+  }
+
+  void ZlibArchiveWriter::RemoveIndex(uint32_t shard) const
+  {
+    std::remove(ZlibArchiveIndexName(fDir, fPrefix, shard).c_str());
+  }
+
+  void ZlibArchiveWriter::WriteIndex()
+  {
+    std::string name = ZlibArchiveIndexName(fDir, fPrefix, fShardNumber);
+    std::ofstream index(name, std::ofstream::binary | std::ofstream::trunc);
+    if(!index.is_open()){
+      throw art::Exception(art::errors::FileOpenError)
+        << "Unable to open file " << name << "!";
+    }
+
+    index.write(kIndexMagic, sizeof(kIndexMagic));
+    WriteValue(index, kIndexVersion);
+    WriteValue(index, (uint64_t)fRecords.size());
+    for(const ZlibArchiveRecord& rec : fRecords){
+      WriteValue(index, (uint32_t)rec.key.size());
+      index.write(rec.key.data(), rec.key.size());
+      WriteValue(index, rec.shard);
+      WriteValue(index, rec.offset);
+      WriteValue(index, rec.size);
+      WriteValue(index, rec.rawSize);
+      WriteValue(index, (uint32_t)rec.info.size());
+      index.write((const char*)rec.info.data(), rec.info.size() * sizeof(double));
+    }
+
+    index.close();
+    if(!index){
+      throw art::Exception(art::errors::FileWriteError)
+        << "Unable to write index " << name;
+    }
+    fRecords.clear();
+  }
+
+  //......................................................................
+  ZlibArchiveReader::ZlibArchiveReader(const std::string& dir, const std::string& prefix):
+    fDir(dir),
+    fPrefix(prefix),
+    fOpenShardNumber(0)
+  {
+    for(uint32_t shard = 0; ; ++shard){
+      std::string name = ZlibArchiveIndexName(dir, prefix, shard);
+      std::ifstream index(name, std::ifstream::binary);
+      if(!index.is_open()){
+        if(shard == 0){
+          throw art::Exception(art::errors::FileOpenError)
+            << "Unable to open file " << name << "!";
+        }
+        break;
+      }
+      ReadIndex(index, name);
+    }
+  }
+
+  void ZlibArchiveReader::ReadIndex(std::ifstream& index, const std::string& name)
+  {
+    char magic[4];
+    index.read(magic, sizeof(magic));
+    uint32_t version = ReadValue<uint32_t>(index);
+    if(!index || std::memcmp(magic, kIndexMagic, sizeof(magic)) != 0 || version != kIndexVersion){
+      throw art::Exception(art::errors::FileReadError)
+        << name << " is not a version " << kIndexVersion << " CVN archive index";
+    }
+
+    uint64_t nRecords = ReadValue<uint64_t>(index);
+    fRecords.reserve(fRecords.size() + nRecords);
+    for(uint64_t i = 0; i < nRecords; ++i){
+      ZlibArchiveRecord rec;
+      rec.key.resize(ReadValue<uint32_t>(index));
+      index.read(&rec.key[0], rec.key.size());
+      rec.shard = ReadValue<uint32_t>(index);
+      rec.offset = ReadValue<uint64_t>(index);
+      rec.size = ReadValue<uint64_t>(index);
+      rec.rawSize = ReadValue<uint64_t>(index);
+      rec.info.resize(ReadValue<uint32_t>(index));
+      index.read((char*)rec.info.data(), rec.info.size() * sizeof(double));
+      if(!index){
+        throw art::Exception(art::errors::FileReadError)
+          << "Truncated archive index " << name;
+      }
+      fRecords.push_back(std::move(rec));
+    }
+  }
+
+  uint64_t ZlibArchiveReader::Find(const std::string& key) const
+  {
+    for(uint64_t i = 0; i < fRecords.size(); ++i){
+      if(fRecords[i].key == key) return i;
+    }
+    return fRecords.size();
+  }
+
+  std::ifstream& ZlibArchiveReader::Shard(uint32_t shard)
+  {
+    if(!fOpenShard.is_open() || shard != fOpenShardNumber){
+      if(fOpenShard.is_open()) fOpenShard.close();
+      std::string name = ZlibArchiveShardName(fDir, fPrefix, shard);
+      fOpenShard.open(name, std::ifstream::binary);
+      if(!fOpenShard.is_open()){
+        throw art::Exception(art::errors::FileOpenError)
+          << "Unable to open file " << name << "!";
+      }
+      fOpenShardNumber = shard;
+    }
+    fOpenShard.clear();
+    return fOpenShard;
+  }
+
+  std::vector<unsigned char> ZlibArchiveReader::ReadCompressed(uint64_t i)
+  {
+    const ZlibArchiveRecord& rec = fRecords.at(i);
+    std::ifstream& shard = Shard(rec.shard);
+
+    std::vector<unsigned char> data(rec.size);
+    shard.seekg(rec.offset);
+    shard.read((char*)data.data(), data.size());
+    if(!shard){
+      throw art::Exception(art::errors::FileReadError)
+        << "Unable to read record " << rec.key << " from " << ZlibArchiveShardName(fDir, fPrefix, rec.shard);
+    }
+    return data;
+  }
+
+  std::vector<unsigned char> ZlibArchiveReader::Read(uint64_t i)
+  {
+    std::vector<unsigned char> data = ReadCompressed(i);
+    const ZlibArchiveRecord& rec = fRecords[i];
+
+    std::vector<unsigned char> raw(rec.rawSize);
+    uLongf rawLen = raw.size();
+    int res = uncompress((Bytef*)raw.data(), &rawLen, (const Bytef*)data.data(), data.size());
+    if(res != Z_OK || rawLen != rec.rawSize){
+      throw art::Exception(art::errors::DataCorruption)
+        << "Unable to uncompress record " << rec.key << ", zlib error " << res;
+    }
+    return raw;
+  }
+
+}
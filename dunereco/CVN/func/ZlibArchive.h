@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////
+/// \file    ZlibArchive.h
+/// \brief   Sharded container for zlib compressed training images
+///
+/// Replaces the one .gz plus one .info file per event layout of the
+/// zlib makers. Compressed blobs are appended to shard files of a fixed
+/// maximum size. Each shard gets a binary index, written as soon as the
+/// shard is complete, holding for each of its records the key, the
+/// location and the values that used to go to the .info file.
+///
+///   <prefix>_<NNNN>.shard  concatenated zlib streams
+///   <prefix>_<NNNN>.index  "CVNZ", version, number of records, then per
+///                          record: key, shard, offset, compressed size,
+///                          uncompressed size and the info values
+///
+/// If a job stops before the archive is closed, only the records of the
+/// shard being written are lost. Readers take the shards in order up to
+/// the first one without an index, so the index of the open shard and of
+/// the next one are removed in case an earlier run left them behind.
+///
+/// All integers and doubles are written in the host (little endian) byte
+/// order.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef CVN_ZLIBARCHIVE_H
+#define CVN_ZLIBARCHIVE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cvn
+{
+
+  /// Index entry of one record in a ZlibArchive
+  struct ZlibArchiveRecord
+  {
+    std::string key;         ///< Event identifier, the legacy file name stem
+    uint32_t shard = 0;      ///< Shard file number
+    uint64_t offset = 0;     ///< Byte offset of the zlib stream in the shard
+    uint64_t size = 0;       ///< Compressed size in bytes
+    uint64_t rawSize = 0;    ///< Uncompressed size in bytes
+    std::vector<double> info; ///< Values of the legacy .info file, in order
+  };
+
+  /// Writes records into a sharded archive. Compression can be moved to a
+  /// worker thread, records are still stored in the order they are written.
+  class ZlibArchiveWriter
+  {
+  public:
+
+    /// \param dir         Existing output directory
+    /// \param prefix      File name prefix of the shards and the index
+    /// \param shardSize   A new shard is started once this many bytes are written
+    /// \param async       Compress and write on a worker thread
+    ZlibArchiveWriter(const std::string& dir, const std::string& prefix,
+                      uint64_t shardSize, bool async);
+
+    /// Closes the archive if Close was not called
+    ~ZlibArchiveWriter();
+
+    ZlibArchiveWriter(const ZlibArchiveWriter&) = delete;
+    ZlibArchiveWriter& operator=(const ZlibArchiveWriter&) = delete;
+
+    /// Compress and store raw under key. The buffer is taken over so that
+    /// the caller does not wait on the compression in async mode.
+    void Write(const std::string& key, std::vector<unsigned char>&& raw,
+               const std::vector<double>& info);
+
+    /// Flush the pending records, close the last shard and write its index
+    void Close();
+
+    /// Number of records written so far
+    uint64_t NRecords() const;
+
+  private:
+
+    struct Pending
+    {
+      std::string key;
+      std::vector<unsigned char> raw;
+      std::vector<double> info;
+    };
+
+    /// Compress one record and append it to the current shard
+    void Store(Pending& rec);
+    /// Close the current shard, writing its index, and start the next one
+    void OpenShard();
+    /// Write the index of the current shard and forget its records
+    void WriteIndex();
+    void RemoveIndex(uint32_t shard) const;
+    void Worker();
+    /// Rethrow an error raised on the worker thread
+    void CheckError();
+
+    std::string fDir;
+    std::string fPrefix;
+    uint64_t fShardSize;
+    bool fAsync;
+    bool fClosed;
+
+    std::ofstream fShard;         ///< Current shard
+    uint32_t fShardNumber;        ///< Number of the current shard
+    uint64_t fShardOffset;        ///< Bytes written to the current shard
+    std::vector<unsigned char> fBuffer; ///< Reused compression buffer
+    std::vector<ZlibArchiveRecord> fRecords; ///< Records of the current shard
+    uint64_t fNRecords;           ///< Records written to all shards
+
+    mutable std::mutex fMutex;
+    std::condition_variable fQueueCond;
+    std::deque<Pending> fQueue;   ///< Records waiting for the worker
+    static const size_t fMaxQueue = 16; ///< Write blocks beyond this many pending records
+    bool fStop;
+    std::string fError;           ///< First error seen by the worker
+    std::thread fThread;
+
+  };
+
+  /// Random access reader for the archives made by ZlibArchiveWriter
+  class ZlibArchiveReader
+  {
+  public:
+
+    /// Reads the shard indices <dir>/<prefix>_<NNNN>.index up to the first
+    /// missing one, shards are opened on demand
+    ZlibArchiveReader(const std::string& dir, const std::string& prefix);
+
+    uint64_t NRecords() const { return fRecords.size(); };
+    const ZlibArchiveRecord& Record(uint64_t i) const { return fRecords.at(i); };
+    const std::vector<ZlibArchiveRecord>& Records() const { return fRecords; };
+
+    /// Index of the record with this key, NRecords() if there is none
+    uint64_t Find(const std::string& key) const;
+
+    /// Compressed bytes of record i, identical to the legacy .gz content
+    std::vector<unsigned char> ReadCompressed(uint64_t i);
+
+    /// Uncompressed bytes of record i
+    std::vector<unsigned char> Read(uint64_t i);
+
+  private:
+
+    std::ifstream& Shard(uint32_t shard);
+    void ReadIndex(std::ifstream& index, const std::string& name);
+
+    std::string fDir;
+    std::string fPrefix;
+    std::vector<ZlibArchiveRecord> fRecords;
+    uint32_t fOpenShardNumber;
+    std::ifstream fOpenShard;     ///< Last used shard, records are usually read in order
+
+  };
+
+  /// Shard file name used by the writer and the reader
+  std::string ZlibArchiveShardName(const std::string& dir, const std::string& prefix, uint32_t shard);
+
+  /// Name of the index file of a shard
+  std::string ZlibArchiveIndexName(const std::string& dir, const std::string& prefix, uint32_t shard);
+
+}
+
+#endif  // CVN_ZLIBARCHIVE_H
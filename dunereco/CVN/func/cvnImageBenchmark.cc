@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Microbenchmark of the CVN image filling. Compares, on random 2880 x 500 pixel maps cropped to
+//// 500 x 500 x 3 images:
+////   nested - ConvertPixelMapToImageVectorF, then copying the nested vectors into a flat
+////            NHWC tensor buffer as tf::Graph::run did
+////   flat   - ConvertPixelMapToBuffer straight into the tensor buffer
+//// and checks that both give the same pixels.
+////
+//// Usage: cvnImageBenchmark [maps]
+////
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// std library
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// CVN stuff
+#include "dunereco/CVN/func/CVNImageUtils.h"
+#include "dunereco/CVN/func/PixelMap.h"
+
+namespace
+{
+  const unsigned int kMapWires = 2880;
+  const unsigned int kMapTDCs  = 500;
+  const unsigned int kImage    = 500;
+  const unsigned int kViews    = 3;
+
+  /// A neutrino-like blob of charge in each view, a few percent occupancy
+  cvn::PixelMap MakePixelMap(std::mt19937& engine)
+  {
+    std::uniform_real_distribution<float> flat(0., 1.);
+    cvn::PixelMap pm;
+    pm.fNWire = kMapWires;
+    pm.fNTdc  = kMapTDCs;
+    for(std::vector<float>* view : {&pm.fPEX, &pm.fPEY, &pm.fPEZ}){
+      view->assign(kMapWires*kMapTDCs, 0.);
+      unsigned int firstWire = 600 + engine()%1200;
+      for(unsigned int wire = firstWire; wire < firstWire + 400; ++wire){
+        for(unsigned int tdc = 50; tdc < 450; ++tdc){
+          if(flat(engine) < 0.05) (*view)[wire*kMapTDCs + tdc] = 2000.*flat(engine);
+        }
+      }
+    }
+    return pm;
+  }
+
+  void SetUp(cvn::CVNImageUtils& imageUtils, bool logScale)
+  {
+    imageUtils.SetPixelMapSize(kMapWires, kMapTDCs);
+    imageUtils.SetImageSize(kImage, kImage, kViews);
+    imageUtils.SetViewReversal(std::vector<bool>{false, true, false});
+    imageUtils.SetLogScale(logScale);
+  }
+
+  double Milliseconds(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int nMaps = argc > 1 ? std::atoi(argv[1]) : 50;
+  if(nMaps < 1){
+    std::cerr << "Usage: cvnImageBenchmark [maps]" << std::endl;
+    return 1;
+  }
+
+  std::mt19937 engine(1);
+  std::vector<cvn::PixelMap> maps;
+  for(int i = 0; i < nMaps; ++i) maps.push_back(MakePixelMap(engine));
+
+  long nDiffer = 0;
+  for(bool logScale : {false, true}){
+    cvn::CVNImageUtils imageUtils;
+    SetUp(imageUtils, logScale);
+
+    const size_t imageSize = kImage*kImage*kViews;
+    std::vector<float> nestedBuffer(imageSize), flatBuffer(imageSize);
+    double tNested = 0., tFlat = 0.;
+
+    for(const cvn::PixelMap& pm : maps){
+      auto start = std::chrono::steady_clock::now();
+      cvn::ImageVectorF image;
+      imageUtils.ConvertPixelMapToImageVectorF(pm, image);
+      size_t index = 0;
+      for(const cvn::ViewVectorF& wires : image)
+        for(const std::vector<float>& tdcs : wires)
+          for(float pixel : tdcs) nestedBuffer[index++] = pixel;
+      tNested += Milliseconds(start);
+
+      start = std::chrono::steady_clock::now();
+      imageUtils.ConvertPixelMapToBuffer(pm, cvn::ImageViewF::Interleaved(flatBuffer.data(), kImage, kViews));
+      tFlat += Milliseconds(start);
+
+      for(size_t i = 0; i < imageSize; ++i) if(nestedBuffer[i] != flatBuffer[i]) ++nDiffer;
+    }
+
+    std::cout << (logScale ? "Log scale" : "Linear   ") << ": nested " << tNested/nMaps
+              << " ms, flat " << tFlat/nMaps << " ms per map" << std::endl;
+  }
+
+  std::cout << "Pixels that differ: " << nDiffer << std::endl;
+  return nDiffer == 0 ? 0 : 1;
+}
@@ -104,7 +104,14 @@ Int_t Analyze::GetEntry(Long64_t entry)
 {
 // Read contents of entry.
    if (!fChain) return 0;
-   return fChain->GetEntry(entry);
+   Int_t nb = fChain->GetEntry(entry);
+   // Maps made without truth arrays only store the per-view charge
+   if (fPMap_fPE.empty() && !fPMap_fPEX.empty()) {
+      fPMap_fPE.resize(fPMap_fPEX.size());
+      for (size_t i = 0; i < fPMap_fPEX.size(); ++i)
+         fPMap_fPE[i] = fPMap_fPEX[i] + fPMap_fPEY[i] + fPMap_fPEZ[i];
+   }
+   return nb;
 }
 Long64_t Analyze::LoadTree(Long64_t entry)
 {
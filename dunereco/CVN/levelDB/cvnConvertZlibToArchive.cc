@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Converts a directory of legacy per-event .gz/.info pairs, as written by the zlib makers,
+//// into a sharded archive readable with cvn::ZlibArchiveReader.
+////
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// std library
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Boost, for program options
+#include "boost/filesystem.hpp"
+#include "boost/program_options/options_description.hpp"
+#include "boost/program_options/variables_map.hpp"
+#include "boost/program_options/parsers.hpp"
+
+// CVN stuff
+#include "dunereco/CVN/func/ZlibArchive.h"
+
+#include "zlib.h" // compression algorithm
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+po::variables_map getOptions(int argc, char*  argv[], std::string& input, std::string& output,
+                             std::string& prefix, unsigned int& shardSizeMB)
+{
+
+  // Declare the supported options.
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help", "produce help message")
+    ("input,i", po::value<std::string>(&input)->required(),
+                                                "Directory with the .gz and .info files")
+    ("output,o", po::value<std::string>(&output)->required(),
+                                                "Existing output directory")
+    ("prefix,p", po::value<std::string>(&prefix)->default_value("cvn"),
+                                                "File name prefix of the archive")
+    ("shard-size,s", po::value<unsigned int>(&shardSizeMB)->default_value(1024),
+                                                "Shard size in MB");
+  po::variables_map vm;
+
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+  }
+  catch(po::error& e)
+  {
+    std::cout  << "ERROR: " << e.what() << std::endl;
+    exit(1);
+  }
+
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    exit(1);
+  }
+
+  return vm;
+}
+
+// Uncompress a legacy .gz file, whose uncompressed size isn't stored anywhere
+bool readImage(const std::string& name, std::vector<unsigned char>& raw)
+{
+  std::ifstream image_file(name, std::ifstream::binary);
+  if (!image_file.is_open()) return false;
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(image_file)),
+                                  std::istreambuf_iterator<char>());
+
+  raw.resize(std::max<size_t>(4 * data.size(), 1024));
+  while (true) {
+    uLongf rawLen = raw.size();
+    int res = uncompress((Bytef*)raw.data(), &rawLen, (const Bytef*)data.data(), data.size());
+    if (res == Z_BUF_ERROR) {
+      raw.resize(2 * raw.size());
+      continue;
+    }
+    if (res != Z_OK) return false;
+    raw.resize(rawLen);
+    return true;
+  }
+}
+
+bool readInfo(const std::string& name, std::vector<double>& info)
+{
+  std::ifstream info_file(name);
+  if (!info_file.is_open()) return false;
+  info.clear();
+  double value;
+  while (info_file >> value) info.push_back(value);
+  return info_file.eof();
+}
+
+int main(int argc, char* argv[])
+{
+
+  std::string input, output, prefix;
+  unsigned int shardSizeMB;
+  po::variables_map vm = getOptions(argc, argv, input, output, prefix, shardSizeMB);
+
+  // Records are stored in file name order
+  std::vector<std::string> stems;
+  for (const fs::directory_entry& entry : fs::directory_iterator(input)) {
+    const fs::path& path = entry.path();
+    if (path.extension() != ".gz") continue;
+    if (!fs::exists(fs::path(path).replace_extension(".info"))) {
+      std::cout << "Skipping " << path.string() << " without a .info file" << std::endl;
+      continue;
+    }
+    stems.push_back(path.stem().string());
+  }
+  std::sort(stems.begin(), stems.end());
+
+  unsigned int nSkipped = 0;
+  try
+  {
+    cvn::ZlibArchiveWriter archive(output, prefix, (uint64_t)shardSizeMB << 20, true);
+    std::vector<unsigned char> raw;
+    std::vector<double> info;
+    for (const std::string& stem : stems) {
+      std::string base = input + "/" + stem;
+      if (!readImage(base + ".gz", raw) || !readInfo(base + ".info", info)) {
+        std::cout << "Skipping unreadable record " << base << std::endl;
+        ++nSkipped;
+        continue;
+      }
+      archive.Write(stem, std::move(raw), info);
+      raw.clear();
+    }
+    archive.Close();
+    std::cout << "Wrote " << archive.NRecords() << " records to " << output << "/" << prefix << "_*.shard"
+              << ", skipped " << nSkipped << std::endl;
+  }
+  catch(std::exception& e)
+  {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+}
@@ -4,6 +4,12 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 // Boost, for program options
 #include "boost/program_options/options_description.hpp"
@@ -74,6 +80,8 @@ public:
     fWriteSync (pset.get<bool>("WriteSync")),
     fMaxKeyLength (pset.get<unsigned int>("MaxKeyLength")),
     fWriteBufferSize (pset.get<unsigned int>("WriteBufferSize")),
+    fWriteBatchSize (pset.get<unsigned int>("WriteBatchSize", 1000)),
+    fAsyncWrite (pset.get<bool>("AsyncWrite", true)),
     fLabeling (pset.get<std::string>("Labeling")),
     fUseGeV (pset.get<bool>("UseGeV")),
     fWriteRegressionHDF5 (pset.get<bool>("WriteRegressionHDF5")),
@@ -110,6 +118,10 @@ public:
   bool          fWriteSync;
   unsigned int  fMaxKeyLength;
   unsigned int  fWriteBufferSize;
+  /// Number of records per LevelDB WriteBatch or LMDB transaction
+  unsigned int  fWriteBatchSize;
+  /// Commit the batches on a background thread
+  bool          fAsyncWrite;
 
   std::string   fLabeling;
   unsigned int  fLabelingMode;
@@ -131,26 +143,86 @@ public:
   std::vector<bool> fReverseViews;
 };
 
+/// Wall time spent in one stage of the conversion loop
+class StageCounter {
+public:
+  StageCounter(std::string name) : fName(name), fSeconds(0), fN(0) {};
+
+  void Start() { fStart = std::chrono::steady_clock::now(); };
+  void Stop() {
+    fSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count();
+    ++fN;
+  };
+
+  void Print() const {
+    std::cout << "- Stage " << fName << ": " << fN << " records in " << fSeconds << " s";
+    if (fSeconds > 0) std::cout << " (" << fN / fSeconds << " records/s)";
+    std::cout << std::endl;
+  };
+
+private:
+  std::string fName;
+  double fSeconds;
+  unsigned long fN;
+  std::chrono::steady_clock::time_point fStart;
+};
+
+/// Writes records in batches of fBatchSize, one LevelDB WriteBatch or LMDB
+/// transaction each. In async mode a full batch is committed on a background
+/// thread while the next one is being filled.
 class OutputDB {
 public:
   OutputDB(std::string sample, const Config& config);
   ~OutputDB();
 
-  void Put(std::string &serializeKey, std::string  &serializeString);
+  void Put(std::string serializeKey, std::string serializeString);
+
+  /// Commit the last partial batch and wait for the writer thread
+  void Close();
+
+  /// Report the number of records, bytes and the time spent committing
+  void PrintSummary() const;
 
 private:
+  typedef std::vector< std::pair<std::string, std::string> > Batch;
+
+  void Submit();
+  void Commit(Batch& batch);
+  void Writer();
+  void CheckError();
+
+  std::string fSample;
   leveldb::DB* fLevelDB;
   leveldb::WriteOptions fWriteOptions;
 
   MDB_env *mdb_env;
   MDB_dbi mdb_dbi;
-  MDB_val mdb_key, mdb_data;
-  MDB_txn *mdb_txn;
+
+  unsigned int fBatchSize;
+  bool fAsync;
+  bool fClosed;
+  Batch fBatch;                 ///< Batch being filled by Put
+
+  std::mutex fMutex;
+  std::condition_variable fCond;
+  std::deque<Batch> fQueue;     ///< Full batches waiting for the writer thread
+  bool fStop;
+  std::string fError;           ///< First commit error seen by the writer thread
+  std::thread fThread;
+
+  unsigned long fNRecords;
+  unsigned long fNBytes;
+  unsigned long fNBatches;
+  double fCommitSeconds;        ///< Time spent in batch commits
+  double fWaitSeconds;          ///< Time Put spent waiting for the writer thread
   
 };
 
 OutputDB::OutputDB(std::string sample, const Config& config) :
-  fLevelDB(0),  mdb_env(0), mdb_txn(0) {
+  fSample(sample), fLevelDB(0),  mdb_env(0),
+  fBatchSize(std::max(1u, config.fWriteBatchSize)), fAsync(config.fAsyncWrite),
+  fClosed(false), fStop(false),
+  fNRecords(0), fNBytes(0), fNBatches(0), fCommitSeconds(0), fWaitSeconds(0) {
 
   std::string outputDir;
   if (sample=="test") 
@@ -178,8 +250,11 @@ OutputDB::OutputDB(std::string sample, const Config& config) :
     mdb_env_create(&mdb_env);
     mdb_env_set_mapsize(mdb_env, 10737418240);
     mdb_env_open(mdb_env, outputDir.c_str(), 0, 0777);
+    // Only open the database here, records go in one transaction per batch
+    MDB_txn *mdb_txn;
     mdb_txn_begin(mdb_env, NULL, 0, &mdb_txn);
     mdb_dbi_open(mdb_txn,NULL, 0, &mdb_dbi);
+    mdb_txn_commit(mdb_txn);
   }
 
   else {
@@ -187,26 +262,138 @@ OutputDB::OutputDB(std::string sample, const Config& config) :
     exit(1);
   }
 
+  fBatch.reserve(fBatchSize);
+  if (fAsync) fThread = std::thread(&OutputDB::Writer, this);
+
 }
 
 OutputDB::~OutputDB() {
-  if (mdb_txn)  mdb_txn_commit(mdb_txn);
+  Close();
+  delete fLevelDB;
+  if (mdb_env) mdb_env_close(mdb_env);
+}
+
+void OutputDB::Put(std::string serializeKey, std::string serializeString) {
+  fNBytes += serializeKey.size() + serializeString.size();
+  ++fNRecords;
+  fBatch.emplace_back(std::move(serializeKey), std::move(serializeString));
+  if (fBatch.size() >= fBatchSize) Submit();
+}//end OutputDB::Put
+
+void OutputDB::Submit() {
+  if (fBatch.empty()) return;
+
+  if (!fAsync) {
+    Commit(fBatch);
+    fBatch.clear();
+    CheckError();
+    return;
+  }
+
+  // Keep at most one full batch queued behind the one being committed
+  auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(fMutex);
+  fCond.wait(lock, [this]{ return fQueue.size() < 2 || !fError.empty(); });
+  fWaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fQueue.push_back(std::move(fBatch));
+  lock.unlock();
+  fCond.notify_all();
+  CheckError();
+
+  fBatch = Batch();
+  fBatch.reserve(fBatchSize);
+}
+
+void OutputDB::Close() {
+  if (fClosed) return;
+  fClosed = true;
+
+  Submit();
+  if (fAsync) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+    }
+    fCond.notify_all();
+    fThread.join();
+    CheckError();
+  }
+}
+
+void OutputDB::CheckError() {
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (!fError.empty()) {
+    std::cout << "ERROR: " << fError << std::endl;
+    exit(1);
+  }
 }
 
-void OutputDB::Put(std::string &serializeKey, std::string  &serializeString) {
+void OutputDB::Writer() {
+  while (true) {
+    Batch batch;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCond.wait(lock, [this]{ return !fQueue.empty() || fStop; });
+      if (fQueue.empty()) return;
+      batch = std::move(fQueue.front());
+    }
+    // The batch stays queued while it is committed so that Submit only
+    // runs one batch ahead of the writer
+    Commit(batch);
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fQueue.pop_front();
+    }
+    fCond.notify_all();
+  }
+}
+
+void OutputDB::Commit(Batch& batch) {
+  auto start = std::chrono::steady_clock::now();
+  std::string error;
+
   if (fLevelDB) {
-    fLevelDB->Put(fWriteOptions, serializeKey, serializeString);
+    leveldb::WriteBatch writeBatch;
+    for (auto const& record : batch)
+      writeBatch.Put(record.first, record.second);
+    leveldb::Status status = fLevelDB->Write(fWriteOptions, &writeBatch);
+    if (!status.ok())
+      error = "LevelDB batch commit failed: " + status.ToString();
   } //end if LevelDB
   else {//it must be LMDB
-    mdb_data.mv_size=serializeString.size();
-    mdb_data.mv_data=reinterpret_cast<void*>(&serializeString[0]);
-    mdb_key.mv_size=serializeKey.size();
-    mdb_key.mv_data=reinterpret_cast<void*>(&serializeKey[0]);
-    if ( mdb_put(mdb_txn,mdb_dbi,&mdb_key,&mdb_data,0)!= MDB_SUCCESS){
-      std::cout<< "ERROR: Events not loaded correctly" <<std::endl;
-    }//end if put fails
+    MDB_txn *mdb_txn;
+    MDB_val mdb_key, mdb_data;
+    if (mdb_txn_begin(mdb_env, NULL, 0, &mdb_txn) != MDB_SUCCESS) {
+      error = "Unable to begin LMDB transaction";
+    }
+    else {
+      for (auto& record : batch) {
+        mdb_data.mv_size=record.second.size();
+        mdb_data.mv_data=reinterpret_cast<void*>(&record.second[0]);
+        mdb_key.mv_size=record.first.size();
+        mdb_key.mv_data=reinterpret_cast<void*>(&record.first[0]);
+        if ( mdb_put(mdb_txn,mdb_dbi,&mdb_key,&mdb_data,0)!= MDB_SUCCESS){
+          std::cout<< "ERROR: Events not loaded correctly" <<std::endl;
+        }//end if put fails
+      }
+      if (mdb_txn_commit(mdb_txn) != MDB_SUCCESS)
+        error = "LMDB transaction commit failed";
+    }
   }//end if LMDB
-}//end OutputDB::Put
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fCommitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  ++fNBatches;
+  if (!error.empty() && fError.empty()) fError = error;
+}//end OutputDB::Commit
+
+void OutputDB::PrintSummary() const {
+  std::cout << "- " << fSample << " database: " << fNRecords << " records, "
+            << fNBytes / 1048576. << " MB in " << fNBatches << " batches" << std::endl;
+  std::cout << "  commit " << fCommitSeconds << " s";
+  if (fCommitSeconds > 0) std::cout << " (" << fNBytes / 1048576. / fCommitSeconds << " MB/s)";
+  std::cout << ", waiting on the writer " << fWaitSeconds << " s" << std::endl;
+}
 
 void fill(const Config& config, std::string input)
 {
@@ -327,10 +514,19 @@ void fill(const Config& config, std::string input)
     entries = chain.GetEntries();
   }
 
+  StageCounter readStage("read");
+  StageCounter imageStage("image");
+  StageCounter serialiseStage("serialise");
+  StageCounter putStage("put");
+
   for(unsigned int iEntry = 0; iEntry < entries; ++iEntry)
   {
     unsigned int entry = shuffled[iEntry];
+    readStage.Start();
     chain.GetEntry(entry);
+    readStage.Stop();
+
+    imageStage.Start();
 
     unsigned int nViews = 3;
 
@@ -345,7 +541,9 @@ void fill(const Config& config, std::string input)
     imageUtils.SetLogScale(config.fSetLog);
     imageUtils.SetViewReversal(config.fReverseViews);
     imageUtils.ConvertChargeVectorsToPixelArray(fPMap_fPEX, fPMap_fPEY, fPMap_fPEZ, pixelArray);
+    imageStage.Stop();
 
+    serialiseStage.Start();
     caffe::Datum datum;
     datum.set_height(config.fPlaneLimit);
     datum.set_width(config.fTDCLimit);
@@ -355,13 +553,16 @@ void fill(const Config& config, std::string input)
     datum.set_label(fInt);
 
     datum.SerializeToString(&serializeString);
+    serialiseStage.Stop();
 
     if(iEntry % (blockSize))
     {
       snprintf(key, config.fMaxKeyLength, "%08lld", (long long int)iTrain);
       std::string serializeKey(key);
 
+      putStage.Start();
       TrainDB.Put(serializeKey,serializeString);
+      putStage.Stop();
 
       regressionDataTrain[iTrain][0] = 1.;
       regressionDataTrain[iTrain][1] = 1.;
@@ -385,7 +586,9 @@ void fill(const Config& config, std::string input)
       snprintf(key, config.fMaxKeyLength, "%08lld", (long long int)iTest);
       std::string serializeKey(key);
 
+      putStage.Start();
       TestDB.Put(serializeKey,serializeString);
+      putStage.Stop();
 
       regressionDataTest[iTest][0] = 1.;
       regressionDataTest[iTest][1] = 1.;
@@ -397,6 +600,17 @@ void fill(const Config& config, std::string input)
 
   }
 
+  // Commit the last batches before reporting the throughput
+  TrainDB.Close();
+  TestDB.Close();
+
+  readStage.Print();
+  imageStage.Print();
+  serialiseStage.Print();
+  putStage.Print();
+  TrainDB.PrintSummary();
+  TestDB.PrintSummary();
+
   if (config.fWriteRegressionHDF5)
   {
 
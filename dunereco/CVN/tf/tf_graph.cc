@@ -15,34 +15,20 @@
 #include "tensorflow/core/public/session_options.h"
 
 // -------------------------------------------------------------------
-tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs)
+tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+                 int intra_op_threads, int inter_op_threads)
 {
     success = false; // until all is done correctly
 
     n_inputs = ninputs;
     n_outputs = noutputs;
 
-    // Force tf to only use a single core so it doesn't eat batch farms
-    tensorflow::SessionOptions options;
-    tensorflow::ConfigProto &config = options.config;
-    config.set_inter_op_parallelism_threads(1);
-    config.set_intra_op_parallelism_threads(1);
-    config.set_use_per_session_threads(false);
+    // Thread counts default to a single core so tf doesn't eat batch farms
+    fSharedSession = SessionPool::get(graph_file_name, intra_op_threads, inter_op_threads);
+    if (!fSharedSession) { return; }
+    fSession = fSharedSession->session;
 
-    auto status = tensorflow::NewSession(options, &fSession);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
-    tensorflow::GraphDef graph_def;
-    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    const tensorflow::GraphDef & graph_def = *fSharedSession->graph_def;
 
     size_t ng = graph_def.node().size();
 
@@ -105,23 +91,12 @@ tf::Graph::Graph(const char* graph_file_name, const std::vector<std::string> & o
         return;
     }
 
-    status = fSession->Create(graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
     success = true; // ok, graph loaded from the file
 }
 
 tf::Graph::~Graph()
 {
-    if ( ! fSession->Close().ok() ) {
-      std::cout << "tf::Graph::dtor: " << "Close failed." << std::endl;
-    }
-    //fSession->Close();
-    delete fSession;
+    // the session is closed by the pool once its last user is gone
 }
 
 // -------------------------------------------------------------------
@@ -190,6 +165,55 @@ std::vector< std::vector< std::vector<float> > > tf::Graph::run(
 
 // -------------------------------------------------------------------
 
+void tf::Graph::reserve_batch(long long int max_samples, long long int rows, long long int cols, long long int depth)
+{
+    if ((max_samples <= fBatchCapacity) && (rows == fBatchRows) && (cols == fBatchCols) && (depth == fBatchDepth))
+        return;
+
+    fBatchInputs.clear();
+    if (n_inputs == 1)
+    {
+        fBatchInputs.push_back(tensorflow::Tensor(tensorflow::DT_FLOAT, tensorflow::TensorShape({ max_samples, rows, cols, depth })));
+    }
+    else
+    {
+        for(int i=0; i<n_inputs; ++i){
+            fBatchInputs.push_back(tensorflow::Tensor(tensorflow::DT_FLOAT, tensorflow::TensorShape({ max_samples, rows, cols, 1 })));
+        }
+    }
+
+    fBatchCapacity = max_samples;
+    fBatchRows = rows;
+    fBatchCols = cols;
+    fBatchDepth = depth;
+}
+
+float* tf::Graph::batch_input(int input, long long int sample)
+{
+    auto & t = fBatchInputs[input];
+    long long int sample_size = t.NumElements() / t.dim_size(0);
+    return t.flat<float>().data() + sample * sample_size;
+}
+
+std::vector< std::vector< std::vector< float > > > tf::Graph::run_batch(long long int samples)
+{
+    if ((samples <= 0) || fBatchInputs.empty())
+        return std::vector< std::vector< std::vector<float> > >();
+
+    if (samples > fBatchCapacity) { samples = fBatchCapacity; }
+
+    // Slice shares the underlying buffer, so only the filled samples are passed on
+    std::vector< tensorflow::Tensor > _x;
+    for (const auto & t : fBatchInputs)
+    {
+        _x.push_back(t.Slice(0, samples));
+    }
+
+    return run(_x);
+}
+
+// -------------------------------------------------------------------
+
 std::vector< std::vector< std::vector< float > > > tf::Graph::run(const std::vector< tensorflow::Tensor > & x)
 {
     std::vector< std::pair<std::string, tensorflow::Tensor> > inputs;
@@ -14,6 +14,8 @@
 #include <vector>
 #include <string>
 
+#include "dunereco/CVN/tf/tf_session_pool.h"
+
 namespace tensorflow
 {
     class Session;
@@ -29,10 +31,12 @@ public:
    int n_inputs = 1;
    int n_outputs = 1;
 
-   static std::unique_ptr<Graph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1)
+   // the session is shared with every other graph object using the same file and thread counts
+   static std::unique_ptr<Graph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1,
+                                        int intra_op_threads = 1, int inter_op_threads = 1)
     {
         bool success;
-        std::unique_ptr<Graph> ptr(new Graph(graph_file_name, outputs, success, ninputs, noutputs));
+        std::unique_ptr<Graph> ptr(new Graph(graph_file_name, outputs, success, ninputs, noutputs, intra_op_threads, inter_op_threads));
         if (success) { return ptr; }
         else { return nullptr; }
     }
@@ -48,14 +52,32 @@ public:
 	long long int samples = -1);
     std::vector< std::vector < std::vector< float > > > run(const std::vector< tensorflow::Tensor > & x);
 
+    // preallocate reusable input tensors for batches of up to max_samples images of
+    // rows x cols x depth; multi-input networks get one rows x cols x 1 tensor per input
+    void reserve_batch(long long int max_samples, long long int rows, long long int cols, long long int depth);
+
+    // pointer to the contiguous (NHWC) data of one sample in the reusable input tensor
+    float* batch_input(int input, long long int sample);
+
+    // run on the first samples entries of the reusable input tensors, without copying them
+    std::vector< std::vector < std::vector< float > > > run_batch(long long int samples);
+
 private:
     /// Not-throwing constructor.
-    Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs);
+    Graph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+          int intra_op_threads, int inter_op_threads);
 
+    std::shared_ptr<SharedSession> fSharedSession;
     tensorflow::Session* fSession;
     //std::vector< std::string > fInputNames;
     std::vector< std::string > fInputNames;
     std::vector< std::string > fOutputNames;
+
+    std::vector< tensorflow::Tensor > fBatchInputs;
+    long long int fBatchCapacity = 0;
+    long long int fBatchRows = 0;
+    long long int fBatchCols = 0;
+    long long int fBatchDepth = 0;
 };
 
 } // namespace tf
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Class:       SessionPool
+// Process-wide cache of Tensorflow sessions keyed by graph file and thread settings.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "tf_session_pool.h"
+
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "larrecodnn/ImagePatternAlgs/Tensorflow/quiet_session.h"
+#include "tensorflow/core/platform/env.h"
+
+#include "tensorflow/core/public/session_options.h"
+
+// -------------------------------------------------------------------
+tf::SharedSession::SharedSession() : graph_def(new tensorflow::GraphDef()) {}
+
+tf::SharedSession::~SharedSession()
+{
+    if (!session) return;
+    if ( ! session->Close().ok() ) {
+      std::cout << "tf::SharedSession::dtor: " << "Close failed." << std::endl;
+    }
+    delete session;
+}
+
+// -------------------------------------------------------------------
+std::shared_ptr<tf::SharedSession> tf::SessionPool::get(const std::string & graph_file_name,
+                                                        int intra_op_threads, int inter_op_threads)
+{
+    typedef std::tuple<std::string, int, int> Key;
+    static std::mutex poolMutex;
+    static std::map< Key, std::weak_ptr<SharedSession> > pool;
+
+    // Loading is done under the lock so that a model is only ever read once
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    const Key key(graph_file_name, intra_op_threads, inter_op_threads);
+    auto it = pool.find(key);
+    if (it != pool.end())
+    {
+        if (auto shared = it->second.lock()) { return shared; }
+    }
+
+    std::shared_ptr<SharedSession> shared = std::make_shared<SharedSession>();
+
+    tensorflow::SessionOptions options;
+    tensorflow::ConfigProto &config = options.config;
+    config.set_inter_op_parallelism_threads(inter_op_threads);
+    config.set_intra_op_parallelism_threads(intra_op_threads);
+    config.set_use_per_session_threads(false);
+
+    auto status = tensorflow::NewSession(options, &shared->session);
+    if (!status.ok())
+    {
+        std::cout << status.ToString() << std::endl;
+        shared->session = nullptr;
+        return nullptr;
+    }
+
+    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, shared->graph_def.get());
+    if (!status.ok())
+    {
+        std::cout << status.ToString() << std::endl;
+        return nullptr;
+    }
+
+    status = shared->session->Create(*shared->graph_def);
+    if (!status.ok())
+    {
+        std::cout << status.ToString() << std::endl;
+        return nullptr;
+    }
+
+    pool[key] = shared;
+    return shared;
+}
+// -------------------------------------------------------------------
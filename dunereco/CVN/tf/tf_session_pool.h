@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//// Class:       SessionPool
+//// Process-wide cache of Tensorflow sessions keyed by graph file and thread settings. Every graph
+//// object (and every art schedule) that uses the same model shares one loaded session, since
+//// tensorflow::Session::Run is safe to call concurrently.
+////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SessionPool_h
+#define SessionPool_h
+
+#include <memory>
+#include <string>
+
+namespace tensorflow
+{
+    class Session;
+    class GraphDef;
+}
+
+namespace tf
+{
+
+struct SharedSession
+{
+    std::unique_ptr<tensorflow::GraphDef> graph_def; // kept for looking up input/output names
+    tensorflow::Session* session = nullptr;
+
+    SharedSession();
+    ~SharedSession();
+};
+
+class SessionPool
+{
+public:
+    // session for this graph file and thread configuration, loaded on first use and released
+    // when the last user goes away; nullptr (with the reason printed) if it cannot be loaded.
+    // Thread counts of 0 leave the choice to Tensorflow.
+    static std::shared_ptr<SharedSession> get(const std::string & graph_file_name,
+                                              int intra_op_threads = 1, int inter_op_threads = 1);
+};
+
+} // namespace tf
+
+#endif
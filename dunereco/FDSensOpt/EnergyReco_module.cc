@@ -89,6 +89,9 @@ EnergyReco::EnergyReco(fhicl::ParameterSet const& pset) :
 
 void EnergyReco::produce(art::Event& evt)
 {
+    // Reuse the association finders of the dune_ana utilities for the rest of this event
+    dune_ana::DUNEAnaAssocCache assocCache(evt);
+
     std::unique_ptr<dune::EnergyRecoOutput> energyRecoOutput;
     auto assnstrk = std::make_unique<art::Assns<dune::EnergyRecoOutput, recob::Track>>();
     auto assnsshw = std::make_unique<art::Assns<dune::EnergyRecoOutput, recob::Shower>>();
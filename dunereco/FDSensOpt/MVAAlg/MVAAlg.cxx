@@ -14,6 +14,8 @@
 #include "TPrincipal.h"
 #include "TVectorD.h"
 #include "TF1.h"
+#include "TTree.h"
+#include "TBranch.h"
 #include "canvas/Persistency/Common/FindManyP.h"
 #include "canvas/Persistency/Common/FindOneP.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -461,7 +463,7 @@ void dunemva::MVAAlg::CalculateInputs( ){
   float vtxy = 0;
   float vtxz = 100000;
   if (nvtx>0){
-    for (int i = 0; i<nvtx&&i<kMaxVertices; ++i){
+    for (int i = 0; i<nvtx; ++i){
       if (vtx[i][2]<vtxz){
         vtxx = vtx[i][0];
         vtxy = vtx[i][1];
@@ -646,7 +648,7 @@ void dunemva::MVAAlg::CalculateInputs( ){
     int shwwire1 = -1;
     int offset = 0;
     //int lastwire = -1;
-    for (int i = 0; i<nhits && i<40000; ++i){
+    for (int i = 0; i<nhits; ++i){
       if (itrk!=-1){
         if (hit_trkkey[i]==itrk){
           // dont use hit_dEds until is is saved in Reco
@@ -755,7 +757,7 @@ void dunemva::MVAAlg::CalculateInputs( ){
       float ipl_evtcharge = 0;
       int npida = 0;
       std::vector<float> vhitq;
-      for (int i = 0; i<nhits && i<40000; ++i){ // only 40000 hits saved after Reco
+      for (int i = 0; i<nhits; ++i){
         for (int j = 0; j<2; ++j){  // planes with top 2 # of hits (ipl[j])
           if (hit_plane[i] == ipl[j]){
             if (hit_trkkey[i] == itrk){
@@ -826,7 +828,7 @@ void dunemva::MVAAlg::CalculateInputs( ){
     offset = 0;
     //lastwire = -1;
 
-    for (int i = 0; i<nhits && i<40000; ++i){
+    for (int i = 0; i<nhits; ++i){
       if (hit_plane[i]==2&&hit_shwkey[i]==ishw){
         frshower+=hit_charge[i]*exp(hit_peakT[i]*0.5/taulife);
         shwwires[hit_wire[i]] = 1;
@@ -906,9 +908,11 @@ void dunemva::MVAAlg::CalculateInputs( ){
         hfrshower[itype]->Fill(frshower,oscpro*norm);
         hnhitspershw[itype]->Fill(nhitspershw,oscpro*norm);
         hfr100w[itype]->Fill(fract_100_wires,oscpro*norm);
-        hdisx[itype]->Fill(shwstartx[ishw]-trkstartx[itrk],oscpro*norm);
-        hdisy[itype]->Fill(shwstarty[ishw]-trkstarty[itrk],oscpro*norm);
-        hdisz[itype]->Fill(shwstartz[ishw]-trkstartz[itrk],oscpro*norm);
+        if (itrk!=-1){
+          hdisx[itype]->Fill(shwstartx[ishw]-trkstartx[itrk],oscpro*norm);
+          hdisy[itype]->Fill(shwstarty[ishw]-trkstarty[itrk],oscpro*norm);
+          hdisz[itype]->Fill(shwstartz[ishw]-trkstartz[itrk],oscpro*norm);
+        }
       }
     }
 
@@ -1203,14 +1207,20 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
      */
   //charge from wires
   wirecharge = 0;
+  // lifetime correction for each tick, so that there is no exp per ROI sample
+  std::vector<double> tickcorr;
   for (size_t i = 0; i<wirelist.size(); ++i){
     if (fGeom->SignalType(wirelist[i]->Channel()) == geo::kCollection){
       const recob::Wire::RegionsOfInterest_t& signalROI = wirelist[i]->SignalROI();
       for(const auto& range : signalROI.get_ranges()){
         const std::vector<float>& signal = range.data();
-        raw::TDCtick_t roiFirstBinTick = range.begin_index();
+        size_t roiFirstBinTick = range.begin_index();
+        for (size_t t = tickcorr.size(); t<roiFirstBinTick+signal.size(); ++t){
+          tickcorr.push_back(exp(t*0.5/taulife));
+        }
+        const double* corr = tickcorr.data()+roiFirstBinTick;
         for (size_t j = 0; j<signal.size(); ++j){
-          wirecharge += signal[j]*exp((j+roiFirstBinTick)*0.5/taulife);
+          wirecharge += signal[j]*corr[j];
         }
       }
     }
@@ -1218,8 +1228,9 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   //hit information
   nhits = hitlist.size();
-  nhits_stored = std::min(nhits, kMaxHits);
-  for (int i = 0; i < nhits && i < kMaxHits ; ++i){//loop over hits
+  nhits_stored = nhits;
+  ResizeHits(nhits);
+  for (int i = 0; i < nhits ; ++i){//loop over hits
     hit_channel[i] = hitlist[i]->Channel();
     hit_plane[i]   = hitlist[i]->WireID().Plane;
     hit_wire[i]    = hitlist[i]->WireID().Wire;
@@ -1232,12 +1243,54 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   }
 
+  // Back-track every hit once, the truth matching of tracks and showers
+  // below accumulates over this table instead of asking the back-tracker
+  // again for each track, shower and hit near the vertex.
+  std::vector<std::vector<sim::TrackIDE>> hitTrackIDEs;
+  if (!isdata){
+    hitTrackIDEs.reserve(hitlist.size());
+    for (size_t i = 0; i<hitlist.size(); ++i){
+      hitTrackIDEs.push_back(bt_serv->HitToTrackIDEs(clockData, hitlist[i]));
+    }
+  }
+  // hits from another collection are back-tracked on demand, still only once
+  std::map<art::Ptr<recob::Hit>, std::vector<sim::TrackIDE>> otherHitTrackIDEs;
+  auto getHitTrackIDEs = [&](const art::Ptr<recob::Hit>& hit) -> const std::vector<sim::TrackIDE>& {
+    if (hitListHandle && hit.id() == hitListHandle.id() && hit.key() < hitTrackIDEs.size()){
+      return hitTrackIDEs[hit.key()];
+    }
+    auto it = otherHitTrackIDEs.find(hit);
+    if (it == otherHitTrackIDEs.end()){
+      it = otherHitTrackIDEs.emplace(hit, bt_serv->HitToTrackIDEs(clockData, hit)).first;
+    }
+    return it->second;
+  };
+  // true particle that deposited the most energy in a set of hits
+  auto getTrueTrackID = [&](const std::vector<art::Ptr<recob::Hit>>& allHits){
+    std::map<int,double> trkide;
+    for(size_t h = 0; h < allHits.size(); ++h){
+      for(const sim::TrackIDE& ide : getHitTrackIDEs(allHits[h])){
+        trkide[ide.trackID] += ide.energy;
+      }
+    }
+    int TrackID = 0;
+    double maxe = -1;
+    for (std::map<int,double>::iterator ii = trkide.begin(); ii!=trkide.end(); ++ii){
+      if ((ii->second)>maxe){
+        maxe = ii->second;
+        TrackID = ii->first;
+      }
+    }
+    return TrackID;
+  };
+
   //track information
   ntracks_reco=tracklist.size();
+  ResizeTracks(ntracks_reco);
 
   recob::Track::Vector_t larStart;
   recob::Track::Vector_t larEnd;
-  for(int i=0; i<std::min(int(tracklist.size()),kMaxTrack);++i){
+  for(int i=0; i<ntracks_reco;++i){
     recob::Track::Point_t trackStart, trackEnd;
     std::tie(trackStart, trackEnd) = tracklist[i]->Extent(); 
     larStart = tracklist[i]->VertexDirection();
@@ -1261,7 +1314,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
       auto vhit = fmthm.at(i);
       auto vmeta = fmthm.data(i);
       for (size_t h = 0; h < vhit.size(); ++h){
-        if (vhit[h].key()<kMaxHits){
+        if (vhit[h].key()<hit_trkkey.size()){
           hit_trkkey[vhit[h].key()] = tracklist[i].key();
           if (vmeta[h]->Dx()){
             hit_dQds[vhit[h].key()] = vhit[h]->Integral()*fCalorimetryAlg.LifetimeCorrection(clockData, detProp, vhit[h]->PeakTime())/vmeta[h]->Dx();
@@ -1274,7 +1327,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
     else if (fmth.isValid()){
       std::vector< art::Ptr<recob::Hit> > vhit = fmth.at(i);
       for (size_t h = 0; h < vhit.size(); ++h){
-        if (vhit[h].key()<kMaxHits){
+        if (vhit[h].key()<hit_trkkey.size()){
           hit_trkkey[vhit[h].key()] = tracklist[i].key();
         }
       }
@@ -1304,27 +1357,8 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
     }
     if (!isdata&&fmth.isValid()){
       // Find true track for each reconstructed track
-      int TrackID = 0;
       std::vector< art::Ptr<recob::Hit> > allHits = fmth.at(i);
-
-      std::map<int,double> trkide;
-      for(size_t h = 0; h < allHits.size(); ++h){
-        art::Ptr<recob::Hit> hit = allHits[h];
-        std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
-        for(size_t e = 0; e < TrackIDs.size(); ++e){
-          trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
-        }	    
-      }
-      // Work out which IDE despoited the most charge in the hit if there was more than one.
-      double maxe = -1;
-      double tote = 0;
-      for (std::map<int,double>::iterator ii = trkide.begin(); ii!=trkide.end(); ++ii){
-        tote += ii->second;
-        if ((ii->second)>maxe){
-          maxe = ii->second;
-          TrackID = ii->first;
-        }
-      }
+      int TrackID = getTrueTrackID(allHits);
       // Now have trackID, so get PdG code and T0 etc.
       const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackID);
       if (particle){
@@ -1366,7 +1400,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
               if (sqrt(pow(spts[0]->XYZ()[0]-x,2)+
                     pow(spts[0]->XYZ()[1]-y,2)+
                     pow(spts[0]->XYZ()[2]-z,2))<3){
-                std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
+                const std::vector<sim::TrackIDE>& TrackIDs = getHitTrackIDEs(hit);
                 float toten = 0;
                 for(size_t e = 0; e < TrackIDs.size(); ++e){
                   //sum_energy += TrackIDs[e].energy;
@@ -1416,7 +1450,8 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   //vertex information
   nvtx = vtxlist.size();
-  for (int i = 0; i < nvtx && i < kMaxVertices ; ++i){//loop over hits
+  ResizeVertices(nvtx);
+  for (int i = 0; i < nvtx ; ++i){//loop over hits
     Double_t xyz[3] = {};
     vtxlist[i]->XYZ(xyz);
     for (size_t j = 0; j<3; ++j) vtx[i][j] = xyz[j];
@@ -1427,8 +1462,9 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
     art::FindManyP<recob::Hit> fmsh(shwListHandle, evt, fShowerModuleLabel);
 
     nshws = shwlist.size();
+    ResizeShowers(nshws);
 
-    for (int i = 0; i<std::min(int(shwlist.size()),kMaxShower); ++i){
+    for (int i = 0; i<nshws; ++i){
       shwid[i] = shwlist[i]->ID();
       shwdcosx[i] = shwlist[i]->Direction().X(); 
       shwdcosy[i] = shwlist[i]->Direction().Y(); 
@@ -1446,33 +1482,14 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
       if (fmsh.isValid()){
         auto vhit = fmsh.at(i);
         for (size_t h = 0; h < vhit.size(); ++h){
-          if (vhit[h].key()<kMaxHits){
+          if (vhit[h].key()<hit_trkkey.size()){
             hit_shwkey[vhit[h].key()] = shwlist[i].key();
           }
         }
       }
       if (!isdata&&fmsh.isValid()){
         // Find true track for each reconstructed track
-        int TrackID = 0;
-        std::vector< art::Ptr<recob::Hit> > allHits = fmsh.at(i);
-        std::map<int,double> trkide;
-        for(size_t h = 0; h < allHits.size(); ++h){
-          art::Ptr<recob::Hit> hit = allHits[h];
-          std::vector<sim::TrackIDE> TrackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
-          for(size_t e = 0; e < TrackIDs.size(); ++e){
-            trkide[TrackIDs[e].trackID] += TrackIDs[e].energy;
-          }	    
-        }
-        // Work out which IDE despoited the most charge in the hit if there was more than one.
-        double maxe = -1;
-        double tote = 0;
-        for (std::map<int,double>::iterator ii = trkide.begin(); ii!=trkide.end(); ++ii){
-          tote += ii->second;
-          if ((ii->second)>maxe){
-            maxe = ii->second;
-            TrackID = ii->first;
-          }
-        }
+        int TrackID = getTrueTrackID(fmsh.at(i));
         // Now have trackID, so get PdG code and T0 etc.
         const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackID);
         if (particle){
@@ -1484,7 +1501,8 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   // flash information
   flash_total = flashlist.size();
-  for ( int f = 0; f < std::min(flash_total,kMaxHits); ++f ) {
+  ResizeFlashes(flash_total);
+  for ( int f = 0; f < flash_total; ++f ) {
     flash_time[f]      = flashlist[f]->Time();
     flash_width[f]     = flashlist[f]->TimeWidth();
     flash_abstime[f]   = flashlist[f]->AbsTime();
@@ -1637,6 +1655,7 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
     no_primaries=primary;
     // ### Saving the number of Geant4 particles ###
     geant_list_size=geant_particle;
+    ResizeGeantParticles(geant_list_size);
 
     // ### Looping over all the Geant4 particles ###
     for( unsigned int i = 0; i < geant_part.size(); ++i ){
@@ -1691,8 +1710,10 @@ void dunemva::MVAAlg::PrepareEvent(const art::Event& evt){
 
   }//is neutrino
 
-  if(fMakeAnaTree) 
+  if(fMakeAnaTree){
+    SetColumnAddresses();
     fTree->Fill();
+  }
 
 }
 
@@ -1766,89 +1787,21 @@ void dunemva::MVAAlg::ResetVars(){
   isdata = -9999;
 
   ntracks_reco = 0;
-  for (int i = 0; i < kMaxTrack; ++i){
-    trkid[i] = -9999;
-    trkstartx[i] = -9999;
-    trkstarty[i] = -9999;
-    trkstartz[i] = -9999;
-    trkendx[i] = -9999;
-    trkendy[i] = -9999;
-    trkendz[i] = -9999;
-    trkstartdcosx[i] = -9999;
-    trkstartdcosy[i] = -9999;
-    trkstartdcosz[i] = -9999;
-    trkenddcosx[i] = -9999;
-    trkenddcosy[i] = -9999;
-    trkenddcosz[i] = -9999;
-    trklen[i] = -9999;
-    trkbestplane[i] = -9999;
-    for (int j = 0; j<3; ++j){
-      trkke[i][j] = -9999;
-      trkpida[i][j] = -9999;
-    }
-    trkg4id[i] = -9999;
-    trkg4pdg[i] = -9999;
-    trkg4startx[i] = -9999;
-    trkg4starty[i] = -9999;
-    trkg4startz[i] = -9999;
-    trkg4initdedx[i] = -9999;
-  }
+  ResizeTracks(0);
 
   nshws = 0;
-  for (int i = 0; i<kMaxShower; ++i){
-    shwid[i] = -9999;
-    shwdcosx[i] = -9999;
-    shwdcosy[i] = -9999;
-    shwdcosz[i] = -9999;
-    shwstartx[i] = -9999;
-    shwstarty[i] = -9999;
-    shwstartz[i] = -9999;
-    for (int j = 0; j<3; ++j){
-      shwenergy[i][j] = -9999;
-      shwdedx[i][j] = -9999;
-    }
-    shwbestplane[i] = -9999;
-    trkg4id[i] = -9999;
-  }
+  ResizeShowers(0);
 
   flash_total = 0;
-  for (int f = 0; f < kMaxFlash; ++f) {
-    flash_time[f]    = -9999;
-    flash_width[f]   = -9999;
-    flash_abstime[f] = -9999;
-    flash_YCenter[f] = -9999;
-    flash_YWidth[f]  = -9999;
-    flash_ZCenter[f] = -9999;
-    flash_ZWidth[f]  = -9999;
-    flash_TotalPE[f] = -9999;
-  }
+  ResizeFlashes(0);
 
   nhits = 0;
   nhits_stored = 0;
-  for (int i = 0; i<kMaxHits; ++i){
-    hit_plane[i] = -9999;
-    hit_wire[i] = -9999;
-    hit_tpc[i] = -9999;
-    hit_channel[i] = -9999;
-    hit_peakT[i] = -9999;
-    hit_charge[i] = -9999;
-    hit_summedADC[i] = -9999;
-    hit_startT[i] = -9999;
-    hit_endT[i] = -9999;
-    hit_trkkey[i] = -9999;
-    hit_dQds[i] = -9999;
-    hit_dEds[i] = -9999;
-    hit_resrange[i] = -9999;
-    hit_shwkey[i] = -9999;
-  }
+  ResizeHits(0);
 
   infidvol = 0;
   nvtx = 0;
-  for (int i = 0; i<kMaxVertices; ++i){
-    vtx[i][0] = -9999;
-    vtx[i][1] = -9999;
-    vtx[i][2] = -9999;
-  }
+  ResizeVertices(0);
   vtxrecomc = 9999;
   vtxrecomcx = 9999;
   vtxrecomcy = 9999;
@@ -1879,26 +1832,7 @@ void dunemva::MVAAlg::ResetVars(){
 
   no_primaries = -99999;
   geant_list_size=-9999;
-  for (int i = 0; i<kMaxPrimaries; ++i){
-    pdg[i] = -99999;
-    Eng[i] = -99999;
-    Px[i] = -99999;
-    Py[i] = -99999;
-    Pz[i] = -99999;
-    StartPointx[i] = -99999;
-    StartPointy[i] = -99999;
-    StartPointz[i] = -99999;
-    EndPointx[i] = -99999;
-    EndPointy[i] = -99999;
-    EndPointz[i] = -99999;
-    Startdcosx[i]= -99999;
-    Startdcosy[i]= -99999;
-    Startdcosz[i]= -99999;
-    NumberDaughters[i] = -99999;
-    Mother[i] = -99999;
-    TrackId[i] = -99999;
-    process_primary[i] = -99999;
-  }
+  ResizeGeantParticles(0);
 
   ptype_flux = -99999;
   pdpx_flux = -99999;
@@ -1915,6 +1849,121 @@ void dunemva::MVAAlg::ResetVars(){
 }
 
 
+void dunemva::MVAAlg::ResizeTracks(int n){
+
+  trkid.assign(n, -9999);
+  trkstartx.assign(n, -9999);
+  trkstarty.assign(n, -9999);
+  trkstartz.assign(n, -9999);
+  trkendx.assign(n, -9999);
+  trkendy.assign(n, -9999);
+  trkendz.assign(n, -9999);
+  trkstartdcosx.assign(n, -9999);
+  trkstartdcosy.assign(n, -9999);
+  trkstartdcosz.assign(n, -9999);
+  trkenddcosx.assign(n, -9999);
+  trkenddcosy.assign(n, -9999);
+  trkenddcosz.assign(n, -9999);
+  trklen.assign(n, -9999);
+  trkbestplane.assign(n, -9999);
+  trkke.assign(n, {-9999, -9999, -9999});
+  trkpida.assign(n, {-9999, -9999, -9999});
+  trkg4id.assign(n, -9999);
+  trkg4pdg.assign(n, -9999);
+  trkg4startx.assign(n, -9999);
+  trkg4starty.assign(n, -9999);
+  trkg4startz.assign(n, -9999);
+  trkg4initdedx.assign(n, -9999);
+}
+
+void dunemva::MVAAlg::ResizeShowers(int n){
+
+  shwid.assign(n, -9999);
+  shwdcosx.assign(n, -9999);
+  shwdcosy.assign(n, -9999);
+  shwdcosz.assign(n, -9999);
+  shwstartx.assign(n, -9999);
+  shwstarty.assign(n, -9999);
+  shwstartz.assign(n, -9999);
+  shwenergy.assign(n, {-9999, -9999, -9999});
+  shwdedx.assign(n, {-9999, -9999, -9999});
+  shwbestplane.assign(n, -9999);
+  shwg4id.assign(n, -9999);
+}
+
+void dunemva::MVAAlg::ResizeHits(int n){
+
+  hit_plane.assign(n, -9999);
+  hit_wire.assign(n, -9999);
+  hit_tpc.assign(n, -9999);
+  hit_channel.assign(n, -9999);
+  hit_peakT.assign(n, -9999);
+  hit_charge.assign(n, -9999);
+  hit_summedADC.assign(n, -9999);
+  hit_startT.assign(n, -9999);
+  hit_endT.assign(n, -9999);
+  hit_trkkey.assign(n, -9999);
+  hit_dQds.assign(n, -9999);
+  hit_dEds.assign(n, -9999);
+  hit_resrange.assign(n, -9999);
+  hit_shwkey.assign(n, -9999);
+}
+
+void dunemva::MVAAlg::ResizeVertices(int n){
+
+  vtx.assign(n, {-9999, -9999, -9999});
+}
+
+void dunemva::MVAAlg::ResizeFlashes(int n){
+
+  flash_time.assign(n, -9999);
+  flash_width.assign(n, -9999);
+  flash_abstime.assign(n, -9999);
+  flash_YCenter.assign(n, -9999);
+  flash_YWidth.assign(n, -9999);
+  flash_ZCenter.assign(n, -9999);
+  flash_ZWidth.assign(n, -9999);
+  flash_TotalPE.assign(n, -9999);
+}
+
+void dunemva::MVAAlg::ResizeGeantParticles(int n){
+
+  pdg.assign(n, -99999);
+  Eng.assign(n, -99999);
+  Px.assign(n, -99999);
+  Py.assign(n, -99999);
+  Pz.assign(n, -99999);
+  StartPointx.assign(n, -99999);
+  StartPointy.assign(n, -99999);
+  StartPointz.assign(n, -99999);
+  EndPointx.assign(n, -99999);
+  EndPointy.assign(n, -99999);
+  EndPointz.assign(n, -99999);
+  Startdcosx.assign(n, -99999);
+  Startdcosy.assign(n, -99999);
+  Startdcosz.assign(n, -99999);
+  NumberDaughters.assign(n, -99999);
+  Mother.assign(n, -99999);
+  TrackId.assign(n, -99999);
+  process_primary.assign(n, -99999);
+}
+
+template <class T>
+void dunemva::MVAAlg::ColumnBranch(const char* name, std::vector<T>& column, const char* leaflist){
+
+  // ROOT wants a valid address when the branch is booked
+  if (column.capacity()==0) column.reserve(1);
+  TBranch *branch = fTree->Branch(name, column.data(), leaflist);
+  fColumnAddressSetters.push_back([branch, &column](){ branch->SetAddress(column.data()); });
+}
+
+void dunemva::MVAAlg::SetColumnAddresses(){
+
+  // The columns may have been reallocated since the last fill
+  for (auto const& setAddress : fColumnAddressSetters) setAddress();
+}
+
+
 void dunemva::MVAAlg::MakeTree(){
 
   fTree = tfs->make<TTree>("nueana","analysis tree");
@@ -1925,69 +1974,69 @@ void dunemva::MVAAlg::MakeTree(){
   fTree->Branch("taulife",&taulife,"taulife/F");
   fTree->Branch("isdata",&isdata,"isdata/S");
   fTree->Branch("ntracks_reco",&ntracks_reco,"ntracks_reco/I");
-  fTree->Branch("trkid",trkid,"trkid[ntracks_reco]/I");
-  fTree->Branch("trkstartx",trkstartx,"trkstartx[ntracks_reco]/F");
-  fTree->Branch("trkstarty",trkstarty,"trkstarty[ntracks_reco]/F");
-  fTree->Branch("trkstartz",trkstartz,"trkstartz[ntracks_reco]/F");
-  fTree->Branch("trkendx",trkendx,"trkendx[ntracks_reco]/F");
-  fTree->Branch("trkendy",trkendy,"trkendy[ntracks_reco]/F");
-  fTree->Branch("trkendz",trkendz,"trkendz[ntracks_reco]/F");
-  fTree->Branch("trkstartdcosx",trkstartdcosx,"trkstartdcosx[ntracks_reco]/F");
-  fTree->Branch("trkstartdcosy",trkstartdcosy,"trkstartdcosy[ntracks_reco]/F");
-  fTree->Branch("trkstartdcosz",trkstartdcosz,"trkstartdcosz[ntracks_reco]/F");
-  fTree->Branch("trkenddcosx",trkenddcosx,"trkenddcosx[ntracks_reco]/F");
-  fTree->Branch("trkenddcosy",trkenddcosy,"trkenddcosy[ntracks_reco]/F");
-  fTree->Branch("trkenddcosz",trkenddcosz,"trkenddcosz[ntracks_reco]/F");
-  fTree->Branch("trklen",trklen,"trklen[ntracks_reco]/F");
-  fTree->Branch("trkbestplane",trkbestplane,"trkbestplane[ntracks_reco]/I");
-  fTree->Branch("trkke",trkke,"trkke[ntracks_reco][3]/F");
-  fTree->Branch("trkpida",trkpida,"trkpida[ntracks_reco][3]/F");
-  fTree->Branch("trkg4id",trkg4id,"trkg4id[ntracks_reco]/I");
-  fTree->Branch("trkg4pdg",trkg4pdg,"trkg4pdg[ntracks_reco]/I");
-  fTree->Branch("trkg4startx",trkg4startx,"trkg4startx[ntracks_reco]/F");
-  fTree->Branch("trkg4starty",trkg4starty,"trkg4starty[ntracks_reco]/F");
-  fTree->Branch("trkg4startz",trkg4startz,"trkg4startz[ntracks_reco]/F");
-  fTree->Branch("trkg4initdedx",trkg4initdedx,"trkg4initdedx[ntracks_reco]/F");
+  ColumnBranch("trkid",trkid,"trkid[ntracks_reco]/I");
+  ColumnBranch("trkstartx",trkstartx,"trkstartx[ntracks_reco]/F");
+  ColumnBranch("trkstarty",trkstarty,"trkstarty[ntracks_reco]/F");
+  ColumnBranch("trkstartz",trkstartz,"trkstartz[ntracks_reco]/F");
+  ColumnBranch("trkendx",trkendx,"trkendx[ntracks_reco]/F");
+  ColumnBranch("trkendy",trkendy,"trkendy[ntracks_reco]/F");
+  ColumnBranch("trkendz",trkendz,"trkendz[ntracks_reco]/F");
+  ColumnBranch("trkstartdcosx",trkstartdcosx,"trkstartdcosx[ntracks_reco]/F");
+  ColumnBranch("trkstartdcosy",trkstartdcosy,"trkstartdcosy[ntracks_reco]/F");
+  ColumnBranch("trkstartdcosz",trkstartdcosz,"trkstartdcosz[ntracks_reco]/F");
+  ColumnBranch("trkenddcosx",trkenddcosx,"trkenddcosx[ntracks_reco]/F");
+  ColumnBranch("trkenddcosy",trkenddcosy,"trkenddcosy[ntracks_reco]/F");
+  ColumnBranch("trkenddcosz",trkenddcosz,"trkenddcosz[ntracks_reco]/F");
+  ColumnBranch("trklen",trklen,"trklen[ntracks_reco]/F");
+  ColumnBranch("trkbestplane",trkbestplane,"trkbestplane[ntracks_reco]/I");
+  ColumnBranch("trkke",trkke,"trkke[ntracks_reco][3]/F");
+  ColumnBranch("trkpida",trkpida,"trkpida[ntracks_reco][3]/F");
+  ColumnBranch("trkg4id",trkg4id,"trkg4id[ntracks_reco]/I");
+  ColumnBranch("trkg4pdg",trkg4pdg,"trkg4pdg[ntracks_reco]/I");
+  ColumnBranch("trkg4startx",trkg4startx,"trkg4startx[ntracks_reco]/F");
+  ColumnBranch("trkg4starty",trkg4starty,"trkg4starty[ntracks_reco]/F");
+  ColumnBranch("trkg4startz",trkg4startz,"trkg4startz[ntracks_reco]/F");
+  ColumnBranch("trkg4initdedx",trkg4initdedx,"trkg4initdedx[ntracks_reco]/F");
   fTree->Branch("nshws",&nshws,"nshws/I");
-  fTree->Branch("shwid",shwid,"shwid[nshws]/I");
-  fTree->Branch("shwdcosx",shwdcosx,"shwdcosx[nshws]/F");
-  fTree->Branch("shwdcosy",shwdcosy,"shwdcosy[nshws]/F");
-  fTree->Branch("shwdcosz",shwdcosz,"shwdcosz[nshws]/F");
-  fTree->Branch("shwstartx",shwstartx,"shwstartx[nshws]/F");
-  fTree->Branch("shwstarty",shwstarty,"shwstarty[nshws]/F");
-  fTree->Branch("shwstartz",shwstartz,"shwstartz[nshws]/F");
-  fTree->Branch("shwenergy",shwenergy,"shwenergy[nshws][3]/F");
-  fTree->Branch("shwdedx",shwdedx,"shwdedx[nshws][3]/F");
-  fTree->Branch("shwbestplane",shwbestplane,"shwbestplane[nshws]/I");
-  fTree->Branch("shwg4id",shwg4id,"shwg4id[nshws]/I");
+  ColumnBranch("shwid",shwid,"shwid[nshws]/I");
+  ColumnBranch("shwdcosx",shwdcosx,"shwdcosx[nshws]/F");
+  ColumnBranch("shwdcosy",shwdcosy,"shwdcosy[nshws]/F");
+  ColumnBranch("shwdcosz",shwdcosz,"shwdcosz[nshws]/F");
+  ColumnBranch("shwstartx",shwstartx,"shwstartx[nshws]/F");
+  ColumnBranch("shwstarty",shwstarty,"shwstarty[nshws]/F");
+  ColumnBranch("shwstartz",shwstartz,"shwstartz[nshws]/F");
+  ColumnBranch("shwenergy",shwenergy,"shwenergy[nshws][3]/F");
+  ColumnBranch("shwdedx",shwdedx,"shwdedx[nshws][3]/F");
+  ColumnBranch("shwbestplane",shwbestplane,"shwbestplane[nshws]/I");
+  ColumnBranch("shwg4id",shwg4id,"shwg4id[nshws]/I");
   fTree->Branch("flash_total"  ,&flash_total ,"flash_total/I");
-  fTree->Branch("flash_time"   ,flash_time   ,"flash_time[flash_total]/F");
-  fTree->Branch("flash_width"  ,flash_width  ,"flash_width[flash_total]/F");
-  fTree->Branch("flash_abstime",flash_abstime,"flash_abstime[flash_total]/F");
-  fTree->Branch("flash_YCenter",flash_YCenter,"flash_YCenter[flash_total]/F");
-  fTree->Branch("flash_YWidth" ,flash_YWidth ,"flash_YWidth[flash_total]/F");
-  fTree->Branch("flash_ZCenter",flash_ZCenter,"flash_ZCenter[flash_total]/F");
-  fTree->Branch("flash_ZWidth" ,flash_ZWidth ,"flash_ZWidth[flash_total]/F");
-  fTree->Branch("flash_TotalPE",flash_TotalPE,"flash_TotalPE[flash_total]/F");
+  ColumnBranch("flash_time"   ,flash_time   ,"flash_time[flash_total]/F");
+  ColumnBranch("flash_width"  ,flash_width  ,"flash_width[flash_total]/F");
+  ColumnBranch("flash_abstime",flash_abstime,"flash_abstime[flash_total]/F");
+  ColumnBranch("flash_YCenter",flash_YCenter,"flash_YCenter[flash_total]/F");
+  ColumnBranch("flash_YWidth" ,flash_YWidth ,"flash_YWidth[flash_total]/F");
+  ColumnBranch("flash_ZCenter",flash_ZCenter,"flash_ZCenter[flash_total]/F");
+  ColumnBranch("flash_ZWidth" ,flash_ZWidth ,"flash_ZWidth[flash_total]/F");
+  ColumnBranch("flash_TotalPE",flash_TotalPE,"flash_TotalPE[flash_total]/F");
   fTree->Branch("nhits",&nhits,"nhits/I");
   fTree->Branch("nhits_stored",&nhits_stored,"nhits_stored/I");
-  fTree->Branch("hit_plane",hit_plane,"hit_plane[nhits_stored]/S");
-  fTree->Branch("hit_tpc",hit_tpc,"hit_tpc[nhits_stored]/S");
-  fTree->Branch("hit_wire",hit_wire,"hit_wire[nhits_stored]/S");
-  fTree->Branch("hit_channel",hit_channel,"hit_channel[nhits_stored]/I");
-  fTree->Branch("hit_peakT",hit_peakT,"hit_peakT[nhits_stored]/F");
-  fTree->Branch("hit_charge",hit_charge,"hit_charge[nhits_stored]/F");
-  fTree->Branch("hit_summedADC",hit_summedADC,"hit_summedADC[nhits_stored]/F");
-  fTree->Branch("hit_startT",hit_startT,"hit_startT[nhits_stored]/F");
-  fTree->Branch("hit_endT",hit_endT,"hit_endT[nhits_stored]/F");
-  fTree->Branch("hit_trkkey",hit_trkkey,"hit_trkkey[nhits_stored]/I");
-  fTree->Branch("hit_dQds",hit_dQds,"hit_dQds[nhits_stored]/F");
-  fTree->Branch("hit_dEds",hit_dEds,"hit_dEds[nhits_stored]/F");
-  fTree->Branch("hit_resrange",hit_resrange,"hit_resrange[nhits_stored]/F");
-  fTree->Branch("hit_shwkey",hit_shwkey,"hit_shwkey[nhits_stored]/I");
+  ColumnBranch("hit_plane",hit_plane,"hit_plane[nhits_stored]/S");
+  ColumnBranch("hit_tpc",hit_tpc,"hit_tpc[nhits_stored]/S");
+  ColumnBranch("hit_wire",hit_wire,"hit_wire[nhits_stored]/S");
+  ColumnBranch("hit_channel",hit_channel,"hit_channel[nhits_stored]/I");
+  ColumnBranch("hit_peakT",hit_peakT,"hit_peakT[nhits_stored]/F");
+  ColumnBranch("hit_charge",hit_charge,"hit_charge[nhits_stored]/F");
+  ColumnBranch("hit_summedADC",hit_summedADC,"hit_summedADC[nhits_stored]/F");
+  ColumnBranch("hit_startT",hit_startT,"hit_startT[nhits_stored]/F");
+  ColumnBranch("hit_endT",hit_endT,"hit_endT[nhits_stored]/F");
+  ColumnBranch("hit_trkkey",hit_trkkey,"hit_trkkey[nhits_stored]/I");
+  ColumnBranch("hit_dQds",hit_dQds,"hit_dQds[nhits_stored]/F");
+  ColumnBranch("hit_dEds",hit_dEds,"hit_dEds[nhits_stored]/F");
+  ColumnBranch("hit_resrange",hit_resrange,"hit_resrange[nhits_stored]/F");
+  ColumnBranch("hit_shwkey",hit_shwkey,"hit_shwkey[nhits_stored]/I");
   fTree->Branch("infidvol",&infidvol,"infidvol/I");
   fTree->Branch("nvtx",&nvtx,"nvtx/S");
-  fTree->Branch("vtx",vtx,"vtx[nvtx][3]/F");
+  ColumnBranch("vtx",vtx,"vtx[nvtx][3]/F");
   fTree->Branch("vtxrecomc",&vtxrecomc,"vtxrecomc/F");
   fTree->Branch("vtxrecomcx",&vtxrecomcx,"vtxrecomcx/F");
   fTree->Branch("vtxrecomcy",&vtxrecomcy,"vtxrecomcy/F");
@@ -2016,24 +2065,24 @@ void dunemva::MVAAlg::MakeTree(){
   fTree->Branch("t0_truth",&t0_truth,"t0_truth/F");
   fTree->Branch("no_primaries",&no_primaries,"no_primaries/I");
   fTree->Branch("geant_list_size",&geant_list_size,"geant_list_size/I");
-  fTree->Branch("pdg",pdg,"pdg[geant_list_size]/I");
-  fTree->Branch("Eng",Eng,"Eng[geant_list_size]/F");
-  fTree->Branch("Px",Px,"Px[geant_list_size]/F");
-  fTree->Branch("Py",Py,"Py[geant_list_size]/F");
-  fTree->Branch("Pz",Pz,"Pz[geant_list_size]/F");
-  fTree->Branch("StartPointx",StartPointx,"StartPointx[geant_list_size]/F");
-  fTree->Branch("StartPointy",StartPointy,"StartPointy[geant_list_size]/F");
-  fTree->Branch("StartPointz",StartPointz,"StartPointz[geant_list_size]/F");
-  fTree->Branch("EndPointx",EndPointx,"EndPointx[geant_list_size]/F");
-  fTree->Branch("EndPointy",EndPointy,"EndPointy[geant_list_size]/F");
-  fTree->Branch("EndPointz",EndPointz,"EndPointz[geant_list_size]/F");
-  fTree->Branch("Startdcosx",Startdcosx,"Startdcosx[geant_list_size]/F");
-  fTree->Branch("Startdcosy",Startdcosy,"Startdcosy[geant_list_size]/F");
-  fTree->Branch("Startdcosz",Startdcosz,"Startdcosz[geant_list_size]/F");
-  fTree->Branch("N(((((((((umberDaughters",NumberDaughters,"NumberDaughters[geant_list_size]/I");
-  fTree->Branch("Mother",Mother,"Mother[geant_list_size]/I");
-  fTree->Branch("TrackId",TrackId,"TrackId[geant_list_size]/I");
-  fTree->Branch("process_primary",process_primary,"process_primary[geant_list_size]/I");
+  ColumnBranch("pdg",pdg,"pdg[geant_list_size]/I");
+  ColumnBranch("Eng",Eng,"Eng[geant_list_size]/F");
+  ColumnBranch("Px",Px,"Px[geant_list_size]/F");
+  ColumnBranch("Py",Py,"Py[geant_list_size]/F");
+  ColumnBranch("Pz",Pz,"Pz[geant_list_size]/F");
+  ColumnBranch("StartPointx",StartPointx,"StartPointx[geant_list_size]/F");
+  ColumnBranch("StartPointy",StartPointy,"StartPointy[geant_list_size]/F");
+  ColumnBranch("StartPointz",StartPointz,"StartPointz[geant_list_size]/F");
+  ColumnBranch("EndPointx",EndPointx,"EndPointx[geant_list_size]/F");
+  ColumnBranch("EndPointy",EndPointy,"EndPointy[geant_list_size]/F");
+  ColumnBranch("EndPointz",EndPointz,"EndPointz[geant_list_size]/F");
+  ColumnBranch("Startdcosx",Startdcosx,"Startdcosx[geant_list_size]/F");
+  ColumnBranch("Startdcosy",Startdcosy,"Startdcosy[geant_list_size]/F");
+  ColumnBranch("Startdcosz",Startdcosz,"Startdcosz[geant_list_size]/F");
+  ColumnBranch("N(((((((((umberDaughters",NumberDaughters,"NumberDaughters[geant_list_size]/I");
+  ColumnBranch("Mother",Mother,"Mother[geant_list_size]/I");
+  ColumnBranch("TrackId",TrackId,"TrackId[geant_list_size]/I");
+  ColumnBranch("process_primary",process_primary,"process_primary[geant_list_size]/I");
   fTree->Branch("G4Process",&G4Process);//,"G4Process[geant_list_size]");
   fTree->Branch("G4FinalProcess",&G4FinalProcess);//,"G4FinalProcess[geant_list_size]");
   fTree->Branch("ptype_flux",&ptype_flux,"ptype_flux/I");
@@ -4,6 +4,8 @@
 ////////////////////////////////////////////////////////////////////
 #ifndef MVAAlg_H
 #define MVAAlg_H
+#include <array>
+#include <functional>
 #include <vector>
 #include <map>
 #include <iostream>
@@ -57,14 +59,6 @@
 
 
 
-constexpr int kMaxTrack      = 1000;  //maximum number of tracks
-constexpr int kMaxShower     = 1000;  //maximum number of showers
-constexpr int kMaxHits       = 40000; //maximum number of hits;
-constexpr int kMaxVertices   = 1000;  //max number of 3D vertices
-constexpr int kMaxPrimaries  = 20000; //maximum number of primary particles
-constexpr int kMaxFlash      = 1000;  //maximum number of flashes
-//constexpr int kMaxTrackHits  = 1000;  //maximum number of track trajectory points
-
 namespace dunemva{
 
 
@@ -152,11 +146,27 @@ namespace dunemva{
       void ResetVars();
       bool insideFidVol(const double posX, const double posY, const double posZ);
 
+      // Size the per-object columns to the event, filling them with the default values
+      void ResizeTracks(int n);
+      void ResizeShowers(int n);
+      void ResizeHits(int n);
+      void ResizeVertices(int n);
+      void ResizeFlashes(int n);
+      void ResizeGeantParticles(int n);
+
+      // Book a variable length branch reading from a column, and point all of them
+      // at the current column storage before filling the tree
+      template <class T> void ColumnBranch(const char* name, std::vector<T>& column, const char* leaflist);
+      void SetColumnAddresses();
+      std::vector<std::function<void()>> fColumnAddressSetters;
+
       // Declare member data here.
       TTree *fTree;
       TTree* fPOT;
 
       // TTree variables
+      // Per-object quantities are stored as columns sized to the current event.
+      // They are cleared rather than freed between events so capacity is reused.
 
       // Run information
       int run;
@@ -169,53 +179,53 @@ namespace dunemva{
 
       // Track information
       int ntracks_reco;                   //number of reconstructed tracks
-      int   trkid[kMaxTrack];             //track id from recob::Track::ID(), this does not have to be the index of track
-      float trkstartx[kMaxTrack];         //track start position (cm)
-      float trkstarty[kMaxTrack];
-      float trkstartz[kMaxTrack];
-      float trkendx[kMaxTrack];           //track end position (cm)
-      float trkendy[kMaxTrack];
-      float trkendz[kMaxTrack];
-      float trkstartdcosx[kMaxTrack];     //track start direction cosine
-      float trkstartdcosy[kMaxTrack];
-      float trkstartdcosz[kMaxTrack];
-      float trkenddcosx[kMaxTrack];       //track end direction cosine
-      float trkenddcosy[kMaxTrack];
-      float trkenddcosz[kMaxTrack];
-      float trklen[kMaxTrack];            //track length (cm)
-      float trkke[kMaxTrack][3];          //track kinetic energy (in 3 planes)
-      float trkpida[kMaxTrack][3];        //track PIDA (in 3 planes)
-      int   trkbestplane[kMaxTrack];      //best plane for trkke and trkpida
+      std::vector<int> trkid;             //track id from recob::Track::ID(), this does not have to be the index of track
+      std::vector<float> trkstartx;         //track start position (cm)
+      std::vector<float> trkstarty;
+      std::vector<float> trkstartz;
+      std::vector<float> trkendx;           //track end position (cm)
+      std::vector<float> trkendy;
+      std::vector<float> trkendz;
+      std::vector<float> trkstartdcosx;     //track start direction cosine
+      std::vector<float> trkstartdcosy;
+      std::vector<float> trkstartdcosz;
+      std::vector<float> trkenddcosx;       //track end direction cosine
+      std::vector<float> trkenddcosy;
+      std::vector<float> trkenddcosz;
+      std::vector<float> trklen;            //track length (cm)
+      std::vector<std::array<float,3>> trkke;          //track kinetic energy (in 3 planes)
+      std::vector<std::array<float,3>> trkpida;        //track PIDA (in 3 planes)
+      std::vector<int> trkbestplane;      //best plane for trkke and trkpida
 
       //geant information for the track
-      int   trkg4id[kMaxTrack];           //geant track id for the track
-      int   trkg4pdg[kMaxTrack];          //pdg of geant particle
-      float trkg4startx[kMaxTrack];       //start position of geant particle
-      float trkg4starty[kMaxTrack];
-      float trkg4startz[kMaxTrack];
-      float trkg4initdedx[kMaxTrack];     //initial dE/dx of the track using true energy (MeV/cm)
+      std::vector<int> trkg4id;           //geant track id for the track
+      std::vector<int> trkg4pdg;          //pdg of geant particle
+      std::vector<float> trkg4startx;       //start position of geant particle
+      std::vector<float> trkg4starty;
+      std::vector<float> trkg4startz;
+      std::vector<float> trkg4initdedx;     //initial dE/dx of the track using true energy (MeV/cm)
 
       int nhits;
       int nhits_stored;
-      Short_t  hit_plane[kMaxHits];      //plane number
-      Short_t  hit_wire[kMaxHits];       //wire number
-      Int_t    hit_channel[kMaxHits];    //channel ID
-      Short_t  hit_tpc[kMaxHits];        //tpc
-      Float_t  hit_peakT[kMaxHits];      //peak time
-      Float_t  hit_charge[kMaxHits];     //charge (area)
-      Float_t  hit_summedADC[kMaxHits];  //summed ADC
-      Float_t  hit_startT[kMaxHits];     //hit start time
-      Float_t  hit_endT[kMaxHits];       //hit end time
-      Int_t    hit_trkkey[kMaxHits];     //track index if hit is associated with a track
-      Float_t  hit_dQds[kMaxHits];       //hit dQ/ds
-      Float_t  hit_dEds[kMaxHits];       //hit dE/ds
-      Float_t  hit_resrange[kMaxHits];   //hit residual range
-      Int_t    hit_shwkey[kMaxHits];     //shower index if hit is associated with a shower
+      std::vector<Short_t> hit_plane;      //plane number
+      std::vector<Short_t> hit_wire;       //wire number
+      std::vector<Int_t> hit_channel;    //channel ID
+      std::vector<Short_t> hit_tpc;        //tpc
+      std::vector<Float_t> hit_peakT;      //peak time
+      std::vector<Float_t> hit_charge;     //charge (area)
+      std::vector<Float_t> hit_summedADC;  //summed ADC
+      std::vector<Float_t> hit_startT;     //hit start time
+      std::vector<Float_t> hit_endT;       //hit end time
+      std::vector<Int_t> hit_trkkey;     //track index if hit is associated with a track
+      std::vector<Float_t> hit_dQds;       //hit dQ/ds
+      std::vector<Float_t> hit_dEds;       //hit dE/ds
+      std::vector<Float_t> hit_resrange;   //hit residual range
+      std::vector<Int_t> hit_shwkey;     //shower index if hit is associated with a shower
 
       // vertex information
       int infidvol;
       Short_t  nvtx;                     //number of vertices
-      Float_t  vtx[kMaxVertices][3];     //vtx[3] 
+      std::vector<std::array<Float_t,3>> vtx;     //vtx[3] 
 
       Float_t	vtxrecomc;		// distance between mc and reco vtx
       Float_t	vtxrecomcx;		
@@ -224,28 +234,28 @@ namespace dunemva{
 
       // shower information
       int nshws;                         //number of showers
-      int shwid[kMaxShower];             //recob::Shower::ID()
-      Float_t shwdcosx[kMaxShower];      //shower direction cosine
-      Float_t shwdcosy[kMaxShower];
-      Float_t shwdcosz[kMaxShower];
-      Float_t shwstartx[kMaxShower];     //shower start position (cm)
-      Float_t shwstarty[kMaxShower];
-      Float_t shwstartz[kMaxShower];
-      Float_t shwenergy[kMaxShower][3];  //shower energy measured on the 3 planes (GeV)
-      Float_t shwdedx[kMaxShower][3];    //shower dE/dx of the initial track measured on the 3 plane (MeV/cm)
-      int shwbestplane[kMaxShower];      //recommended plane for energy and dE/dx information
-      int   shwg4id[kMaxTrack];          //geant track id for the shower
+      std::vector<int> shwid;             //recob::Shower::ID()
+      std::vector<Float_t> shwdcosx;      //shower direction cosine
+      std::vector<Float_t> shwdcosy;
+      std::vector<Float_t> shwdcosz;
+      std::vector<Float_t> shwstartx;     //shower start position (cm)
+      std::vector<Float_t> shwstarty;
+      std::vector<Float_t> shwstartz;
+      std::vector<std::array<Float_t,3>> shwenergy;  //shower energy measured on the 3 planes (GeV)
+      std::vector<std::array<Float_t,3>> shwdedx;    //shower dE/dx of the initial track measured on the 3 plane (MeV/cm)
+      std::vector<int> shwbestplane;      //recommended plane for energy and dE/dx information
+      std::vector<int> shwg4id;          //geant track id for the shower
 
       // flash information
       int    flash_total;                //total number of flashes
-      Float_t flash_time[kMaxFlash];     //flash time
-      Float_t flash_width[kMaxFlash];    //flash width
-      Float_t flash_abstime[kMaxFlash];  //flash absolute time
-      Float_t flash_YCenter[kMaxFlash];  //flash y center (cm)
-      Float_t flash_YWidth[kMaxFlash];   //flash y width (cm)
-      Float_t flash_ZCenter[kMaxFlash];  //flash z center (cm)
-      Float_t flash_ZWidth[kMaxFlash];   //flash z width (cm)
-      Float_t flash_TotalPE[kMaxFlash];  //flash total pe
+      std::vector<Float_t> flash_time;     //flash time
+      std::vector<Float_t> flash_width;    //flash width
+      std::vector<Float_t> flash_abstime;  //flash absolute time
+      std::vector<Float_t> flash_YCenter;  //flash y center (cm)
+      std::vector<Float_t> flash_YWidth;   //flash y width (cm)
+      std::vector<Float_t> flash_ZCenter;  //flash z center (cm)
+      std::vector<Float_t> flash_ZWidth;   //flash z width (cm)
+      std::vector<Float_t> flash_TotalPE;  //flash total pe
 
       //mctruth information
       Int_t     mcevts_truth;    //number of neutrino Int_teractions in the spill
@@ -274,24 +284,24 @@ namespace dunemva{
       // === Storing Geant4 MC Truth Information ===
       int no_primaries;				//<---Number of primary Geant4 particles in the event
       int geant_list_size;				//<---Number of Geant4 particles tracked
-      int pdg[kMaxPrimaries];			//<---PDG Code number of this particle
-      Float_t Eng[kMaxPrimaries];			//<---Energy of the particle
-      Float_t Px[kMaxPrimaries];			//<---Px momentum of the particle
-      Float_t Py[kMaxPrimaries];			//<---Py momentum of the particle
-      Float_t Pz[kMaxPrimaries];			//<---Pz momentum of the particle
-      Float_t StartPointx[kMaxPrimaries];		//<---X position that this Geant4 particle started at
-      Float_t StartPointy[kMaxPrimaries];		//<---Y position that this Geant4 particle started at
-      Float_t StartPointz[kMaxPrimaries];		//<---Z position that this Geant4 particle started at
-      Float_t EndPointx[kMaxPrimaries];		//<---X position that this Geant4 particle ended at
-      Float_t EndPointy[kMaxPrimaries];		//<---Y position that this Geant4 particle ended at
-      Float_t EndPointz[kMaxPrimaries];		//<---Z position that this Geant4 particle ended at
-      Float_t Startdcosx[kMaxPrimaries];            //<---X direction cosine that Geant4 particle started at
-      Float_t Startdcosy[kMaxPrimaries];            //<---Y direction cosine that Geant4 particle started at
-      Float_t Startdcosz[kMaxPrimaries];            //<---Z direction cosine that Geant4 particle started at
-      int NumberDaughters[kMaxPrimaries];		//<---Number of Daughters this particle has
-      int TrackId[kMaxPrimaries];			//<---Geant4 TrackID number
-      int Mother[kMaxPrimaries];			//<---TrackID of the mother of this particle
-      int process_primary[kMaxPrimaries];		//<---Is this particle primary (primary = 1, non-primary = 1)
+      std::vector<int> pdg;			//<---PDG Code number of this particle
+      std::vector<Float_t> Eng;			//<---Energy of the particle
+      std::vector<Float_t> Px;			//<---Px momentum of the particle
+      std::vector<Float_t> Py;			//<---Py momentum of the particle
+      std::vector<Float_t> Pz;			//<---Pz momentum of the particle
+      std::vector<Float_t> StartPointx;		//<---X position that this Geant4 particle started at
+      std::vector<Float_t> StartPointy;		//<---Y position that this Geant4 particle started at
+      std::vector<Float_t> StartPointz;		//<---Z position that this Geant4 particle started at
+      std::vector<Float_t> EndPointx;		//<---X position that this Geant4 particle ended at
+      std::vector<Float_t> EndPointy;		//<---Y position that this Geant4 particle ended at
+      std::vector<Float_t> EndPointz;		//<---Z position that this Geant4 particle ended at
+      std::vector<Float_t> Startdcosx;            //<---X direction cosine that Geant4 particle started at
+      std::vector<Float_t> Startdcosy;            //<---Y direction cosine that Geant4 particle started at
+      std::vector<Float_t> Startdcosz;            //<---Z direction cosine that Geant4 particle started at
+      std::vector<int> NumberDaughters;		//<---Number of Daughters this particle has
+      std::vector<int> TrackId;			//<---Geant4 TrackID number
+      std::vector<int> Mother;			//<---TrackID of the mother of this particle
+      std::vector<int> process_primary;		//<---Is this particle primary (primary = 1, non-primary = 1)
       std::vector<std::string> G4Process;         //<---The process which created this particle
       std::vector<std::string> G4FinalProcess;    //<---The last process which this particle went under
 
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////
+//
+// MVAAlgResetBenchmark
+//
+// Per event reset cost of the MVAAlg tree record. MVAAlg needs the art
+// services to be constructed, so its per-object columns are mirrored
+// here with the same types and defaults:
+//   legacy  - the fixed kMax arrays, all reset by ResetVars every event
+//   columns - the vectors cleared by ResetVars and sized by the
+//             Resize* methods to the objects of the event
+//
+// Usage: MVAAlgResetBenchmark [events]
+//
+////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace {
+
+  constexpr int kMaxTrack      = 1000;
+  constexpr int kMaxShower     = 1000;
+  constexpr int kMaxHits       = 40000;
+  constexpr int kMaxVertices   = 1000;
+  constexpr int kMaxPrimaries  = 20000;
+  constexpr int kMaxFlash      = 1000;
+
+  // Number of columns of each type, as declared in MVAAlg.h
+  struct Legacy {
+    int     trk_int[4][kMaxTrack];
+    float   trk_float[17][kMaxTrack];
+    float   trk_plane[2][kMaxTrack][3];
+    int     shw_int[3][kMaxShower];
+    float   shw_float[6][kMaxShower];
+    float   shw_plane[2][kMaxShower][3];
+    float   flash[8][kMaxFlash];
+    short   hit_short[3][kMaxHits];
+    int     hit_int[3][kMaxHits];
+    float   hit_float[8][kMaxHits];
+    float   vtx[kMaxVertices][3];
+    int     g4_int[5][kMaxPrimaries];
+    float   g4_float[13][kMaxPrimaries];
+
+    void Reset(){
+      for (int i = 0; i < kMaxTrack; ++i){
+        for (auto & c : trk_int) c[i] = -9999;
+        for (auto & c : trk_float) c[i] = -9999;
+        for (auto & c : trk_plane) for (int j = 0; j < 3; ++j) c[i][j] = -9999;
+      }
+      for (int i = 0; i < kMaxShower; ++i){
+        for (auto & c : shw_int) c[i] = -9999;
+        for (auto & c : shw_float) c[i] = -9999;
+        for (auto & c : shw_plane) for (int j = 0; j < 3; ++j) c[i][j] = -9999;
+      }
+      for (int i = 0; i < kMaxFlash; ++i) for (auto & c : flash) c[i] = -9999;
+      for (int i = 0; i < kMaxHits; ++i){
+        for (auto & c : hit_short) c[i] = -9999;
+        for (auto & c : hit_int) c[i] = -9999;
+        for (auto & c : hit_float) c[i] = -9999;
+      }
+      for (int i = 0; i < kMaxVertices; ++i) for (int j = 0; j < 3; ++j) vtx[i][j] = -9999;
+      for (int i = 0; i < kMaxPrimaries; ++i){
+        for (auto & c : g4_int) c[i] = -99999;
+        for (auto & c : g4_float) c[i] = -99999;
+      }
+    }
+  };
+
+  struct Columns {
+    std::vector<int>                   trk_int[4];
+    std::vector<float>                 trk_float[17];
+    std::vector<std::array<float,3>>   trk_plane[2];
+    std::vector<int>                   shw_int[3];
+    std::vector<float>                 shw_float[6];
+    std::vector<std::array<float,3>>   shw_plane[2];
+    std::vector<float>                 flash[8];
+    std::vector<short>                 hit_short[3];
+    std::vector<int>                   hit_int[3];
+    std::vector<float>                 hit_float[8];
+    std::vector<std::array<float,3>>   vtx;
+    std::vector<int>                   g4_int[5];
+    std::vector<float>                 g4_float[13];
+
+    template <class T, size_t N, class V>
+    static void Assign(std::vector<T> (&columns)[N], int n, const V & value){
+      for (auto & c : columns) c.assign(n, value);
+    }
+
+    // ResetVars followed by the Resize* calls of PrepareEvent
+    void Reset(int ntrk, int nshw, int nflash, int nhit, int nvtx, int ng4){
+      const std::array<float,3> planes = {-9999, -9999, -9999};
+      Assign(trk_int, 0, -9999); Assign(trk_float, 0, -9999); Assign(trk_plane, 0, planes);
+      Assign(shw_int, 0, -9999); Assign(shw_float, 0, -9999); Assign(shw_plane, 0, planes);
+      Assign(flash, 0, -9999);
+      Assign(hit_short, 0, -9999); Assign(hit_int, 0, -9999); Assign(hit_float, 0, -9999);
+      vtx.assign(0, planes);
+      Assign(g4_int, 0, -99999); Assign(g4_float, 0, -99999);
+
+      Assign(trk_int, ntrk, -9999); Assign(trk_float, ntrk, -9999); Assign(trk_plane, ntrk, planes);
+      Assign(shw_int, nshw, -9999); Assign(shw_float, nshw, -9999); Assign(shw_plane, nshw, planes);
+      Assign(flash, nflash, -9999);
+      Assign(hit_short, nhit, -9999); Assign(hit_int, nhit, -9999); Assign(hit_float, nhit, -9999);
+      vtx.assign(nvtx, planes);
+      Assign(g4_int, ng4, -99999); Assign(g4_float, ng4, -99999);
+    }
+  };
+
+  volatile float gSink;
+
+  template <class F>
+  double MicrosecondsPerEvent(F reset, int nevents){
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nevents; ++i) reset();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count()/nevents;
+  }
+
+}
+
+int main(int argc, char* argv[]){
+
+  int nevents = argc > 1 ? std::atoi(argv[1]) : 2000;
+  if (nevents < 1){
+    std::cerr << "Usage: MVAAlgResetBenchmark [events]" << std::endl;
+    return 1;
+  }
+
+  auto legacy = std::make_unique<Legacy>();
+  Columns columns;
+
+  double tLegacy = MicrosecondsPerEvent([&](){ legacy->Reset(); gSink = legacy->hit_float[3][7]; }, nevents);
+  // A typical far detector event, then one at the old caps
+  double tTypical = MicrosecondsPerEvent([&](){ columns.Reset(20, 5, 10, 3000, 3, 500); gSink = columns.hit_float[3][7]; }, nevents);
+  double tFull = MicrosecondsPerEvent([&](){
+      columns.Reset(kMaxTrack, kMaxShower, kMaxFlash, kMaxHits, kMaxVertices, kMaxPrimaries);
+      gSink = columns.hit_float[3][7]; }, nevents);
+
+  std::cout << "Fixed kMax arrays                                          : " << tLegacy  << " us per event" << std::endl;
+  std::cout << "Columns, 20 tracks, 5 showers, 3000 hits, 500 particles    : " << tTypical << " us per event" << std::endl;
+  std::cout << "Columns, at the old kMax sizes                             : " << tFull    << " us per event" << std::endl;
+
+  return 0;
+}
@@ -156,6 +156,10 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
     const std::vector<art::Ptr<recob::Wire> > wires(dune_ana::DUNEAnaEventUtils::GetWires(event, fWireLabel));
     double wireCharge(0);
 
+    // The lifetime correction only depends on the tick, so work it out once per tick rather than once per sample
+    std::vector<double> lifetimeCorrections(dune_ana::DUNEAnaHitUtils::LifetimeCorrections(clockData, detProp, 
+        detProp.NumberTimeSamples(), triggerTme));
+
     for (unsigned int iWire = 0; iWire < wires.size(); ++iWire)
     {
         if (fGeometry->SignalType(wires[iWire]->Channel()) != geo::kCollection)
@@ -165,9 +169,12 @@ dune::EnergyRecoOutput NeutrinoEnergyRecoAlg::CalculateNeutrinoEnergy(const art:
         for (const lar::sparse_vector<float>::datarange_t& range : signalROI.get_ranges())
         {
             const std::vector<float>& signal(range.data());
-            const raw::TDCtick_t binFirstTickROI(range.begin_index());
+            if (range.end_index() > lifetimeCorrections.size())
+                lifetimeCorrections = dune_ana::DUNEAnaHitUtils::LifetimeCorrections(clockData, detProp, range.end_index(), triggerTme);
+
+            const double *const corrections(lifetimeCorrections.data() + range.begin_index());
             for (unsigned int iSignal = 0; iSignal < signal.size(); ++iSignal)
-                wireCharge += signal[iSignal]*dune_ana::DUNEAnaHitUtils::LifetimeCorrection(clockData, detProp, iSignal+binFirstTickROI, triggerTme);
+                wireCharge += signal[iSignal]*corrections[iSignal];
         }
     }
     const double totalEnergy(this->CalculateEnergyFromCharge(wireCharge));
@@ -270,10 +277,11 @@ double NeutrinoEnergyRecoAlg::CalculateEnergyFromCharge(const double charge)
 
 bool NeutrinoEnergyRecoAlg::IsContained(const std::vector<art::Ptr<recob::Hit> > &hits, const art::Event &event)
 {
+    const std::vector<std::vector<art::Ptr<recob::SpacePoint> > > hitSpacePoints(dune_ana::DUNEAnaHitUtils::GetSpacePoints(hits, 
+        event, fHitToSpacePointLabel));
     for (unsigned int iHit = 0; iHit < hits.size(); ++iHit)
     {
-        const std::vector<art::Ptr<recob::SpacePoint> > spacePoints(dune_ana::DUNEAnaHitUtils::GetSpacePoints(hits[iHit], 
-            event, fHitLabel, fHitToSpacePointLabel));
+        const std::vector<art::Ptr<recob::SpacePoint> > &spacePoints(hitSpacePoints[iHit]);
         for (unsigned int iSpacePoint = 0; iSpacePoint < spacePoints.size(); ++iSpacePoint)
         {
             const art::Ptr<recob::SpacePoint> spacePoint(spacePoints[iSpacePoint]);
@@ -121,6 +121,52 @@ namespace dune::apa {
   }
 
 
+  //----------------------------------------------------------
+  void APAGeometryAlg::BuildChannelTable()
+  {
+
+    if( fChannelWires.size() == fGeom->Nchannels() ) return;
+
+    // intersections remembered for a previous table no longer apply
+    fIntersectionCache.clear();
+
+    fChannelWires.resize(fGeom->Nchannels());
+    fChannelAPA.resize(fGeom->Nchannels());
+    for (uint32_t chan = 0; chan < fGeom->Nchannels(); ++chan)
+      {
+	fChannelWires[chan] = fGeom->ChannelToWire(chan);
+	fChannelAPA[chan]   = this->ChannelToAPA(chan);
+      }
+
+  }
+
+
+  //----------------------------------------------------------
+  bool APAGeometryAlg::CachedWireIDsIntersect( const geo::WireID & wid1,
+					       const geo::WireID & wid2,
+					       geo::WireIDIntersection & widIntersect )
+  {
+
+    // plenty of bits for the ProtoDUNE and FD numbering
+    auto key = [](const geo::WireID & wid){
+      return ((uint64_t)wid.Cryostat << 56) | ((uint64_t)wid.TPC << 40)
+	| ((uint64_t)wid.Plane << 32) | (uint64_t)wid.Wire;
+    };
+    std::pair<uint64_t, uint64_t> k(key(wid1), key(wid2));
+
+    auto it = fIntersectionCache.find(k);
+    if( it == fIntersectionCache.end() ){
+      CachedIntersection c;
+      c.intersects = fGeom->WireIDsIntersect( wid1, wid2, c.intersection );
+      it = fIntersectionCache.insert(std::make_pair(k, c)).first;
+    }
+
+    widIntersect = it->second.intersection;
+    return it->second.intersects;
+
+  }
+
+
   //----------------------------------------------------------
   void APAGeometryAlg::ChannelToAPA( uint32_t chan, 
 				     unsigned int & apa, 
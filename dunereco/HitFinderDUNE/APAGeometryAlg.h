@@ -8,6 +8,10 @@
 #include <cmath>
 #include <iostream>
 #include <stdint.h>
+#include <functional>
+#include <utility>
+
+#include "tbb/concurrent_unordered_map.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "fhiclcpp/ParameterSet.h"
@@ -87,6 +91,20 @@ namespace dune::apa {
     unsigned int         ChannelsInAPAView( APAView_t apaview );
     unsigned int         ChannelsPerAPA(){ return fChannelsPerAPA; };
 
+    void                 BuildChannelTable();          ///< Fill the channel to APA and wire segments table, if not done already,
+                                                       ///< and clear the intersection cache when it is (re)built
+    const std::vector<geo::WireID>& ChannelWires(uint32_t chan) const { return fChannelWires[chan]; };
+                                                       ///< ChannelToWire from the table, BuildChannelTable must have been called
+    unsigned int         TableChannelToAPA(uint32_t chan) const { return fChannelAPA[chan]; };
+                                                       ///< APA of the channel from the table, BuildChannelTable must have been called
+
+    bool                 CachedWireIDsIntersect( const geo::WireID & wid1,
+                                                 const geo::WireID & wid2,
+                                                 geo::WireIDIntersection & widIntersect );
+                                                       ///< Geometry WireIDsIntersect remembering the results, safe to call concurrently
+    void                 ClearIntersectionCache(){ fIntersectionCache.clear(); };
+                                                       ///< Not safe to call concurrently with CachedWireIDsIntersect
+
 
   private:
 
@@ -107,6 +125,20 @@ namespace dune::apa {
 
     double fChannelRange[2]; // for each induction view: U=0, V=1
 
+    // channel table, filled by BuildChannelTable
+    std::vector< std::vector<geo::WireID> > fChannelWires;
+    std::vector< unsigned int >             fChannelAPA;
+
+    struct WireIDPairHash {
+      size_t operator()(const std::pair<uint64_t, uint64_t>& p) const
+      { return std::hash<uint64_t>()(p.first ^ (p.second * 0x9E3779B97F4A7C15ULL)); }
+    };
+    struct CachedIntersection {
+      bool                    intersects;
+      geo::WireIDIntersection intersection;
+    };
+    tbb::concurrent_unordered_map< std::pair<uint64_t, uint64_t>, CachedIntersection, WireIDPairHash > fIntersectionCache;
+
   }; // class APAGeometryAlg
 
 } // namespace apa
@@ -35,6 +35,10 @@
 #include "DisambigAlgProtoDUNESP.h"
 #include "larevt/Filters/ChannelFilter.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+#include <algorithm>
 #include <map>
 #include <cmath>
 #include <vector>
@@ -61,6 +65,21 @@ namespace dune{
   }
 
 
+  namespace {
+
+    // Indices of the hits within cut of time t, given the (time, index) pairs
+    // sorted in time. Same selection as testing every hit with |t-time|<cut.
+    void TimeMatches(const std::vector< std::pair<double, size_t> > &sorted,
+                     double t, double cut, std::vector<size_t> &matches)
+    {
+      auto it = std::partition_point(sorted.begin(), sorted.end(),
+                                     [t, cut](const std::pair<double, size_t> &p)
+                                     { return p.first < t && !(std::abs(t-p.first)<cut); });
+      for (; it != sorted.end() && std::abs(t-it->first)<cut; ++it) matches.push_back(it->second);
+    }
+
+  }
+
   //----------------------------------------------------------
   //----------------------------------------------------------
   void DisambigAlgProtoDUNESP::RunDisambig(detinfo::DetectorPropertiesData const& detProp,
@@ -72,244 +91,231 @@ namespace dune{
 
     size_t napas = geo->NTPC()/2;
 
-    // do only one APA at a time.
+    // channel to APA and wires lookups, built on the first event; the wire
+    // intersections cached by fAPAGeo are kept for the whole job
+    fAPAGeo.BuildChannelTable();
 
-    for (size_t apa=0; apa<napas; apa++)
+    // copy hit ptrs to local storage, sorted by APA and view in one pass
+
+    std::vector<APAHits> apaHits(napas);
+
+    for (size_t i = 0; i<OrigHits.size(); ++i)
       {
+	unsigned int hitapa = fAPAGeo.TableChannelToAPA(OrigHits[i]->Channel());
+	if (hitapa >= napas) continue;
 
-	int tpc = longTPC(apa); // for purposes of evaluating time offsets for time matching.
-	//tick offsets differ for the even and odd TPC's
-        int cryostat = 0; // protoDUNE-SP has only one cryostat
+	switch (OrigHits[i]->View())
+	  {
+	  case geo::kU:
+	    apaHits[hitapa].hitsUV[0].push_back(OrigHits[i]);
+	    break;
+	  case geo::kV:
+	    apaHits[hitapa].hitsUV[1].push_back(OrigHits[i]);
+	    break;
+	  case geo::kZ:
+	    apaHits[hitapa].hitsZ.push_back(OrigHits[i]);
+	    break;
+	  default:
+	    throw cet::exception("DisambigAlgProtoDUNESP") <<": hit view unkonwn. \n";
+	  }
+      }
+
+    // the APAs are independent, do them in parallel and collect the
+    // results in APA order
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, napas, 1),
+                      [&](const tbb::blocked_range<size_t> &range)
+                      {
+                        for (size_t apa = range.begin(); apa != range.end(); ++apa)
+                          DisambigAPA(detProp, apa, apaHits[apa]);
+                      });
+
+    for (size_t apa=0; apa<napas; apa++)
+      {
+	fDisambigHits.insert(fDisambigHits.end(),
+			     apaHits[apa].disambigHits.begin(),
+			     apaHits[apa].disambigHits.end());
+      }
+  }
 
-	//  TH1D *histu = new TH1D("histu","histu",4000,0,4000);
-	//  TH1D *histv = new TH1D("histv","histv",4000,0,4000);
-	//  TH1D *histz = new TH1D("histz","histz",4000,0,4000);
+  //----------------------------------------------------------
+  void DisambigAlgProtoDUNESP::DisambigAPA(detinfo::DetectorPropertiesData const& detProp,
+                                           size_t apa, APAHits &hits)
+  {
+    const std::vector<art::Ptr<recob::Hit> > (&hitsUV)[2] = hits.hitsUV;  // index 0=U, 1=V
+    const std::vector<art::Ptr<recob::Hit> > &hitsZ = hits.hitsZ;
+    std::vector< std::pair<art::Ptr<recob::Hit>, geo::WireID> > &disambigHits = hits.disambigHits;
 
-	// copy hit ptrs to local storage
+    int tpc = longTPC(apa); // for purposes of evaluating time offsets for time matching.
+    //tick offsets differ for the even and odd TPC's
+    int cryostat = 0; // protoDUNE-SP has only one cryostat
 
-	std::vector<art::Ptr<recob::Hit> > hitsUV[2];  // index 0=U, 1=V
-	std::vector<art::Ptr<recob::Hit> > hitsZ;
+    // hit times with the offsets applied, and sorted to find the time matches
 
-	//std::cout << "Dumping hits for this APA" << std::endl;
+    std::vector<double> timesUV[2];
+    std::vector< std::pair<double, size_t> > sortedUV[2];
+    std::vector< std::pair<double, size_t> > sortedZ;
 
-	for (size_t i = 0; i<OrigHits.size(); ++i)
+    for (size_t uv=0; uv<2; uv++)
+      {
+	for (size_t i=0; i<hitsUV[uv].size(); i++)
 	  {
-	    unsigned int hitapa(0), hitcryo(0);
-	    fAPAGeo.ChannelToAPA(OrigHits[i]->Channel(), hitapa, hitcryo);
-	    if (apa == hitapa)
-	      {
-		//std::cout << *OrigHits[i] << std::endl;
-
-		switch (OrigHits[i]->View())
-		  {
-		  case geo::kU:
-		    hitsUV[0].push_back(OrigHits[i]);
-		    //      if (OrigHits[i]->WireID().TPC==1) 
-		    //	histu->Fill(OrigHits[i]->PeakTime()
-		    //		    - detProp.GetXTicksOffset(0,
-		    //					       tpc,
-		    //					       cryostat)
-		    //		    ,OrigHits[i]->Charge());
-
-		    break;
-		  case geo::kV:
-		    hitsUV[1].push_back(OrigHits[i]);
-		    //      if (OrigHits[i]->WireID().TPC==1) 
-		    //	histv->Fill(OrigHits[i]->PeakTime()
-		    //		    - detProp.GetXTicksOffset(1,
-		    //					       tpc,
-		    //					       cryostat)
-		    //		    ,OrigHits[i]->Charge());
-		    break;
-		  case geo::kZ:
-		    hitsZ.push_back(OrigHits[i]);
-		    //      if (OrigHits[i]->WireID().TPC==1) 
-		    //	histz->Fill(OrigHits[i]->PeakTime()
-		    //		    - detProp.GetXTicksOffset(2,
-		    //					       tpc,
-		    //					       cryostat)
-		    //		    ,OrigHits[i]->Charge());
-		    break;
-		  default:
-		    throw cet::exception("DisambigAlgProtoDUNESP") <<": hit view unkonwn. \n";
-		  }
-	      }
+	    timesUV[uv].push_back(hitsUV[uv][i]->PeakTime()
+				  - detProp.GetXTicksOffset(hitsUV[uv][i]->WireID().Plane,tpc,cryostat));
+	    sortedUV[uv].emplace_back(timesUV[uv].back(), i);
 	  }
+	std::sort(sortedUV[uv].begin(), sortedUV[uv].end());
+      }
+    for (size_t z=0; z<hitsZ.size(); z++)
+      {
+	sortedZ.emplace_back(hitsZ[z]->PeakTime()
+			     - detProp.GetXTicksOffset(hitsZ[z]->WireID().Plane,tpc,cryostat), z);
+      }
+    std::sort(sortedZ.begin(), sortedZ.end());
 
-	//  std::cout << " DisambigAlgProtoDUNESP timing means: " <<histu->GetMean()<<" "<<histv->GetMean()<<" "<<histz->GetMean()<<std::endl;
-	//  delete histu;
-	//  delete histv;
-	//  delete histz;
-
-	size_t zsize = hitsZ.size();
+    // loop over U and V planes to disambiguate.
+    // Identify hits matching in time in the Z and the other induction planes
 
-	// loop over U and V planes to disambiguate.
-	// Identify hits matching in time in the Z and the other induction planes
+    for (size_t uv=0; uv<2; uv++)  // uv is the current induction plane
+      {
+	size_t other=1-uv;  // the index of the other induction plane
+	size_t uvsize = hitsUV[uv].size();    // this induction plane's hits
 
-	for (size_t uv=0; uv<2; uv++)  // uv is the current induction plane
+	for (size_t iuv = 0; iuv < uvsize; ++iuv)
 	  {
-	    size_t other=1-uv;  // the index of the other induction plane
-	    size_t uvsize = hitsUV[uv].size();    // this induction plane's hits
-	    size_t othersize = hitsUV[other].size();  // the other induction plane's hits
+	    //std::cout << "Attempting to Disambiguate hit: " << *hitsUV[uv][iuv] << std::endl;
+	    //std::cout << "Getting time offset: " << hitsUV[uv][iuv]->WireID().Plane << " " << tpc << " " << cryostat << std::endl;
+	    //std::cout << "time offset: " << detProp.GetXTicksOffset(hitsUV[uv][iuv]->WireID().Plane,tpc,cryostat) << std::endl;
 
-	    for (size_t iuv = 0; iuv < uvsize; ++iuv)
-	      {
-		//std::cout << "Attempting to Disambiguate hit: " << *hitsUV[uv][iuv] << std::endl;
-		//std::cout << "Getting time offset: " << hitsUV[uv][iuv]->WireID().Plane << " " << tpc << " " << cryostat << std::endl;
-		//std::cout << "time offset: " << detProp.GetXTicksOffset(hitsUV[uv][iuv]->WireID().Plane,tpc,cryostat) << std::endl;
+	    double tuv = timesUV[uv][iuv];
 
-		double tuv = hitsUV[uv][iuv]->PeakTime()
-		  - detProp.GetXTicksOffset(hitsUV[uv][iuv]->WireID().Plane,tpc,cryostat);
+	    std::vector<size_t> zmatches;  // list of indices of time-matched hits
+	    std::vector<size_t> othermatches;
+	    TimeMatches(sortedZ, tuv, fTimeCut, zmatches);
+	    TimeMatches(sortedUV[other], tuv, fTimeCut, othermatches);
 
-		std::vector<size_t> zmatches;  // list of indices of time-matched hits
-		std::vector<size_t> othermatches;
-		for (size_t z = 0; z < zsize; z++)
-		  {
-		    double tz = hitsZ[z]->PeakTime()
-		      - detProp.GetXTicksOffset(hitsZ[z]->WireID().Plane,tpc,cryostat);
-		    //std::cout << "Looking for a Z match: " << tuv << " " << tz << " Offset: " <<
-                    // detProp.GetXTicksOffset(hitsZ[z]->WireID().Plane,tpc,cryostat)
-		    //      << " plane: " << hitsZ[z]->WireID().Plane << " TPC: " << tpc << " Cryo: " << cryostat
-		    //	      << std::endl;
-
-		    if (std::abs(tuv-tz)<fTimeCut)
-		      {
-			zmatches.push_back(z);
-		      }
-		  }
-		for (size_t iother = 0; iother < othersize; iother++)
-		  {
-		    double tother = hitsUV[other][iother]->PeakTime()
-		      - detProp.GetXTicksOffset(hitsUV[other][iother]->WireID().Plane,tpc,cryostat);
-		    if (std::abs(tuv-tother)<fTimeCut)
-		      {
-			othermatches.push_back(iother);
-		      }
-		  }
+	    //std::cout << "Number of time-matched Z hits: " << zmatches.size() << std::endl;
+	    //std::cout << "Number of time-matched Other-Ind View hits: " << othermatches.size() << std::endl;
 
-		//std::cout << "Number of time-matched Z hits: " << zmatches.size() << std::endl;
-		//std::cout << "Number of time-matched Other-Ind View hits: " << othermatches.size() << std::endl;
+	    if (zmatches.size() == 0 && othermatches.size() == 0) continue;   // hit has no matches -- possibly noise
 
-		if (zmatches.size() == 0 && othermatches.size() == 0) continue;   // hit has no matches -- possibly noise
+	    // find out how many of these matched-in-time hits are also matched in space.
+	    // take triplets over doublets.  Assume we are on the sensitive side of the APA.
 
-		// find out how many of these matched-in-time hits are also matched in space.
-		// take triplets over doublets.  Assume we are on the sensitive side of the APA.
-	  
-		std::vector< double > zmatchz;
-		std::vector< double > zmatchy;
-		std::vector< double > othermatchz;
-		std::vector< double > othermatchy;
+	    std::vector< double > zmatchz;
+	    std::vector< double > zmatchy;
+	    std::vector< double > othermatchz;
+	    std::vector< double > othermatchy;
 
-		std::vector<geo::WireID>  wires = geo->ChannelToWire(hitsUV[uv][iuv]->Channel());
-		size_t wsize = wires.size();
-		std::vector<size_t> ndoublets(wsize,0);
-		std::vector<size_t> ntriplets(wsize,0);
+	    const std::vector<geo::WireID>& wires = fAPAGeo.ChannelWires(hitsUV[uv][iuv]->Channel());
+	    size_t wsize = wires.size();
+	    std::vector<size_t> ndoublets(wsize,0);
+	    std::vector<size_t> ntriplets(wsize,0);
 
-		for (size_t w=0; w<wsize; w++)
+	    for (size_t w=0; w<wsize; w++)
+	      {
+		ndoublets[w] = 0;
+		ntriplets[w] = 0;
+		geo::WireID uvwire = wires[w];
+		if ( notOuterWire(uvwire) )
 		  {
-		    ndoublets[w] = 0;
-		    ntriplets[w] = 0;
-		    geo::WireID uvwire = wires[w];
-		    if ( notOuterWire(uvwire) )
+		    for (size_t z=0; z<zmatches.size(); z++)
 		      {
-			for (size_t z=0; z<zmatches.size(); z++)
+			geo::WireID zwire = fAPAGeo.ChannelWires(hitsZ[zmatches[z]]->Channel())[0];
+			if ( notOuterWire(zwire) )  // we really shouldn't have any hits on the outer z wires
 			  {
-			    geo::WireID zwire = geo->ChannelToWire(hitsZ[zmatches[z]]->Channel())[0];
-			    if ( notOuterWire(zwire) )  // we really shouldn't have any hits on the outer z wires
+			    geo::WireIDIntersection isect;
+			    if (fAPAGeo.CachedWireIDsIntersect(zwire,uvwire,isect))
 			      {
-			        geo::WireIDIntersection isect;
-			        if (geo->WireIDsIntersect(zwire,uvwire,isect))
-			          {
-				    zmatchz.push_back(isect.z);
-				    zmatchy.push_back(isect.y);
-			          }
+				zmatchz.push_back(isect.z);
+				zmatchy.push_back(isect.y);
 			      }
 			  }
-			// There is at most one intersection of the u channel with a v channel. Still have to loop over possibilities though.
-			for (size_t iother=0; iother<othermatches.size(); iother++)
+		      }
+		    // There is at most one intersection of the u channel with a v channel. Still have to loop over possibilities though.
+		    for (size_t iother=0; iother<othermatches.size(); iother++)
+		      {
+			const std::vector<geo::WireID>& otherwires = fAPAGeo.ChannelWires(hitsUV[other][othermatches[iother]]->Channel());
+			for (size_t otherw = 0; otherw < otherwires.size(); otherw++)
 			  {
-			    std::vector<geo::WireID>  otherwires = geo->ChannelToWire(hitsUV[other][othermatches[iother]]->Channel());
-			    for (size_t otherw = 0; otherw < otherwires.size(); otherw++)
+			    geo::WireID otherwire = otherwires[otherw];
+			    if (notOuterWire(otherwire))
 			      {
-				geo::WireID otherwire = otherwires[otherw];
-				if (notOuterWire(otherwire))
+				geo::WireIDIntersection isect;
+				if (fAPAGeo.CachedWireIDsIntersect(otherwire,uvwire,isect))
 				  {
-				    geo::WireIDIntersection isect;
-				    if (geo->WireIDsIntersect(otherwire,uvwire,isect))
-				      {
-					othermatchz.push_back(isect.z);
-					othermatchy.push_back(isect.y);
-				      }
+				    othermatchz.push_back(isect.z);
+				    othermatchy.push_back(isect.y);
 				  }
 			      }
 			  }
+		      }
 
-			// look for triplets among the matches, and then doublets
-			for (size_t izmatch=0;izmatch<zmatchz.size();izmatch++)
+		    // look for triplets among the matches, and then doublets
+		    for (size_t izmatch=0;izmatch<zmatchz.size();izmatch++)
+		      {
+			bool found_triplet = false;
+			for (size_t iothermatch=0;iothermatch<othermatchz.size();iothermatch++)
 			  {
-			    bool found_triplet = false;
-			    for (size_t iothermatch=0;iothermatch<othermatchz.size();iothermatch++)
+			    double disz = zmatchz[izmatch]-othermatchz[iothermatch]; 
+			    double disy = zmatchy[izmatch]-othermatchy[iothermatch]; 
+			    if ( disz*disz + disy*disy < fDcut2 )
 			      {
-				double disz = zmatchz[izmatch]-othermatchz[iothermatch]; 
-				double disy = zmatchy[izmatch]-othermatchy[iothermatch]; 
-				if ( disz*disz + disy*disy < fDcut2 )
-				  {
-				    ntriplets[w]++;
-				    found_triplet = true;
-				  }
+				ntriplets[w]++;
+				found_triplet = true;
 			      }
-			    if (!found_triplet) ndoublets[w] ++;
 			  }
-			for (size_t iothermatch=0;iothermatch<othermatchz.size();iothermatch++)
+			if (!found_triplet) ndoublets[w] ++;
+		      }
+		    for (size_t iothermatch=0;iothermatch<othermatchz.size();iothermatch++)
+		      {
+			bool found_triplet = false;
+			for (size_t izmatch=0;izmatch<zmatchz.size();izmatch++)
 			  {
-			    bool found_triplet = false;
-			    for (size_t izmatch=0;izmatch<zmatchz.size();izmatch++)
+			    double disz = zmatchz[izmatch]-othermatchz[iothermatch]; 
+			    double disy = zmatchy[izmatch]-othermatchy[iothermatch]; 
+			    if ( disz*disz + disy*disy < fDcut2 )
 			      {
-				double disz = zmatchz[izmatch]-othermatchz[iothermatch]; 
-				double disy = zmatchy[izmatch]-othermatchy[iothermatch]; 
-				if ( disz*disz + disy*disy < fDcut2 )
-				  {
-				    found_triplet = true;
-				  }
+				found_triplet = true;
 			      }
-			    if (!found_triplet) ndoublets[w] ++;
-			  }  // end summing up doublets and triplets
-		      }  // end check if not an outer wire
-		  } // end loop on wire candidates for U channels
-
-		bool found_disambig = false;
-		size_t bestwire = 0;
-		for (size_t w=0; w<wsize; w++)
+			  }
+			if (!found_triplet) ndoublets[w] ++;
+		      }  // end summing up doublets and triplets
+		  }  // end check if not an outer wire
+	      } // end loop on wire candidates for U channels
+
+	    bool found_disambig = false;
+	    size_t bestwire = 0;
+	    for (size_t w=0; w<wsize; w++)
+	      {
+		if (!found_disambig && (ntriplets[w]>0 || ndoublets[w] > 0))
 		  {
-		    if (!found_disambig && (ntriplets[w]>0 || ndoublets[w] > 0))
-		      {
-			bestwire = w;
-			found_disambig = true;
-		      }
-		    if (ntriplets[w] > ntriplets[bestwire]) 
-		      {
-			bestwire = w;
-			found_disambig = true;
-		      }
-		    if ( (ntriplets[w] == ntriplets[bestwire]) && (ndoublets[w] > ndoublets[bestwire])) 
-		      {
-			bestwire = w;
-			found_disambig = true;
-		      }
+		    bestwire = w;
+		    found_disambig = true;
 		  }
-		if (found_disambig)
+		if (ntriplets[w] > ntriplets[bestwire]) 
 		  {
-		    fDisambigHits.push_back(std::pair<art::Ptr<recob::Hit>, geo::WireID>(hitsUV[uv][iuv],wires[bestwire]));
+		    bestwire = w;
+		    found_disambig = true;
 		  }
-		else
+		if ( (ntriplets[w] == ntriplets[bestwire]) && (ndoublets[w] > ndoublets[bestwire])) 
 		  {
-		    //mf::LogWarning("DisambigAlg35t")<<"Could not find disambiguated hit for  "<<*hitsUV[uv][iuv]<<"\n";
-		    //std::cout <<"Could not find disambiguated hit for  "<<*hitsUV[uv][iuv]<<"\n";
+		    bestwire = w;
+		    found_disambig = true;
 		  }
+	      }
+	    if (found_disambig)
+	      {
+		disambigHits.push_back(std::pair<art::Ptr<recob::Hit>, geo::WireID>(hitsUV[uv][iuv],wires[bestwire]));
+	      }
+	    else
+	      {
+		//mf::LogWarning("DisambigAlg35t")<<"Could not find disambiguated hit for  "<<*hitsUV[uv][iuv]<<"\n";
+		//std::cout <<"Could not find disambiguated hit for  "<<*hitsUV[uv][iuv]<<"\n";
+	      }
 
-	      } // end loop over induction hits in this plane
-	  } // end loop over induction planes 
-      } // end loop over APA's
+	  } // end loop over induction hits in this plane
+      } // end loop over induction planes
   }
 
 // method to tell us whether a particular wire is in an outer TPC.  Hardcoded outer TPC numbers.
@@ -59,6 +59,17 @@ namespace dune{
 
     private:
 
+    /// Hits of one APA and the disambiguated ones found from them
+    struct APAHits
+    {
+      std::vector< art::Ptr<recob::Hit> > hitsUV[2];  ///< index 0=U, 1=V
+      std::vector< art::Ptr<recob::Hit> > hitsZ;
+      std::vector< std::pair<art::Ptr<recob::Hit>, geo::WireID> > disambigHits;
+    };
+
+    void DisambigAPA(detinfo::DetectorPropertiesData const& detProp,
+                     size_t apa, APAHits &hits);  ///< Disambiguate the U and V hits of one APA
+
     bool notOuterWire(geo::WireID wireid);
 
     int longTPC(int apa);
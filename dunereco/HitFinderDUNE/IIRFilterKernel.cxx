@@ -0,0 +1,175 @@
+/****************************************
+
+Multi-channel bidirectional IIR filter. The recurrence
+in time can't be vectorised, so channels are filtered
+side by side instead, one per SIMD lane.
+
+****************************************/
+
+#include "IIRFilterKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define IIRFILTERKERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  // Filter channels [c_begin, nchan) one sample at a time. The channel loop
+  // is innermost so the compiler can still vectorise it with the baseline
+  // instruction set.
+  void FilterScalar(float * wf, size_t nticks, size_t nchan, size_t c_begin, float a0, float b1)
+  {
+    if (nchan == 1 && c_begin == 0)
+      {
+        // A single waveform, as for RMSHitFinderAlg::FilterWaveform
+        for (size_t t = 1; t < nticks; ++t) wf[t] = a0*wf[t]+b1*wf[t-1];
+        for (size_t t = nticks-1; t-- > 0; ) wf[t] = a0*wf[t]+b1*wf[t+1];
+        return;
+      }
+    for (size_t t = 1; t < nticks; ++t)
+      {
+        float * row = wf + t*nchan;
+        const float * prev = row - nchan;
+        for (size_t c = c_begin; c < nchan; ++c) row[c] = a0*row[c]+b1*prev[c];
+      }
+    for (size_t t = nticks-1; t-- > 0; )
+      {
+        float * row = wf + t*nchan;
+        const float * next = row + nchan;
+        for (size_t c = c_begin; c < nchan; ++c) row[c] = a0*row[c]+b1*next[c];
+      }
+  }
+
+#ifdef IIRFILTERKERNEL_X86
+  // Both return the number of channels filtered, a multiple of the vector width
+
+  __attribute__((target("avx2")))
+  size_t FilterAVX2(float * wf, size_t nticks, size_t nchan, float a0, float b1)
+  {
+    const size_t nvec = nchan/8*8;
+    const __m256 va0 = _mm256_set1_ps(a0);
+    const __m256 vb1 = _mm256_set1_ps(b1);
+    for (size_t t = 1; t < nticks; ++t)
+      {
+        float * row = wf + t*nchan;
+        const float * prev = row - nchan;
+        for (size_t c = 0; c < nvec; c += 8)
+          {
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(va0,_mm256_loadu_ps(row+c)),
+                                     _mm256_mul_ps(vb1,_mm256_loadu_ps(prev+c)));
+            _mm256_storeu_ps(row+c,y);
+          }
+      }
+    for (size_t t = nticks-1; t-- > 0; )
+      {
+        float * row = wf + t*nchan;
+        const float * next = row + nchan;
+        for (size_t c = 0; c < nvec; c += 8)
+          {
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(va0,_mm256_loadu_ps(row+c)),
+                                     _mm256_mul_ps(vb1,_mm256_loadu_ps(next+c)));
+            _mm256_storeu_ps(row+c,y);
+          }
+      }
+    return nvec;
+  }
+
+  // a*x + b*y. AVX-512F comes with FMA, and the compiler is free to fuse
+  // plain vector multiplications and additions, so the explicitly rounded
+  // forms are used to keep the two roundings of the scalar code.
+  __attribute__((target("avx512f")))
+  inline __m512 AddMul512(__m512 a, __m512 x, __m512 b, __m512 y)
+  {
+    return _mm512_add_round_ps(_mm512_mul_round_ps(a,x,_MM_FROUND_CUR_DIRECTION),
+                               _mm512_mul_round_ps(b,y,_MM_FROUND_CUR_DIRECTION),
+                               _MM_FROUND_CUR_DIRECTION);
+  }
+
+  __attribute__((target("avx512f")))
+  size_t FilterAVX512(float * wf, size_t nticks, size_t nchan, float a0, float b1)
+  {
+    const size_t nvec = nchan/16*16;
+    const __m512 va0 = _mm512_set1_ps(a0);
+    const __m512 vb1 = _mm512_set1_ps(b1);
+    for (size_t t = 1; t < nticks; ++t)
+      {
+        float * row = wf + t*nchan;
+        const float * prev = row - nchan;
+        for (size_t c = 0; c < nvec; c += 16)
+          {
+            __m512 y = AddMul512(va0,_mm512_loadu_ps(row+c),vb1,_mm512_loadu_ps(prev+c));
+            _mm512_storeu_ps(row+c,y);
+          }
+      }
+    for (size_t t = nticks-1; t-- > 0; )
+      {
+        float * row = wf + t*nchan;
+        const float * next = row + nchan;
+        for (size_t c = 0; c < nvec; c += 16)
+          {
+            __m512 y = AddMul512(va0,_mm512_loadu_ps(row+c),vb1,_mm512_loadu_ps(next+c));
+            _mm512_storeu_ps(row+c,y);
+          }
+      }
+    return nvec;
+  }
+#endif
+
+}
+
+dune::SIMDLevel dune::BestSIMDLevel()
+{
+#ifdef IIRFILTERKERNEL_X86
+  static const SIMDLevel level = __builtin_cpu_supports("avx512f") ? SIMDLevel::kAVX512
+                               : __builtin_cpu_supports("avx2") ? SIMDLevel::kAVX2
+                               : SIMDLevel::kScalar;
+  return level;
+#else
+  return SIMDLevel::kScalar;
+#endif
+}
+
+void dune::IIRFilterCoefficients(float width, float & a0, float & b1)
+{
+  float filter_coef = static_cast<float>(std::exp(static_cast<double>(-1.0/width)));
+  a0 = 1.0-filter_coef;
+  b1 = filter_coef;
+}
+
+void dune::BidirectionalIIRFilter(float * wf, size_t nticks, size_t nchan, float a0, float b1, SIMDLevel level)
+{
+  if (nticks < 2 || nchan == 0) return;
+  size_t done = 0;
+#ifdef IIRFILTERKERNEL_X86
+  // Never go beyond what the CPU supports, whatever was asked for
+  if (level == SIMDLevel::kAVX512 && BestSIMDLevel() != SIMDLevel::kAVX512) level = SIMDLevel::kAVX2;
+  if (level == SIMDLevel::kAVX2 && BestSIMDLevel() == SIMDLevel::kScalar) level = SIMDLevel::kScalar;
+  if (level == SIMDLevel::kAVX512) done = FilterAVX512(wf,nticks,nchan,a0,b1);
+  else if (level == SIMDLevel::kAVX2) done = FilterAVX2(wf,nticks,nchan,a0,b1);
+#endif
+  if (done < nchan) FilterScalar(wf,nticks,nchan,done,a0,b1);
+}
+
+void dune::InterleaveChannels(const std::vector<const float*> & wfs, size_t nticks, float * out)
+{
+  const size_t nchan = wfs.size();
+  for (size_t c = 0; c < nchan; ++c)
+    {
+      const float * wf = wfs[c];
+      for (size_t t = 0; t < nticks; ++t) out[t*nchan+c] = wf[t];
+    }
+}
+
+void dune::DeinterleaveChannels(const float * in, size_t nticks, const std::vector<float*> & wfs)
+{
+  const size_t nchan = wfs.size();
+  for (size_t c = 0; c < nchan; ++c)
+    {
+      float * wf = wfs[c];
+      for (size_t t = 0; t < nticks; ++t) wf[t] = in[t*nchan+c];
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef IIRFILTERKERNEL_H
+#define IIRFILTERKERNEL_H
+
+#include <cstddef>
+#include <vector>
+
+namespace dune {
+
+  // Widest instruction set the multi-channel filter can use
+  enum class SIMDLevel { kScalar, kAVX2, kAVX512 };
+
+  // Best level supported by the CPU we are running on
+  SIMDLevel BestSIMDLevel();
+
+  // Coefficients of the first order low pass filter of RMSHitFinderAlg,
+  // y[i] = a0*x[i] + b1*y[i-1], for a time constant of width ticks
+  void IIRFilterCoefficients(float width, float & a0, float & b1);
+
+  // Forward then backward first order IIR filter of nchan waveforms of
+  // nticks samples each, in place. The samples are stored channels-inner,
+  // wf[tick*nchan + chan], so that each SIMD lane filters one channel. The
+  // first sample of each pass is left as it is. Multiplications and
+  // additions are rounded separately, so the result of every level is the
+  // same as filtering each channel on its own.
+  void BidirectionalIIRFilter(float * wf, size_t nticks, size_t nchan, float a0, float b1,
+                              SIMDLevel level = BestSIMDLevel());
+
+  // Copy nchan waveforms of nticks samples into channels-inner order
+  void InterleaveChannels(const std::vector<const float*> & wfs, size_t nticks, float * out);
+  // Inverse of InterleaveChannels
+  void DeinterleaveChannels(const float * in, size_t nticks, const std::vector<float*> & wfs);
+
+}
+
+#endif
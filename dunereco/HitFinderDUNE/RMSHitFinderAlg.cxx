@@ -10,6 +10,13 @@ m.thiesse@sheffield.ac.uk
 ****************************************/
 
 #include "RMSHitFinderAlg.h"
+#include "IIRFilterKernel.h"
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+#include <cmath>
+#include <limits>
 
 dune::RMSHitFinderAlg::RMSHitFinderAlg(fhicl::ParameterSet const & p)
 {
@@ -31,115 +38,231 @@ void dune::RMSHitFinderAlg::FindHits(dune::ChannelInformation & chan)
     {
       fSearchTickStart = 0; fSearchTickEnd = chan.signalSize;
     }
-  std::vector<float> signalFilter(chan.signalFilterVec.begin()+fSearchTickStart,chan.signalFilterVec.begin()+fSearchTickEnd);
   //FilterWaveform(chan.signalVec,chan.signalFilterVec);
   //FilterWaveform(signal,signalFilter);
   //RobustRMSBase(chan.signalVec,chan.baseline,chan.rms);
   //RobustRMSBase(signalFilter,chan.baselineFilter,chan.rmsFilter);
-  FindPulses(signalFilter,chan.baselineFilter,chan.rmsFilter,chan.pulse_ends);
-  MergeHits(chan.pulse_ends);
+  FindPulses(chan.signalFilterVec.data()+fSearchTickStart,fSearchTickEnd-fSearchTickStart,fSearchTickStart,
+             chan.baselineFilter,chan.rmsFilter,chan.pulse_ends,fWorkspace);
+  MergeHits(chan.pulse_ends,fWorkspace);
 }
 
-void dune::RMSHitFinderAlg::FilterWaveform(std::vector<float> wf, std::vector<float> & fwf)
+void dune::RMSHitFinderAlg::ProcessChannels(dune::ChanMap_t & chans)
 {
-  fwf.clear();
-  unsigned int wfs = wf.size();
-  fwf.resize(wfs);
-  std::vector<float> intermediate_wf(wfs);
-  float filter_coef = static_cast<float>(TMath::Exp(static_cast<double>(-1.0/fFilterWidth)));
-  float a0 = 1.0-filter_coef;
-  float b1 = filter_coef;
-  unsigned int order = 1;
-  for (size_t i = 0; i < wfs; ++i)
+  std::vector<dune::ChannelInformation*> chan_list;
+  chan_list.reserve(chans.size());
+  for (auto & chan : chans) chan_list.push_back(&chan.second);
+
+  // Channels are handed out in blocks that are filtered together, one
+  // channel per SIMD lane. Each channel only writes to itself, so the
+  // results do not depend on the number of threads or on the order the
+  // blocks are processed in.
+  const size_t n_blocks = (chan_list.size()+kFilterBlock-1)/kFilterBlock;
+  tbb::parallel_for(tbb::blocked_range<size_t>(0,n_blocks),
+                    [&](const tbb::blocked_range<size_t> & range)
+                    {
+                      Workspace & ws = fThreadWorkspaces.local();
+                      for (size_t i_b = range.begin(); i_b < range.end(); ++i_b)
+                        {
+                          size_t first = i_b*kFilterBlock;
+                          size_t last = std::min(first+kFilterBlock,chan_list.size());
+                          FilterBlock(chan_list.data()+first,last-first,ws);
+                          for (size_t i_c = first; i_c < last; ++i_c) ProcessChannel(*chan_list[i_c],ws);
+                        }
+                    });
+}
+
+void dune::RMSHitFinderAlg::FilterBlock(dune::ChannelInformation * const * chans, size_t n, Workspace & ws) const
+{
+  const size_t nticks = chans[0]->signalVec.size();
+  bool same_size = true;
+  for (size_t i_c = 0; i_c < n; ++i_c) same_size = same_size && chans[i_c]->signalVec.size() == nticks;
+  if (!same_size || n == 1)
     {
-      if (i<order)
+      for (size_t i_c = 0; i_c < n; ++i_c)
         {
-          intermediate_wf[i] = wf[i];
-        }
-      else
-        {
-          intermediate_wf[i] = a0*wf[i]+b1*intermediate_wf[i-1];
+          const std::vector<float> & signal = chans[i_c]->signalVec;
+          FilterWaveform(signal.data(),signal.size(),chans[i_c]->signalFilterVec);
         }
+      return;
     }
-  for (size_t i = 0; i < wfs; ++i)
+
+  ws.in_ptrs.resize(n);
+  ws.out_ptrs.resize(n);
+  for (size_t i_c = 0; i_c < n; ++i_c)
     {
-      if (i<order)
-        {
-          fwf[wfs-1-i] = intermediate_wf[wfs-1-i];
-        }
-      else
-        {
-          fwf[wfs-1-i] = a0*intermediate_wf[wfs-1-i]+b1*fwf[wfs-i];
-        }
+      chans[i_c]->signalFilterVec.resize(nticks);
+      ws.in_ptrs[i_c] = chans[i_c]->signalVec.data();
+      ws.out_ptrs[i_c] = chans[i_c]->signalFilterVec.data();
     }
+  ws.interleaved.resize(nticks*n);
+  float a0, b1;
+  dune::IIRFilterCoefficients(fFilterWidth,a0,b1);
+  dune::InterleaveChannels(ws.in_ptrs,nticks,ws.interleaved.data());
+  dune::BidirectionalIIRFilter(ws.interleaved.data(),nticks,n,a0,b1);
+  dune::DeinterleaveChannels(ws.interleaved.data(),nticks,ws.out_ptrs);
 }
 
-void dune::RMSHitFinderAlg::RobustRMSBase(std::vector<float> wf, float & bl, float & r)
+void dune::RMSHitFinderAlg::ProcessChannel(dune::ChannelInformation & chan, Workspace & ws) const
 {
-  unsigned int window_size = (unsigned int)(0.10*wf.size());
-  std::vector<float> bl_collection;
-  for (size_t i_wf = 0; i_wf < wf.size()-window_size; ++i_wf)
+  const std::vector<float> & signal = chan.signalVec;
+  RobustRMSBase(signal.data(),signal.size(),chan.baseline,chan.rms,ws);
+  RobustRMSBase(chan.signalFilterVec.data(),chan.signalFilterVec.size(),chan.baselineFilter,chan.rmsFilter,ws);
+
+  int start = 0, end = chan.signalFilterVec.size();
+  if (fSearchTickStart >= 0 && fSearchTickEnd >= 0)
     {
-      std::vector<float> partial_window(wf.begin()+i_wf,wf.begin()+i_wf+window_size);
-      bl_collection.push_back(static_cast<float>(TMath::Mean(partial_window.size(),partial_window.data())));
+      start = std::min(fSearchTickStart,end);
+      end = std::max(start,std::min(fSearchTickEnd,end));
     }
-  bl = static_cast<float>(TMath::Median(bl_collection.size(),bl_collection.data()));
+  FindPulses(chan.signalFilterVec.data()+start,end-start,start,chan.baselineFilter,chan.rmsFilter,chan.pulse_ends,ws);
+  MergeHits(chan.pulse_ends,ws);
+}
+
+void dune::RMSHitFinderAlg::FilterWaveform(const std::vector<float> & wf, std::vector<float> & fwf)
+{
+  FilterWaveform(wf.data(),wf.size(),fwf);
+}
 
-  std::vector<float> bl_sub_wf;
-  for (size_t i_wf = 0; i_wf < wf.size(); ++i_wf) bl_sub_wf.push_back(wf[i_wf]-bl);
+void dune::RMSHitFinderAlg::FilterWaveform(const float * wf, size_t wfs, std::vector<float> & fwf) const
+{
+  fwf.assign(wf,wf+wfs);
+  float a0, b1;
+  dune::IIRFilterCoefficients(fFilterWidth,a0,b1);
+  dune::BidirectionalIIRFilter(fwf.data(),wfs,1,a0,b1,dune::SIMDLevel::kScalar);
+}
 
-  std::vector<float> rms_collection;
-  for (size_t i_wf = 0; i_wf < bl_sub_wf.size()-window_size; ++i_wf)
+void dune::RMSHitFinderAlg::WindowMeans(const float * wf, size_t n, unsigned int w, std::vector<float> & means)
+{
+  means.clear();
+  if (w == 0 || n < w) return;
+  means.resize(n-w+1);
+  double sum = 0.;
+  for (size_t i_wf = 0; i_wf < w; ++i_wf) sum += wf[i_wf];
+  means[0] = static_cast<float>(sum/w);
+  for (size_t i_wf = 1; i_wf < means.size(); ++i_wf)
     {
-      std::vector<float> partial_window(bl_sub_wf.begin()+i_wf,bl_sub_wf.begin()+i_wf+window_size);
-      rms_collection.push_back(static_cast<float>(TMath::RMS(partial_window.size(),partial_window.data())));
+      sum += static_cast<double>(wf[i_wf+w-1]) - static_cast<double>(wf[i_wf-1]);
+      means[i_wf] = static_cast<float>(sum/w);
+    }
+}
 
+float dune::RMSHitFinderAlg::Median(std::vector<float> & v)
+{
+  if (v.empty()) return 0.;
+  size_t n = v.size();
+  std::nth_element(v.begin(),v.begin()+n/2,v.end());
+  double median = v[n/2];
+  if (n%2 == 0)
+    {
+      // The other middle value is the largest of the lower half
+      median = 0.5*(median+*std::max_element(v.begin(),v.begin()+n/2));
+    }
+  return static_cast<float>(median);
+}
+
+void dune::RMSHitFinderAlg::RobustRMSBase(const std::vector<float> & wf, float & bl, float & r)
+{
+  RobustRMSBase(wf.data(),wf.size(),bl,r,fWorkspace);
+}
+
+void dune::RMSHitFinderAlg::RobustRMSBase(const float * wf, size_t n, float & bl, float & r, Workspace & ws) const
+{
+  unsigned int window_size = (unsigned int)(0.10*n);
+  size_t n_windows = n-window_size;
+  if (window_size == 0)
+    {
+      // Empty windows, as the mean and RMS of nothing
+      bl = n_windows ? std::numeric_limits<float>::quiet_NaN() : 0.;
+      r = 0.;
+      return;
+    }
+
+  // Same windows as before, the last window start is excluded
+  std::vector<float> & bl_collection = ws.window_means;
+  WindowMeans(wf,n,window_size,bl_collection);
+  bl_collection.resize(n_windows);
+  bl = Median(bl_collection);
+
+  // Sample RMS of each window of the baseline subtracted waveform, from the
+  // running sums of x and x^2
+  std::vector<float> & rms_collection = ws.window_rms;
+  rms_collection.resize(n_windows);
+  double sum = 0., sum2 = 0.;
+  for (size_t i_wf = 0; i_wf < n; ++i_wf)
+    {
+      double x = static_cast<float>(wf[i_wf]-bl);
+      sum += x; sum2 += x*x;
+      if (i_wf >= window_size)
+        {
+          double x_old = static_cast<float>(wf[i_wf-window_size]-bl);
+          sum -= x_old; sum2 -= x_old*x_old;
+        }
+      if (i_wf+1 >= window_size && i_wf+1-window_size < n_windows)
+        {
+          double var = window_size > 1 ? (sum2-sum*sum/window_size)/(window_size-1) : 0.;
+          rms_collection[i_wf+1-window_size] = static_cast<float>(std::sqrt(std::max(var,0.)));
+        }
     }
-  r = static_cast<float>(TMath::Median(rms_collection.size(),rms_collection.data()));
+  r = Median(rms_collection);
 }
 
 
-void dune::RMSHitFinderAlg::FindPulses(std::vector<float> wf, float bl, float r, std::vector<std::pair<int,int> > & pulse_ends)
+void dune::RMSHitFinderAlg::FindPulses(const float * wf, size_t n, int tick_offset, float bl, float r,
+                                       std::vector<std::pair<int,int> > & pulse_ends, Workspace & ws) const
 {
   pulse_ends.clear();
+  int n_windows = static_cast<int>(n)-fWindowWidth;
+  if (n_windows <= 0 || fWindowWidth <= 0) return;
+
+  // Every window mean is needed for the forward and the backwards scans
+  std::vector<float> & window_means = ws.window_means;
+  WindowMeans(wf,n,fWindowWidth,window_means);
+
+  float rise = bl+fSigmaRiseThreshold*r;
+  float fall = bl+fSigmaFallThreshold*r;
+  float fall_low = bl-fSigmaFallThreshold*r;
+
+  // Last window before each tick whose mean is below the fall threshold,
+  // which is where the backwards scan from a rising edge stops
+  std::vector<int> & last_below = ws.last_below;
+  last_below.resize(n_windows);
+  int last = -1;
+  for (int i_wf = 0; i_wf < n_windows; ++i_wf)
+    {
+      last_below[i_wf] = last;
+      if (window_means[i_wf] < fall) last = i_wf;
+    }
+
   int start = 0, end = 0;
   bool started = false;
-  for (int i_wf = 0; i_wf < static_cast<int>(wf.size())-fWindowWidth; ++i_wf)
+  for (int i_wf = 0; i_wf < n_windows; ++i_wf)
     {
-      std::vector<float> window(wf.begin()+i_wf,wf.begin()+i_wf+fWindowWidth);
-      float window_mean = static_cast<float>(TMath::Mean(window.size(),window.data()));
-      if ((window_mean > bl+fSigmaRiseThreshold*r) && !started)
+      float window_mean = window_means[i_wf];
+      if ((window_mean > rise) && !started)
         {
           started = true;
-          for (int i_wf_back = i_wf-1; i_wf_back >= 0; --i_wf_back)
-            {
-              std::vector<float> window_back(wf.begin()+i_wf_back,wf.begin()+i_wf_back+fWindowWidth);
-              float window_mean_back = static_cast<float>(TMath::Mean(window_back.size(),window_back.data()));
-              if (window_mean_back < bl+fSigmaFallThreshold*r)
-                {
-                  start = i_wf_back;
-                  break;
-                }
-            }
+          if (last_below[i_wf] >= 0) start = last_below[i_wf];
           continue;
         }
-      if ((window_mean < bl+fSigmaFallThreshold*r && window_mean > bl-fSigmaFallThreshold*r) && started)
+      if ((window_mean < fall && window_mean > fall_low) && started)
         {
           started = false;
           end = i_wf+fWindowWidth;
-          pulse_ends.push_back(std::make_pair(start+fSearchTickStart,end+fSearchTickStart));
+          pulse_ends.push_back(std::make_pair(start+tick_offset,end+tick_offset));
           continue;
         }
     }
   if (started)
     {
-      pulse_ends.push_back(std::make_pair(start+fSearchTickStart,wf.size()-1+fSearchTickStart));
+      pulse_ends.push_back(std::make_pair(start+tick_offset,static_cast<int>(n)-1+tick_offset));
     }
 }
 
-void dune::RMSHitFinderAlg::MergeHits(std::vector<std::pair<int,int> > & pulse_ends)
+void dune::RMSHitFinderAlg::MergeHits(std::vector<std::pair<int,int> > & pulse_ends, Workspace & ws) const
 {
-  std::vector<std::pair<int,int> > oldpulse_ends = std::move(pulse_ends);
+  std::vector<std::pair<int,int> > & oldpulse_ends = ws.pulses;
+  oldpulse_ends.swap(pulse_ends);
   pulse_ends.clear();
   std::sort(oldpulse_ends.begin(),oldpulse_ends.end());
   int start = 0, end = 0;
@@ -7,9 +7,12 @@
 
 #include "RobustHitFinderSupport.h"
 
+#include "tbb/enumerable_thread_specific.h"
+
 #include <memory>
 #include <algorithm>
 #include <map>
+#include <vector>
 
 namespace dune {
   class RMSHitFinderAlg {
@@ -20,14 +23,50 @@ public:
 
     void FindHits(dune::ChannelInformation & chan);
 
+    // Filter, baseline and hit search for all channels in parallel. Fills
+    // signalFilterVec, baseline, rms, baselineFilter, rmsFilter and pulse_ends
+    // of each channel from its signalVec. A negative search range means the
+    // whole waveform of each channel.
+    void ProcessChannels(dune::ChanMap_t & chans);
+
     void SetSearchTicks(int s, int e) { fSearchTickStart = s; fSearchTickEnd = e; }
 
-    void FilterWaveform(std::vector<float> wf, std::vector<float> & fwf);
-    void RobustRMSBase(std::vector<float> wf, float & bl, float & r);
+    void FilterWaveform(const std::vector<float> & wf, std::vector<float> & fwf);
+    // Baseline and noise RMS as the medians of the means and RMSs of all windows
+    // of 10% of the waveform, from running sums in a single pass
+    void RobustRMSBase(const std::vector<float> & wf, float & bl, float & r);
 
 private:
-    void FindPulses(std::vector<float> wf, float bl, float r, std::vector<std::pair<int,int> > & pulse_ends);
-    void MergeHits(std::vector<std::pair<int,int> > & pulse_ends);
+    // Scratch buffers, kept between channels so that their memory is reused
+    struct Workspace {
+      std::vector<float> window_means;
+      std::vector<float> window_rms;
+      std::vector<int> last_below;
+      std::vector<std::pair<int,int> > pulses;
+      std::vector<float> interleaved;        ///< Block of waveforms, channels-inner
+      std::vector<const float*> in_ptrs;
+      std::vector<float*> out_ptrs;
+    };
+
+    // Number of channels filtered together by ProcessChannels
+    static constexpr size_t kFilterBlock = 16;
+
+    // Fills signalFilterVec of n channels, together if they have the same length
+    void FilterBlock(dune::ChannelInformation * const * chans, size_t n, Workspace & ws) const;
+    // Baselines, RMSs and pulses of a channel whose waveform is already filtered
+    void ProcessChannel(dune::ChannelInformation & chan, Workspace & ws) const;
+
+    void FilterWaveform(const float * wf, size_t n, std::vector<float> & fwf) const;
+    void RobustRMSBase(const float * wf, size_t n, float & bl, float & r, Workspace & ws) const;
+    // Pulses of the n ticks at wf, reported with tick_offset added
+    void FindPulses(const float * wf, size_t n, int tick_offset, float bl, float r,
+                    std::vector<std::pair<int,int> > & pulse_ends, Workspace & ws) const;
+    void MergeHits(std::vector<std::pair<int,int> > & pulse_ends, Workspace & ws) const;
+
+    // Means of all windows of width w, from a running sum
+    static void WindowMeans(const float * wf, size_t n, unsigned int w, std::vector<float> & means);
+    // Median with the TMath::Median convention of averaging the two middle values
+    static float Median(std::vector<float> & v);
 
     int fWindowWidth;
     float fFilterWidth;
@@ -35,6 +74,9 @@ private:
     float fSigmaFallThreshold;
     int fSearchTickStart;
     int fSearchTickEnd;
+
+    Workspace fWorkspace;                                    ///< Used by the single channel methods
+    tbb::enumerable_thread_specific<Workspace> fThreadWorkspaces; ///< One per thread for ProcessChannels
   };
 
 }
@@ -0,0 +1,276 @@
+/****************************************
+
+Regression test and per channel timing of
+RMSHitFinderAlg. Synthetic waveforms are run
+through the original window by window
+implementation, kept below as the reference,
+and through the running sum implementation,
+one channel at a time and with ProcessChannels.
+The filtered waveforms, baselines, RMSs and
+pulses must all be identical.
+
+Usage: RMSHitFinderAlg_t [channels] [ticks]
+
+****************************************/
+
+#include "RMSHitFinderAlg.h"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "TMath.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+  // The settings of dune35t_rmshitfinderalg
+  const int kWindowWidth = 50;
+  const float kFilterWidth = 6;
+  const float kSigmaRiseThreshold = 2.0;
+  const float kSigmaFallThreshold = 0.25;
+
+  // Reference implementation, as RMSHitFinderAlg was before the running sums
+  void LegacyFilterWaveform(std::vector<float> wf, std::vector<float> & fwf)
+  {
+    fwf.clear();
+    unsigned int wfs = wf.size();
+    fwf.resize(wfs);
+    std::vector<float> intermediate_wf(wfs);
+    float filter_coef = static_cast<float>(TMath::Exp(static_cast<double>(-1.0/kFilterWidth)));
+    float a0 = 1.0-filter_coef;
+    float b1 = filter_coef;
+    unsigned int order = 1;
+    for (size_t i = 0; i < wfs; ++i)
+      {
+        if (i<order) intermediate_wf[i] = wf[i];
+        else intermediate_wf[i] = a0*wf[i]+b1*intermediate_wf[i-1];
+      }
+    for (size_t i = 0; i < wfs; ++i)
+      {
+        if (i<order) fwf[wfs-1-i] = intermediate_wf[wfs-1-i];
+        else fwf[wfs-1-i] = a0*intermediate_wf[wfs-1-i]+b1*fwf[wfs-i];
+      }
+  }
+
+  void LegacyRobustRMSBase(std::vector<float> wf, float & bl, float & r)
+  {
+    unsigned int window_size = (unsigned int)(0.10*wf.size());
+    std::vector<float> bl_collection;
+    for (size_t i_wf = 0; i_wf < wf.size()-window_size; ++i_wf)
+      {
+        std::vector<float> partial_window(wf.begin()+i_wf,wf.begin()+i_wf+window_size);
+        bl_collection.push_back(static_cast<float>(TMath::Mean(partial_window.size(),partial_window.data())));
+      }
+    bl = static_cast<float>(TMath::Median(bl_collection.size(),bl_collection.data()));
+
+    std::vector<float> bl_sub_wf;
+    for (size_t i_wf = 0; i_wf < wf.size(); ++i_wf) bl_sub_wf.push_back(wf[i_wf]-bl);
+
+    std::vector<float> rms_collection;
+    for (size_t i_wf = 0; i_wf < bl_sub_wf.size()-window_size; ++i_wf)
+      {
+        std::vector<float> partial_window(bl_sub_wf.begin()+i_wf,bl_sub_wf.begin()+i_wf+window_size);
+        rms_collection.push_back(static_cast<float>(TMath::RMS(partial_window.size(),partial_window.data())));
+      }
+    r = static_cast<float>(TMath::Median(rms_collection.size(),rms_collection.data()));
+  }
+
+  void LegacyFindPulses(std::vector<float> wf, float bl, float r, int tick_offset,
+                        std::vector<std::pair<int,int> > & pulse_ends)
+  {
+    pulse_ends.clear();
+    int start = 0, end = 0;
+    bool started = false;
+    for (int i_wf = 0; i_wf < static_cast<int>(wf.size())-kWindowWidth; ++i_wf)
+      {
+        std::vector<float> window(wf.begin()+i_wf,wf.begin()+i_wf+kWindowWidth);
+        float window_mean = static_cast<float>(TMath::Mean(window.size(),window.data()));
+        if ((window_mean > bl+kSigmaRiseThreshold*r) && !started)
+          {
+            started = true;
+            for (int i_wf_back = i_wf-1; i_wf_back >= 0; --i_wf_back)
+              {
+                std::vector<float> window_back(wf.begin()+i_wf_back,wf.begin()+i_wf_back+kWindowWidth);
+                float window_mean_back = static_cast<float>(TMath::Mean(window_back.size(),window_back.data()));
+                if (window_mean_back < bl+kSigmaFallThreshold*r)
+                  {
+                    start = i_wf_back;
+                    break;
+                  }
+              }
+            continue;
+          }
+        if ((window_mean < bl+kSigmaFallThreshold*r && window_mean > bl-kSigmaFallThreshold*r) && started)
+          {
+            started = false;
+            end = i_wf+kWindowWidth;
+            pulse_ends.push_back(std::make_pair(start+tick_offset,end+tick_offset));
+            continue;
+          }
+      }
+    if (started)
+      {
+        pulse_ends.push_back(std::make_pair(start+tick_offset,static_cast<int>(wf.size())-1+tick_offset));
+      }
+  }
+
+  void LegacyMergeHits(std::vector<std::pair<int,int> > & pulse_ends)
+  {
+    std::vector<std::pair<int,int> > oldpulse_ends = std::move(pulse_ends);
+    pulse_ends.clear();
+    std::sort(oldpulse_ends.begin(),oldpulse_ends.end());
+    int start = 0, end = 0;
+    bool started = false;
+    for (size_t i_p = 0; i_p < oldpulse_ends.size(); ++i_p)
+      {
+        if (!started) start = oldpulse_ends[i_p].first;
+        end = oldpulse_ends[i_p].second;
+        if (i_p < oldpulse_ends.size()-1 && oldpulse_ends[i_p+1].first < oldpulse_ends[i_p].second)
+          {
+            end = oldpulse_ends[i_p+1].second;
+            started = true;
+          }
+        else
+          {
+            started = false;
+            pulse_ends.push_back(std::make_pair(start,end));
+          }
+      }
+  }
+
+  void LegacyProcessChannel(dune::ChannelInformation & chan, int search_start, int search_end)
+  {
+    LegacyFilterWaveform(chan.signalVec,chan.signalFilterVec);
+    LegacyRobustRMSBase(chan.signalVec,chan.baseline,chan.rms);
+    LegacyRobustRMSBase(chan.signalFilterVec,chan.baselineFilter,chan.rmsFilter);
+    if (search_start < 0 || search_end < 0)
+      {
+        search_start = 0; search_end = chan.signalSize;
+      }
+    std::vector<float> signalFilter(chan.signalFilterVec.begin()+search_start,chan.signalFilterVec.begin()+search_end);
+    LegacyFindPulses(signalFilter,chan.baselineFilter,chan.rmsFilter,search_start,chan.pulse_ends);
+    LegacyMergeHits(chan.pulse_ends);
+  }
+
+  // Gaussian noise on a pedestal, with a few unipolar pulses
+  dune::ChanMap_t MakeChannels(int n_chans, int n_ticks)
+  {
+    std::mt19937 engine(5);
+    std::normal_distribution<float> noise(0.,2.5);
+    dune::ChanMap_t chans;
+    for (int i_c = 0; i_c < n_chans; ++i_c)
+      {
+        dune::ChannelInformation & chan = chans[i_c];
+        chan.channelID = i_c;
+        chan.signalSize = n_ticks;
+        chan.signalVec.resize(n_ticks);
+        float pedestal = (i_c%7)*100.;
+        for (int i_t = 0; i_t < n_ticks; ++i_t) chan.signalVec[i_t] = pedestal+noise(engine);
+        int n_pulses = engine()%8;
+        for (int i_p = 0; i_p < n_pulses; ++i_p)
+          {
+            int tick = engine()%n_ticks;
+            float amplitude = 10.+engine()%200;
+            for (int i_t = 0; i_t < 40 && tick+i_t < n_ticks; ++i_t)
+              chan.signalVec[tick+i_t] += amplitude*std::exp(-std::pow((i_t-10)/4.,2));
+          }
+      }
+    return chans;
+  }
+
+  int CountMismatches(const dune::ChanMap_t & ref, const dune::ChanMap_t & out)
+  {
+    int n_bad = 0;
+    for (auto const & kv : out)
+      {
+        const dune::ChannelInformation & r = ref.at(kv.first);
+        const dune::ChannelInformation & o = kv.second;
+        if (o.signalFilterVec != r.signalFilterVec || o.baseline != r.baseline || o.rms != r.rms ||
+            o.baselineFilter != r.baselineFilter || o.rmsFilter != r.rmsFilter || o.pulse_ends != r.pulse_ends)
+          {
+            if (n_bad < 10) std::cerr << "Channel " << kv.first << " differs from the reference" << std::endl;
+            ++n_bad;
+          }
+      }
+    return n_bad;
+  }
+
+  double MicrosecondsSince(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+  }
+
+}
+
+int main(int argc, char* argv[])
+{
+  int n_chans = argc > 1 ? std::atoi(argv[1]) : 50;
+  int n_ticks = argc > 2 ? std::atoi(argv[2]) : 6000;
+  if (n_chans < 1 || n_ticks < 20)
+    {
+      std::cerr << "Usage: RMSHitFinderAlg_t [channels] [ticks, at least 20]" << std::endl;
+      return 1;
+    }
+
+  fhicl::ParameterSet pset;
+  pset.put("WindowWidth",kWindowWidth);
+  pset.put("FilterWidth",kFilterWidth);
+  pset.put("SigmaRiseThreshold",kSigmaRiseThreshold);
+  pset.put("SigmaFallThreshold",kSigmaFallThreshold);
+
+  const dune::ChanMap_t chans = MakeChannels(n_chans,n_ticks);
+  int n_bad = 0;
+
+  // The whole waveform, then a restricted search range
+  const int search_ranges[2][2] = {{-1,-1},{n_ticks/10,n_ticks/2}};
+  for (auto const & range : search_ranges)
+    {
+      dune::ChanMap_t ref = chans;
+      auto start = std::chrono::steady_clock::now();
+      for (auto & kv : ref) LegacyProcessChannel(kv.second,range[0],range[1]);
+      double t_legacy = MicrosecondsSince(start);
+
+      // One channel at a time, as HitFinder35t does
+      dune::ChanMap_t single = chans;
+      dune::RMSHitFinderAlg alg(pset);
+      start = std::chrono::steady_clock::now();
+      for (auto & kv : single)
+        {
+          dune::ChannelInformation & chan = kv.second;
+          alg.FilterWaveform(chan.signalVec,chan.signalFilterVec);
+          alg.RobustRMSBase(chan.signalVec,chan.baseline,chan.rms);
+          alg.RobustRMSBase(chan.signalFilterVec,chan.baselineFilter,chan.rmsFilter);
+          alg.SetSearchTicks(range[0],range[1]);
+          alg.FindHits(chan);
+        }
+      double t_single = MicrosecondsSince(start);
+
+      dune::ChanMap_t parallel = chans;
+      dune::RMSHitFinderAlg parallel_alg(pset);
+      parallel_alg.SetSearchTicks(range[0],range[1]);
+      start = std::chrono::steady_clock::now();
+      parallel_alg.ProcessChannels(parallel);
+      double t_parallel = MicrosecondsSince(start);
+
+      int n_bad_single = CountMismatches(ref,single);
+      int n_bad_parallel = CountMismatches(ref,parallel);
+      n_bad += n_bad_single+n_bad_parallel;
+
+      size_t n_hits = 0;
+      for (auto const & kv : ref) n_hits += kv.second.pulse_ends.size();
+
+      std::cout << "Search ticks " << range[0] << " to " << range[1] << ": "
+                << n_chans << " channels of " << n_ticks << " ticks, " << n_hits << " hits" << std::endl;
+      std::cout << "  reference        " << t_legacy/n_chans << " us per channel" << std::endl;
+      std::cout << "  single channel   " << t_single/n_chans << " us per channel, "
+                << n_bad_single << " channels differ" << std::endl;
+      std::cout << "  ProcessChannels  " << t_parallel/n_chans << " us per channel, "
+                << n_bad_parallel << " channels differ" << std::endl;
+    }
+
+  return n_bad == 0 ? 0 : 1;
+}
@@ -22,11 +22,21 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/GeometryCore.h"
 
+// TBB
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 // std includes
 #include <string>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // implementation follows
@@ -53,6 +63,8 @@ void DBScanAlg_DUNE35t::reconfigure(fhicl::ParameterSet const &pset)
     m_timeAdvanceGap         = pset.get<double>("TimeAdvanceGap",   50.);
     m_numSigmaPeakTime       = pset.get<double>("NumSigmaPeakTime",  5.);
     m_EpsMaxDist             = pset.get<double>("EpsilonDistanceDBScan", 5.);
+    m_useNeighborhoodGrid    = pset.get<bool>("UseNeighborhoodGrid", true);
+    m_parallelDBScan         = pset.get<bool>("ParallelDBScan", false);
     
     art::ServiceHandle<geo::Geometry>            geometry;
     
@@ -63,60 +75,225 @@ void DBScanAlg_DUNE35t::reconfigure(fhicl::ParameterSet const &pset)
     
 }
     
-void DBScanAlg_DUNE35t::expandCluster(EpsPairNeighborhoodMapVec&          epsNeighborhoodMapVec,
-                              EpsPairNeighborhoodMapVec::iterator epsVecItr,
-                              reco::HitPairListPtr&               curCluster,
-                              size_t                              minPts) const
+void DBScanAlg_DUNE35t::expandCluster(EpsNeighborhood&      epsNeighborhood,
+                                      size_t                hitID,
+                                      reco::HitPairListPtr& curCluster,
+                                      size_t                minPts) const
 {
     // This is the main inside loop for the DBScan based clustering algorithm
     //
     // Add the current hit to the current cluster
-    epsVecItr->second.first.setInCluster();
-    curCluster.push_back(epsVecItr->first);
+    epsNeighborhood.params[hitID].setInCluster();
+    curCluster.push_back(epsNeighborhood.hits[hitID]);
     
     // Get the list of points in this hit's epsilon neighborhood
-    // Note this is a copy so we can modify locally
-    EpsPairNeighborhoodList epsNeighborhoodList = epsVecItr->second.second;
+    // Note this is a copy so we can add to it as we go
+    std::vector<size_t> epsNeighborhoodList(epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[hitID],
+                                            epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[hitID + 1]);
     
-    while(!epsNeighborhoodList.empty())
+    for(size_t listIdx = 0; listIdx < epsNeighborhoodList.size(); listIdx++)
     {
-        // Dereference the point so we can see in the debugger...
-        const reco::ClusterHit3D* neighborPtr = epsNeighborhoodList.front();
-        
-        // Use that to look up the iterator in the general neighborhood map
-        EpsPairNeighborhoodMapVec::iterator curPtEpsVecItr = epsNeighborhoodMapVec.begin();
-        
-        std::advance(curPtEpsVecItr, neighborPtr->getID());
+        size_t        neighborID = epsNeighborhoodList[listIdx];
+        DBScanParams& neighborParams = epsNeighborhood.params[neighborID];
         
         // If we've not been here before then take action...
-        if (!curPtEpsVecItr->second.first.visited())
+        if (!neighborParams.visited())
         {
-            curPtEpsVecItr->second.first.setVisited();
+            neighborParams.setVisited();
                 
             // If this epsilon neighborhood of this point is large enough then add its points to our list
-            if (curPtEpsVecItr->second.first.getCount() >= minPts)
+            if (neighborParams.getCount() >= minPts)
             {
-                // Plan is to loop through the hits in this point's neighborhood and add them to our list provided
-                // they have not already been added, or are part of a cluster, etc.
-                // So, get the list of points in the neighborhood
-                EpsPairNeighborhoodList& locList = curPtEpsVecItr->second.second;
-                    
-                // And loop through them...
-                for(EpsPairNeighborhoodList::iterator hitItr = locList.begin(); hitItr != locList.end(); hitItr++)
-                {
-                    epsNeighborhoodList.push_back(*hitItr);
-                }
+                epsNeighborhoodList.insert(epsNeighborhoodList.end(),
+                                           epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[neighborID],
+                                           epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[neighborID + 1]);
             }
         }
             
         // If the point is not yet in a cluster then we now add
-        if (!curPtEpsVecItr->second.first.inCluster())
+        if (!neighborParams.inCluster())
+        {
+            neighborParams.setInCluster();
+            curCluster.push_back(epsNeighborhood.hits[neighborID]);
+        }
+    }
+    
+    return;
+}
+
+namespace
+{
+    // Root of a hit in the union-find forest. Parents only ever point to lower IDs, and
+    // paths are halved along the way, which is safe with concurrent unions.
+    size_t FindRoot(std::vector<std::atomic<size_t>>& parents, size_t hitID)
+    {
+        size_t parent = parents[hitID].load();
+        
+        while(parent != hitID)
         {
-            curPtEpsVecItr->second.first.setInCluster();
-            curCluster.push_back(curPtEpsVecItr->first);
+            size_t grandParent = parents[parent].load();
+            
+            if (grandParent != parent) parents[hitID].compare_exchange_weak(parent, grandParent);
+            
+            hitID  = grandParent;
+            parent = parents[hitID].load();
         }
         
-        epsNeighborhoodList.pop_front();
+        return hitID;
+    }
+    
+    // Merge the trees of two hits, always under the lower root, so each root ends up being
+    // the lowest ID of its tree
+    void UniteRoots(std::vector<std::atomic<size_t>>& parents, size_t hitID1, size_t hitID2)
+    {
+        while(true)
+        {
+            size_t root1 = FindRoot(parents, hitID1);
+            size_t root2 = FindRoot(parents, hitID2);
+            
+            if (root1 == root2) return;
+            
+            if (root1 < root2) std::swap(root1, root2);
+            
+            // Fails if root1 was attached elsewhere in the meantime, in which case try again
+            if (parents[root1].compare_exchange_strong(root1, root2)) return;
+        }
+    }
+}
+
+void DBScanAlg_DUNE35t::ParallelDBScan(EpsNeighborhood&         epsNeighborhood,
+                                       reco::HitPairClusterMap& hitPairClusterMap) const
+{
+    // The serial loop starts a cluster from each core point not yet reached, in ID order, and
+    // expands it through the core points in its neighborhood. Its clusters are therefore the
+    // connected sets of core points, numbered in order of their lowest ID, and each border
+    // point goes to the first of these clusters with a core point next to it. The same is
+    // done here with a union-find over the core points, where every root is the lowest ID.
+    const size_t numIDs = epsNeighborhood.hits.size();
+    const size_t noCluster = numIDs;
+    
+    std::vector<char>                isCore(numIDs, 0);
+    std::vector<std::atomic<size_t>> parents(numIDs);
+    std::vector<size_t>              seeds(numIDs, noCluster);
+    
+    // Core points
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numIDs),
+                      [&](const tbb::blocked_range<size_t>& range)
+                      {
+                          for(size_t hitID = range.begin(); hitID < range.end(); hitID++)
+                          {
+                              parents[hitID].store(hitID);
+                              isCore[hitID] = epsNeighborhood.hits[hitID] && epsNeighborhood.params[hitID].getCount() >= m_minPairPts;
+                          }
+                      });
+    
+    // Join the core points with their core neighbors, the links are symmetric so one direction will do
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numIDs),
+                      [&](const tbb::blocked_range<size_t>& range)
+                      {
+                          for(size_t hitID = range.begin(); hitID < range.end(); hitID++)
+                          {
+                              if (!isCore[hitID]) continue;
+                              
+                              for(size_t nbrIdx = epsNeighborhood.offsets[hitID]; nbrIdx < epsNeighborhood.offsets[hitID + 1]; nbrIdx++)
+                              {
+                                  size_t neighborID = epsNeighborhood.neighbors[nbrIdx];
+                                  
+                                  if (neighborID < hitID && isCore[neighborID]) UniteRoots(parents, hitID, neighborID);
+                              }
+                          }
+                      });
+    
+    // Core points take the seed of their tree and border points that of the earliest neighboring cluster
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numIDs),
+                      [&](const tbb::blocked_range<size_t>& range)
+                      {
+                          for(size_t hitID = range.begin(); hitID < range.end(); hitID++)
+                          {
+                              if (!epsNeighborhood.hits[hitID]) continue;
+                              
+                              if (isCore[hitID])
+                              {
+                                  seeds[hitID] = FindRoot(parents, hitID);
+                                  continue;
+                              }
+                              
+                              for(size_t nbrIdx = epsNeighborhood.offsets[hitID]; nbrIdx < epsNeighborhood.offsets[hitID + 1]; nbrIdx++)
+                              {
+                                  size_t neighborID = epsNeighborhood.neighbors[nbrIdx];
+                                  
+                                  if (isCore[neighborID]) seeds[hitID] = std::min(seeds[hitID], FindRoot(parents, neighborID));
+                              }
+                          }
+                      });
+    
+    // Number the clusters as the serial loop would
+    std::vector<size_t> clusterSeeds;
+    
+    for(size_t hitID = 0; hitID < numIDs; hitID++)
+    {
+        if (isCore[hitID] && seeds[hitID] == hitID) clusterSeeds.push_back(hitID);
+    }
+    
+    // Walk each cluster in the order expandCluster does, so the hits come out in the same order.
+    // Every hit belongs to a single cluster, so the clusters can be walked at the same time.
+    std::vector<reco::HitPairListPtr> clusters(clusterSeeds.size());
+    std::vector<char>                 expanded(numIDs, 0);
+    std::vector<char>                 added(numIDs, 0);
+    
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, clusterSeeds.size()),
+                      [&](const tbb::blocked_range<size_t>& range)
+                      {
+                          std::vector<size_t> epsNeighborhoodList;
+                          
+                          for(size_t clusterIdx = range.begin(); clusterIdx < range.end(); clusterIdx++)
+                          {
+                              size_t seedID = clusterSeeds[clusterIdx];
+                              
+                              expanded[seedID] = 1;
+                              added[seedID]    = 1;
+                              clusters[clusterIdx].push_back(epsNeighborhood.hits[seedID]);
+                              
+                              epsNeighborhoodList.assign(epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[seedID],
+                                                         epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[seedID + 1]);
+                              
+                              for(size_t listIdx = 0; listIdx < epsNeighborhoodList.size(); listIdx++)
+                              {
+                                  size_t neighborID = epsNeighborhoodList[listIdx];
+                                  
+                                  // Border points of an earlier cluster were already taken
+                                  if (seeds[neighborID] != seedID) continue;
+                                  
+                                  if (isCore[neighborID] && !expanded[neighborID])
+                                  {
+                                      expanded[neighborID] = 1;
+                                      epsNeighborhoodList.insert(epsNeighborhoodList.end(),
+                                                                 epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[neighborID],
+                                                                 epsNeighborhood.neighbors.begin() + epsNeighborhood.offsets[neighborID + 1]);
+                                  }
+                                  
+                                  if (!added[neighborID])
+                                  {
+                                      added[neighborID] = 1;
+                                      clusters[clusterIdx].push_back(epsNeighborhood.hits[neighborID]);
+                                  }
+                              }
+                          }
+                      });
+    
+    for(size_t clusterIdx = 0; clusterIdx < clusters.size(); clusterIdx++)
+        hitPairClusterMap[clusterIdx] = std::move(clusters[clusterIdx]);
+    
+    for(size_t hitID = 0; hitID < numIDs; hitID++)
+    {
+        if (!epsNeighborhood.hits[hitID]) continue;
+        
+        DBScanParams& hitParams = epsNeighborhood.params[hitID];
+        
+        hitParams.setVisited();
+        
+        if (seeds[hitID] == noCluster) hitParams.setNoise();
+        else                           hitParams.setInCluster();
     }
     
     return;
@@ -235,13 +412,13 @@ void DBScanAlg_DUNE35t::ClusterHitsDBScan(ViewToHitVectorMap&       viewToHitVec
     }
 
     // The container of pairs and those in each pair's epsilon neighborhood
-    EpsPairNeighborhoodMapVec epsPairNeighborhoodMapVec;
-    epsPairNeighborhoodMapVec.resize(numHitPairs, EpsPairNeighborhoodMapPair(0,EpsPairNeighborhoodPair()));  //<-- initialize too!
+    EpsNeighborhood epsNeighborhood;
+    epsNeighborhood.hits.resize(numHitPairs, 0);
     
     // DBScan is driven of its "epsilon neighborhood". Computing adjacency within DBScan can be time
     // consuming so the idea is the prebuild the adjaceny map and then run DBScan.
     // The following call does this work
-    BuildNeighborhoodMap(hitPairList, epsPairNeighborhoodMapVec);
+    BuildNeighborhoodMap(hitPairList, epsNeighborhood);
 
     //Monitoring activity
     if (m_enableMonitoring)
@@ -256,33 +433,40 @@ void DBScanAlg_DUNE35t::ClusterHitsDBScan(ViewToHitVectorMap&       viewToHitVec
     // Clear the cluster list just for something to do here...
     hitPairClusterMap.clear();
     
-    // Ok, here we go!
-    // We can simply iterate over the map we have just built to loop through the hits "simply"
-    for(EpsPairNeighborhoodMapVec::iterator epsPairVecItr  = epsPairNeighborhoodMapVec.begin();
-                                            epsPairVecItr != epsPairNeighborhoodMapVec.end();
-                                            epsPairVecItr++)
+    if (m_parallelDBScan)
     {
-        // Skip the null entries (they were filtered out)
-        if (!epsPairVecItr->first) continue;
-        
-        // If this hit has been "visited" already then skip
-        if (epsPairVecItr->second.first.visited()) continue;
-        
-        // We are now visiting it so mark it as so
-        epsPairVecItr->second.first.setVisited();
-        
-        // Check that density is sufficient
-        if (epsPairVecItr->second.first.getCount() < m_minPairPts)
-        {
-            epsPairVecItr->second.first.setNoise();
-        }
-        else
+        ParallelDBScan(epsNeighborhood, hitPairClusterMap);
+    }
+    else
+    {
+        // Ok, here we go!
+        // We can simply iterate over the map we have just built to loop through the hits "simply"
+        for(size_t hitID = 0; hitID < epsNeighborhood.hits.size(); hitID++)
         {
-            // "Create" a new cluster and get a reference to it
-            reco::HitPairListPtr& curCluster = hitPairClusterMap[pairClusterIdx++];
+            // Skip the null entries (they were filtered out)
+            if (!epsNeighborhood.hits[hitID]) continue;
+            
+            DBScanParams& hitParams = epsNeighborhood.params[hitID];
             
-            // expand the cluster
-            expandCluster(epsPairNeighborhoodMapVec, epsPairVecItr, curCluster, m_minPairPts);
+            // If this hit has been "visited" already then skip
+            if (hitParams.visited()) continue;
+            
+            // We are now visiting it so mark it as so
+            hitParams.setVisited();
+            
+            // Check that density is sufficient
+            if (hitParams.getCount() < m_minPairPts)
+            {
+                hitParams.setNoise();
+            }
+            else
+            {
+                // "Create" a new cluster and get a reference to it
+                reco::HitPairListPtr& curCluster = hitPairClusterMap[pairClusterIdx++];
+                
+                // expand the cluster
+                expandCluster(epsNeighborhood, hitID, curCluster, m_minPairPts);
+            }
         }
     }
 
@@ -466,110 +650,293 @@ size_t DBScanAlg_DUNE35t::BuildHitPairMap(ViewToHitVectorMap& viewToHitVectorMap
 
 //REL modified
 size_t DBScanAlg_DUNE35t::BuildNeighborhoodMap(HitPairList& hitPairList,
-					       EpsPairNeighborhoodMapVec& epsPairNeighborhoodMapVec )const
-					      
+                                               EpsNeighborhood& epsNeighborhood)
 {
-  size_t consistentPairsCnt = 0;
-  size_t pairsChecked = 0;
-  
-  for (HitPairList::const_iterator pairItrO = hitPairList.begin(); pairItrO != hitPairList.end(); pairItrO++){
-     
-    const reco::ClusterHit3D* hitPairO   = (*pairItrO).get();
-    const size_t              hitPairOID = hitPairO->getID();
+    cet::cpu_timer theClockScan;
+    cet::cpu_timer theClockFill;
+    
+    // The hits in list order, sorted by z, then y and then x
+    std::vector<const reco::ClusterHit3D*> sortedHits;
+    sortedHits.reserve(hitPairList.size());
+    
+    size_t numIDs = epsNeighborhood.hits.size();
+    
+    for (const auto& hitPair : hitPairList)
+    {
+        sortedHits.push_back(hitPair.get());
+        numIDs = std::max(numIDs, hitPair->getID() + 1);
+    }
+    
+    std::vector<size_t> laterOffsets;
+    std::vector<size_t> laterNeighbors;
+    
+    if (m_useNeighborhoodGrid)
+    {
+        FindLaterNeighborsGrid(sortedHits, laterOffsets, laterNeighbors);
+    }
+    else
+    {
+        if (m_enableMonitoring) theClockScan.start();
+        
+        FindLaterNeighborsScan(sortedHits, laterOffsets, laterNeighbors);
+        
+        if (m_enableMonitoring)
+        {
+            theClockScan.stop();
+            
+            m_timeVector[BUILDHITGRID]  = 0.;
+            m_timeVector[FINDNEIGHBORS] = theClockScan.accumulated_real_time();
+        }
+    }
+    
+    if (m_enableMonitoring) theClockFill.start();
+    
+    // Each pair found goes to the neighborhoods of both of its hits. The neighborhood of a hit
+    // holds first the earlier hits which took it as a neighbor, in list order, and then the
+    // later hits which it took, closest first.
+    epsNeighborhood.hits.resize(numIDs, 0);
+    epsNeighborhood.offsets.assign(numIDs + 1, 0);
+    
+    for (size_t hitIdx = 0; hitIdx < sortedHits.size(); hitIdx++)
+    {
+        epsNeighborhood.hits[sortedHits[hitIdx]->getID()] = sortedHits[hitIdx];
+        
+        for (size_t nbrIdx = laterOffsets[hitIdx]; nbrIdx < laterOffsets[hitIdx + 1]; nbrIdx++)
+        {
+            epsNeighborhood.offsets[sortedHits[hitIdx]->getID() + 1]++;
+            epsNeighborhood.offsets[sortedHits[laterNeighbors[nbrIdx]]->getID() + 1]++;
+        }
+    }
+    
+    std::partial_sum(epsNeighborhood.offsets.begin(), epsNeighborhood.offsets.end(), epsNeighborhood.offsets.begin());
+    
+    epsNeighborhood.neighbors.resize(epsNeighborhood.offsets.back());
+    
+    std::vector<size_t> fillIdx(epsNeighborhood.offsets.begin(), epsNeighborhood.offsets.end() - 1);
+    
+    for (size_t hitIdx = 0; hitIdx < sortedHits.size(); hitIdx++)
+    {
+        for (size_t nbrIdx = laterOffsets[hitIdx]; nbrIdx < laterOffsets[hitIdx + 1]; nbrIdx++)
+            epsNeighborhood.neighbors[fillIdx[sortedHits[laterNeighbors[nbrIdx]]->getID()]++] = sortedHits[hitIdx]->getID();
+    }
+    
+    for (size_t hitIdx = 0; hitIdx < sortedHits.size(); hitIdx++)
+    {
+        size_t hitID = sortedHits[hitIdx]->getID();
+        
+        for (size_t nbrIdx = laterOffsets[hitIdx]; nbrIdx < laterOffsets[hitIdx + 1]; nbrIdx++)
+            epsNeighborhood.neighbors[fillIdx[hitID]++] = sortedHits[laterNeighbors[nbrIdx]]->getID();
+    }
+    
+    epsNeighborhood.params.assign(numIDs, DBScanParams());
+    
+    for (size_t hitID = 0; hitID < numIDs; hitID++)
+        epsNeighborhood.params[hitID].setCount(epsNeighborhood.offsets[hitID + 1] - epsNeighborhood.offsets[hitID]);
+    
+    if (m_enableMonitoring)
+    {
+        theClockFill.stop();
+        
+        m_timeVector[FILLNEIGHBORHOOD] = theClockFill.accumulated_real_time();
+    }
+    
+    mf::LogDebug("Cluster3D") << "Consistent pairs: " << laterNeighbors.size() << " of " << sortedHits.size() << " hits." << std::endl;
     
-    // Need to initialize the "first" part of the vector pseudo map
-    epsPairNeighborhoodMapVec[hitPairOID].first = hitPairO;
+    return laterNeighbors.size();
+}
+
+void DBScanAlg_DUNE35t::FindLaterNeighborsGrid(const std::vector<const reco::ClusterHit3D*>& sortedHits,
+                                               std::vector<size_t>&                          laterOffsets,
+                                               std::vector<size_t>&                          laterNeighbors)
+{
+    cet::cpu_timer theClockGrid;
+    cet::cpu_timer theClockSearch;
+    
+    if (m_enableMonitoring) theClockGrid.start();
+    
+    laterOffsets.assign(1, 0);
+    laterNeighbors.clear();
+    
+    const double maxDist   = m_EpsMaxDist;
+    const double maxDistSq = maxDist * maxDist;
     
-    // Get reference to the list for this hit so we don't look it up inside the loop
-    EpsPairNeighborhoodPair& hitPairOPair(epsPairNeighborhoodMapVec[hitPairOID].second);
+    std::vector<std::array<double,3>> positions(sortedHits.size());
+    std::array<double,3>              minPos = {0., 0., 0.};
+    std::array<double,3>              maxPos = {0., 0., 0.};
     
-    HitPairList::const_iterator pairItrI = pairItrO;
+    for (size_t hitIdx = 0; hitIdx < sortedHits.size(); hitIdx++)
+    {
+        for (size_t dim = 0; dim < 3; dim++)
+        {
+            positions[hitIdx][dim] = sortedHits[hitIdx]->getPosition()[dim];
+            
+            if (hitIdx == 0 || positions[hitIdx][dim] < minPos[dim]) minPos[dim] = positions[hitIdx][dim];
+            if (hitIdx == 0 || positions[hitIdx][dim] > maxPos[dim]) maxPos[dim] = positions[hitIdx][dim];
+        }
+    }
+    
+    // Bin the hits in cubes of side maxDist, so all neighbors of a hit are in the 27 cubes around it.
+    // Cube indices are packed into 21 bits each.
+    const int kMaxCells = 1 << 20;
+    double    cellSize  = std::max(maxDist, 1.e-6);
+    
+    for (size_t dim = 0; dim < 3; dim++) cellSize = std::max(cellSize, (maxPos[dim] - minPos[dim]) / (kMaxCells - 1));
+    
+    auto cellIndex = [&](double pos, size_t dim){return std::min(kMaxCells - 1, std::max(0, int((pos - minPos[dim]) / cellSize)));};
+    auto cellKey   = [](int x, int y, int z){return (uint64_t(x) << 42) | (uint64_t(y) << 21) | uint64_t(z);};
+    
+    // Sorting by cube gives each cube a contiguous range of hits, in list order
+    std::vector<std::pair<uint64_t,size_t>> keyedHits(sortedHits.size());
+    
+    for (size_t hitIdx = 0; hitIdx < sortedHits.size(); hitIdx++)
+        keyedHits[hitIdx] = std::make_pair(cellKey(cellIndex(positions[hitIdx][0], 0),
+                                                   cellIndex(positions[hitIdx][1], 1),
+                                                   cellIndex(positions[hitIdx][2], 2)), hitIdx);
+    
+    std::sort(keyedHits.begin(), keyedHits.end());
+    
+    std::unordered_map<uint64_t, std::pair<size_t,size_t>> cellToRange;
+    
+    for (size_t keyIdx = 0; keyIdx < keyedHits.size(); keyIdx++)
+    {
+        if (keyIdx == 0 || keyedHits[keyIdx].first != keyedHits[keyIdx - 1].first)
+            cellToRange[keyedHits[keyIdx].first] = std::make_pair(keyIdx, keyIdx);
+        
+        cellToRange[keyedHits[keyIdx].first].second++;
+    }
+    
+    if (m_enableMonitoring)
+    {
+        theClockGrid.stop();
+        theClockSearch.start();
+    }
+    
+    // A hit takes at most one neighbor per whole number of cm of distance, the last in the list,
+    // as the original map of neighbors was keyed by the truncated distance
+    const size_t        noHit = sortedHits.size();
+    std::vector<size_t> lastInBin(maxDist >= 0. ? size_t(maxDist) + 1 : 0, noHit);
+    
+    for (size_t hitIdxO = 0; hitIdxO < sortedHits.size() && maxDist >= 0.; hitIdxO++)
+    {
+        const std::array<double,3>& posO = positions[hitIdxO];
+        int                         cellX = cellIndex(posO[0], 0);
+        int                         cellY = cellIndex(posO[1], 1);
+        int                         cellZ = cellIndex(posO[2], 2);
+        
+        std::fill(lastInBin.begin(), lastInBin.end(), noHit);
+        
+        for (int x = std::max(0, cellX - 1); x <= std::min(kMaxCells - 1, cellX + 1); x++)
+        {
+            for (int y = std::max(0, cellY - 1); y <= std::min(kMaxCells - 1, cellY + 1); y++)
+            {
+                for (int z = std::max(0, cellZ - 1); z <= std::min(kMaxCells - 1, cellZ + 1); z++)
+                {
+                    auto cellItr = cellToRange.find(cellKey(x, y, z));
+                    
+                    if (cellItr == cellToRange.end()) continue;
+                    
+                    // Only the hits after this one in the list are paired with it
+                    auto firstItr = std::upper_bound(keyedHits.begin() + cellItr->second.first,
+                                                     keyedHits.begin() + cellItr->second.second,
+                                                     std::make_pair(cellItr->first, hitIdxO));
+                    
+                    for (auto keyItr = firstItr; keyItr != keyedHits.begin() + cellItr->second.second; keyItr++)
+                    {
+                        const std::array<double,3>& posI = positions[keyItr->second];
+                        
+                        double deltaX = posO[0] - posI[0];
+                        double deltaY = posO[1] - posI[1];
+                        double deltaZ = posO[2] - posI[2];
+                        double distSq = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+                        
+                        // The square root is only taken for hits near enough, to apply the cut and bin as before
+                        if (distSq > maxDistSq * (1. + 1.e-12)) continue;
+                        
+                        double distance = std::sqrt(distSq);
+                        
+                        if (distance > maxDist) continue;
+                        
+                        size_t& last = lastInBin[size_t(distance)];
+                        
+                        if (last == noHit || keyItr->second > last) last = keyItr->second;
+                    }
+                }
+            }
+        }
+        
+        for (size_t hitIdxI : lastInBin)
+        {
+            if (hitIdxI != noHit) laterNeighbors.push_back(hitIdxI);
+        }
+        
+        laterOffsets.push_back(laterNeighbors.size());
+    }
     
-    std::map<int, std::pair<double, const reco::ClusterHit3D*> > bestTripletMap;
+    laterOffsets.resize(sortedHits.size() + 1, laterNeighbors.size());
     
-    // Get the X,Y, and Z for this triplet
-    double pairO_X = hitPairO->getPosition()[0];
-    double pairO_Y = hitPairO->getPosition()[1];
-    double pairO_Z = hitPairO->getPosition()[2];
+    if (m_enableMonitoring)
+    {
+        theClockSearch.stop();
+        
+        m_timeVector[BUILDHITGRID]  = theClockGrid.accumulated_real_time();
+        m_timeVector[FINDNEIGHBORS] = theClockSearch.accumulated_real_time();
+    }
+}
 
+void DBScanAlg_DUNE35t::FindLaterNeighborsScan(const std::vector<const reco::ClusterHit3D*>& sortedHits,
+                                               std::vector<size_t>&                          laterOffsets,
+                                               std::vector<size_t>&                          laterNeighbors) const
+{
+    laterOffsets.assign(1, 0);
+    laterNeighbors.clear();
+    
     // Set maximums
     double maxDist = m_EpsMaxDist; //REL 4.0; //Was 2, then 4 REL
-
-    //Loop over second iterator
-    while (++pairItrI != hitPairList.end())
-      {
-	const reco::ClusterHit3D* hitPairI = (*pairItrI).get();
-
-	//OLD WAY
-	// Note that the hits have been sorted by z, then y and then in x
-	// Translation: hits are sorted by W wire, then in Y (increasing u, decreasing v)
-	// and then in time.
-	
-	//NEW WAY
-	// Hits have been sorted by Z position, then by Y, then by X (each in ascending order).
-	// There is no reference to wire number here, since we need to consider clustering
-	// across TPCs.
-	
-	// Get the X,Y, and Z for this triplet
-	double pairI_X = hitPairI->getPosition()[0];
-	double pairI_Y = hitPairI->getPosition()[1];
-	double pairI_Z = hitPairI->getPosition()[2];
-	
-	//Sorting allows us to break this loop after the maxDist is surpassed in z
-	if( pairI_Z - pairO_Z > maxDist ) break;
-
-	//Form the distance so we can check ranges
-	double distance = pow(
-			      pow(pairO_X-pairI_X,2) +
-			      pow(pairO_Y-pairI_Y,2) +
-			      pow(pairO_Z-pairI_Z,2),0.5);
-	
-	// If we have passed the 3d distance then we are done with the loop
-	if( distance > maxDist )continue;
-	
-	
-	// This is the tight constraint on the hits
-	if (consistentPairs(hitPairO, hitPairI))
-	  {
-	    double    bestBin = distance;
-	    double bestDist = 10000.;
+    
+    std::map<int, size_t> bestTripletMap;
+    
+    for (size_t hitIdxO = 0; hitIdxO < sortedHits.size(); hitIdxO++)
+    {
+        const reco::ClusterHit3D* hitPairO = sortedHits[hitIdxO];
+        
+        // Get the X,Y, and Z for this triplet
+        double pairO_X = hitPairO->getPosition()[0];
+        double pairO_Y = hitPairO->getPosition()[1];
+        double pairO_Z = hitPairO->getPosition()[2];
+        
+        bestTripletMap.clear();
+        
+        for (size_t hitIdxI = hitIdxO + 1; hitIdxI < sortedHits.size(); hitIdxI++)
+        {
+            const reco::ClusterHit3D* hitPairI = sortedHits[hitIdxI];
             
-	    if (bestTripletMap.find(bestBin) != bestTripletMap.end())  //Look at a given case of error (a given bin) and pull out the best (shortest) distance
-	      {
-		bestDist = bestTripletMap[bestBin].first;
-	      }
-	    
-	    double newDist = fabs(hitPairI->getX() - hitPairO->getX());
+            // Hits have been sorted by Z position, then by Y, then by X (each in ascending order).
+            // There is no reference to wire number here, since we need to consider clustering
+            // across TPCs.
+            double pairI_X = hitPairI->getPosition()[0];
+            double pairI_Y = hitPairI->getPosition()[1];
+            double pairI_Z = hitPairI->getPosition()[2];
             
-	    // This is an attempt to "prefer" triplets over pairs
-	    if (hitPairI->getHits().size() < 3) newDist += 25.;
+            //Sorting allows us to break this loop after the maxDist is surpassed in z
+            if( pairI_Z - pairO_Z > maxDist ) break;
             
-	    if (newDist < bestDist) bestTripletMap[bestBin] = std::pair<double, const reco::ClusterHit3D*>(newDist, hitPairI); //Select the pair of hits that is closest in time
+            //Form the distance so we can check ranges
+            double distance = pow(
+                                  pow(pairO_X-pairI_X,2) +
+                                  pow(pairO_Y-pairI_Y,2) +
+                                  pow(pairO_Z-pairI_Z,2),0.5);
             
-	  }
-	
-	bestTripletMap[distance] = std::pair<double,const reco::ClusterHit3D*>(distance,hitPairI);
-	
-      }
-    
-    for(const auto& bestMapItr : bestTripletMap)
-      {
-	const reco::ClusterHit3D* hitPairI(bestMapItr.second.second);
+            // If we have passed the 3d distance then we are done with the loop
+            if( distance > maxDist )continue;
+            
+            // Only one hit is kept per whole number of cm of distance, the last one
+            bestTripletMap[distance] = hitIdxI;
+        }
         
-	hitPairOPair.first.incrementCount();
-	hitPairOPair.second.emplace_back(hitPairI);
-	
-	epsPairNeighborhoodMapVec[hitPairI->getID()].second.first.incrementCount();
-	epsPairNeighborhoodMapVec[hitPairI->getID()].second.second.emplace_back(hitPairO);
+        for(const auto& bestMapItr : bestTripletMap) laterNeighbors.push_back(bestMapItr.second);
         
-	consistentPairsCnt++;
-      }
-  }
-  
-  mf::LogDebug("Cluster3D") << "Consistent pairs: " << consistentPairsCnt << " of " << pairsChecked << " checked." << std::endl;
-  
-  return consistentPairsCnt;
-  
+        laterOffsets.push_back(laterNeighbors.size());
+    }
 }
 
 
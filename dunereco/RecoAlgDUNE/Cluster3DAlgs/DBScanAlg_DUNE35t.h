@@ -114,6 +114,9 @@ public:
     enum TimeValues {BUILDTHREEDHITS  = 0,
                      BUILDHITTOHITMAP = 1,
                      RUNDBSCAN        = 2,
+                     BUILDHITGRID     = 3,   ///< Part of BUILDHITTOHITMAP: voxel grid of the hits
+                     FINDNEIGHBORS    = 4,   ///< Part of BUILDHITTOHITMAP: search for neighbors
+                     FILLNEIGHBORHOOD = 5,   ///< Part of BUILDHITTOHITMAP: filling the neighborhood arrays
                      NUMTIMEVALUES
     };
     
@@ -158,25 +161,52 @@ private:
      */
     bool consistentPairs(const reco::ClusterHit3D* pair1, const reco::ClusterHit3D* pair2) const;
     
-    typedef std::list<const reco::ClusterHit3D*>                           EpsPairNeighborhoodList;
-    typedef std::pair<DBScanParams, EpsPairNeighborhoodList >              EpsPairNeighborhoodPair;
-    typedef std::map<const reco::ClusterHit3D*, EpsPairNeighborhoodPair >  EpsPairNeighborhoodMap;
-    typedef std::pair<const reco::ClusterHit3D*, EpsPairNeighborhoodPair > EpsPairNeighborhoodMapPair;
-    typedef std::vector<EpsPairNeighborhoodMapPair >                       EpsPairNeighborhoodMapVec;
+    /**
+     *  @brief The epsilon neighborhoods of all 3D hits, indexed by hit ID and stored contiguously
+     */
+    struct EpsNeighborhood
+    {
+        std::vector<const reco::ClusterHit3D*> hits;      ///< Hit with a given ID, null if there is none
+        std::vector<DBScanParams>              params;    ///< DBScan state of each hit
+        std::vector<size_t>                    offsets;   ///< Neighbors of hit i are at [offsets[i], offsets[i+1])
+        std::vector<size_t>                    neighbors; ///< IDs of the neighbors
+    };
     
     /**
      *  @brief the main routine for DBScan
      */
-    void expandCluster(EpsPairNeighborhoodMapVec&          nMap,
-                       EpsPairNeighborhoodMapVec::iterator vecItr,
-                       reco::HitPairListPtr&               cluster,
-                       size_t                              minPts) const;
+    void expandCluster(EpsNeighborhood&      epsNeighborhood,
+                       size_t                hitID,
+                       reco::HitPairListPtr& cluster,
+                       size_t                minPts) const;
+    
+    /**
+     *  @brief DBScan with the core points found and joined in parallel, giving the same
+     *         clusters, numbered and ordered the same way, as the serial loop over expandCluster
+     */
+    void ParallelDBScan(EpsNeighborhood&         epsNeighborhood,
+                        reco::HitPairClusterMap& hitPairClusterMap) const;
     
     /**
      *  @brief Given an input HitPairList, build out the map of nearest neighbors
      */
     size_t BuildNeighborhoodMap(HitPairList& hitPairList,
-				EpsPairNeighborhoodMapVec& epsPairNeighborhoodMapVec )const;
+                                EpsNeighborhood& epsNeighborhood);
+    
+    /**
+     *  @brief For each hit of the z ordered list, the positions in the list of the later
+     *         hits it takes as neighbors, closest first, at [laterOffsets[i], laterOffsets[i+1])
+     */
+    void FindLaterNeighborsGrid(const std::vector<const reco::ClusterHit3D*>& sortedHits,
+                                std::vector<size_t>&                          laterOffsets,
+                                std::vector<size_t>&                          laterNeighbors);
+    
+    /**
+     *  @brief As above, but walking along the list in z as originally done
+     */
+    void FindLaterNeighborsScan(const std::vector<const reco::ClusterHit3D*>& sortedHits,
+                                std::vector<size_t>&                          laterOffsets,
+                                std::vector<size_t>&                          laterNeighbors) const;
 
     
     /** 
@@ -194,6 +224,8 @@ private:
     double                    m_timeAdvanceGap;
     double                    m_numSigmaPeakTime;
     double                    m_EpsMaxDist;
+    bool                      m_useNeighborhoodGrid;   ///< Find neighbors with a voxel grid rather than a scan in z
+    bool                      m_parallelDBScan;        ///< Run DBScan with a parallel union-find rather than serially
 
     bool                      m_enableMonitoring;      ///<
     int                       m_hits;                  ///<
@@ -34,10 +34,13 @@
 
 
 // std includes
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -90,64 +93,125 @@ void HoughSeedFinderAlg::reconfigure(fhicl::ParameterSet const &pset)
     m_maximumGap         = pset.get<double>("MaximumGap",             5.);
     m_displayHist        = pset.get<bool>  ("DisplayHoughHist",    false);
     
+    // Tabulate the angles of the theta bins once rather than for every hit
+    const double thetaBinSize(M_PI/double(m_thetaBins));
+    
+    m_cosTheta.resize(m_thetaBins);
+    m_sinTheta.resize(m_thetaBins);
+    
+    for(int thetaIdx = 0; thetaIdx < m_thetaBins; thetaIdx++)
+    {
+        double theta = thetaBinSize * double(thetaIdx);
+        
+        m_cosTheta[thetaIdx] = std::cos(theta);
+        m_sinTheta[thetaIdx] = std::sin(theta);
+    }
+    
     m_pcaAlg.reconfigure(pset.get<fhicl::ParameterSet>("PrincipalComponentsAlg"));
 }
     
-class AccumulatorValues
+class HoughSeedFinderAlg::HoughAccumulator
 {
     /**
-     *  @brief A utility class to contain the values of a given "bin" in Hough Space
+     *  @brief A dense accumulator for the rho-theta Hough space
      *
-     *         Specifically, this is keeping track of the projected x,y coordinates of a given
-     *         3D hit projected to the plane of largest spread in PCA and an interator to 
-     *         that hit in the input container
+     *         The bins are held in a single array, rho major, so that the linear bin index orders
+     *         the bins in the same way as (rho, theta) pairs. The 3D hits which contribute to each
+     *         bin are kept in one compact array with the hits of a given bin stored contiguously,
+     *         in input order, and located through a table of offsets.
      */
 public:
-    AccumulatorValues() : m_position(0.,0.,0.) {}
-    AccumulatorValues(const TVector3& position, const reco::HitPairListPtr::const_iterator& itr) :
-         m_position(position), m_hit3DIterator(itr) {}
-     
-    const TVector3&                      getPosition()    const {return m_position;}
-    reco::HitPairListPtr::const_iterator getHitIterator() const {return m_hit3DIterator;}
-     
-private:
-    TVector3                             m_position;       ///< We really only need the x,y coordinates here but keep all three for now
-    reco::HitPairListPtr::const_iterator m_hit3DIterator;  ///< This will be used to take us back to our 3D hit
-};
-     
-typedef std::vector<AccumulatorValues> AccumulatorValuesVec;
-     
-class HoughSeedFinderAlg::AccumulatorBin
-{
+    typedef std::vector<const reco::ClusterHit3D*>::const_iterator HitIterator;
+    
+    HoughAccumulator() : m_thetaBins(0), m_rhoMin(0), m_numBins(0) {}
+    
     /**
-     *  @brief A utility class used to accumulate the above values 
+     *  @brief Fill the accumulator, reusing any storage from a previous fill
      *
-     *         One of these objects will exist for each "bin" in rho-theta space and this will
-     *         be used to accumulate the 3D hits which contribute to this bin
+     *  @param hitVec    - the accepted 3D hits
+     *  @param rhoIdxVec - the rho index of each hit for each theta bin, hit major
+     *  @param thetaBins - number of theta bins
+     *  @param rhoMin    - smallest rho index in rhoIdxVec
+     *  @param rhoMax    - largest rho index in rhoIdxVec
      */
-public:
-    AccumulatorBin() : m_visited(false), m_noise(false), m_inCluster(false) {}
-    AccumulatorBin(AccumulatorValues& values) : m_visited(false), m_noise(false), m_inCluster(false)
+    void fill(const std::vector<const reco::ClusterHit3D*>& hitVec,
+              const std::vector<int>&                       rhoIdxVec,
+              int                                           thetaBins,
+              int                                           rhoMin,
+              int                                           rhoMax)
     {
-        m_accumulatorValuesVec.push_back(values);
+        m_thetaBins = thetaBins;
+        m_rhoMin    = rhoMin;
+        m_numBins   = hitVec.empty() ? 0 : size_t(rhoMax - rhoMin + 1) * size_t(thetaBins);
+        
+        // Count the entries of each bin, shifted by one so the prefix sum gives the offsets
+        m_offsets.assign(m_numBins + 1, 0);
+        
+        for(size_t hitIdx = 0; hitIdx < hitVec.size(); hitIdx++)
+        {
+            const int* rhoIdx = &rhoIdxVec[hitIdx * thetaBins];
+            
+            for(int thetaIdx = 0; thetaIdx < thetaBins; thetaIdx++)
+                m_offsets[size_t(rhoIdx[thetaIdx] - rhoMin) * thetaBins + thetaIdx + 1]++;
+        }
+        
+        for(size_t bin = 0; bin < m_numBins; bin++) m_offsets[bin + 1] += m_offsets[bin];
+        
+        // Now drop the hits into their bins
+        std::vector<size_t> nextSlot(m_offsets.begin(), m_offsets.end() - 1);
+        
+        m_hits.resize(m_offsets.back());
+        
+        for(size_t hitIdx = 0; hitIdx < hitVec.size(); hitIdx++)
+        {
+            const int* rhoIdx = &rhoIdxVec[hitIdx * thetaBins];
+            
+            for(int thetaIdx = 0; thetaIdx < thetaBins; thetaIdx++)
+                m_hits[nextSlot[size_t(rhoIdx[thetaIdx] - rhoMin) * thetaBins + thetaIdx]++] = hitVec[hitIdx];
+        }
+        
+        m_status.assign(m_numBins, 0);
     }
-     
-    void setVisited()   {m_visited   = true;}
-    void setNoise()     {m_noise     = true;}
-    void setInCluster() {m_inCluster = true;}
-     
-    void addAccumulatorValue(AccumulatorValues& value) {m_accumulatorValuesVec.push_back(value);}
-     
-    bool isVisited()   const {return m_visited;}
-    bool isNoise()     const {return m_noise;}
-    bool isInCluster() const {return m_inCluster;}
-     
-    const AccumulatorValuesVec& getAccumulatorValues() const {return m_accumulatorValuesVec;}
+    
+    size_t getNumBins()                   const {return m_numBins;}
+    size_t getCount(BinIndex bin)         const {return m_offsets[bin + 1] - m_offsets[bin];}
+    int    getRhoIdx(BinIndex bin)        const {return m_rhoMin + int(bin / m_thetaBins);}
+    int    getThetaIdx(BinIndex bin)      const {return int(bin % m_thetaBins);}
+    
+    /**
+     *  @brief Look up the bin at (rhoIdx, thetaIdx), returns false if the bin has no entries
+     */
+    bool findBin(int rhoIdx, int thetaIdx, BinIndex& bin) const
+    {
+        if (rhoIdx < m_rhoMin || m_numBins == 0) return false;
+        
+        bin = size_t(rhoIdx - m_rhoMin) * m_thetaBins + thetaIdx;
+        
+        return bin < m_numBins && getCount(bin) > 0;
+    }
+    
+    std::pair<HitIterator, HitIterator> getHits(BinIndex bin) const
+    {
+        return std::make_pair(m_hits.begin() + m_offsets[bin], m_hits.begin() + m_offsets[bin + 1]);
+    }
+    
+    void setVisited(BinIndex bin)         {m_status[bin] |= VISITED;}
+    void setNoise(BinIndex bin)           {m_status[bin] |= NOISE;}
+    void setInCluster(BinIndex bin)       {m_status[bin] |= INCLUSTER;}
+    
+    bool isVisited(BinIndex bin)    const {return m_status[bin] & VISITED;}
+    bool isNoise(BinIndex bin)      const {return m_status[bin] & NOISE;}
+    bool isInCluster(BinIndex bin)  const {return m_status[bin] & INCLUSTER;}
+    
 private:
-    bool                 m_visited;
-    bool                 m_noise;
-    bool                 m_inCluster;
-    AccumulatorValuesVec m_accumulatorValuesVec;
+    enum StatusBits {VISITED = 0x1, NOISE = 0x2, INCLUSTER = 0x4};
+    
+    int                                    m_thetaBins;
+    int                                    m_rhoMin;    ///< rho index of the first row of bins
+    size_t                                 m_numBins;
+    std::vector<size_t>                    m_offsets;   ///< Start of the hits of each bin in m_hits
+    std::vector<const reco::ClusterHit3D*> m_hits;      ///< The hits of all bins, bin by bin
+    std::vector<unsigned char>             m_status;    ///< Visited/noise/in cluster status of each bin
 };
 
 class HoughSeedFinderAlg::SortHoughClusterList
@@ -156,7 +220,7 @@ class HoughSeedFinderAlg::SortHoughClusterList
      * @brief This is used to sort "Hough Clusters" by the maximum entries in a bin
      */
 public:
-    SortHoughClusterList(HoughSeedFinderAlg::RhoThetaAccumulatorBinMap& accMap) : m_accMap(accMap) {}
+    SortHoughClusterList(const HoughSeedFinderAlg::HoughAccumulator& accumulator) : m_accumulator(accumulator) {}
      
     bool operator()(const HoughSeedFinderAlg::HoughCluster& left, const HoughSeedFinderAlg::HoughCluster& right)
     {
@@ -164,47 +228,35 @@ public:
         size_t peakCountRight(0);
      
         for(const auto& binIndex : left)
-            peakCountLeft = std::max(peakCountLeft, m_accMap[binIndex].getAccumulatorValues().size());
+            peakCountLeft = std::max(peakCountLeft, m_accumulator.getCount(binIndex));
         for(const auto& binIndex : right)
-            peakCountRight = std::max(peakCountRight, m_accMap[binIndex].getAccumulatorValues().size());
+            peakCountRight = std::max(peakCountRight, m_accumulator.getCount(binIndex));
      
         return peakCountLeft > peakCountRight;
     }
 private:
-    HoughSeedFinderAlg::RhoThetaAccumulatorBinMap& m_accMap;
+    const HoughSeedFinderAlg::HoughAccumulator& m_accumulator;
 };
     
-struct HoughSeedFinderAlg::SortBinIndexList
-{
-    /**
-     *  @brief This is used to sort bins in Hough Space
-     */
-    bool operator()(const HoughSeedFinderAlg::RhoThetaAccumulatorBinMap::iterator& left, const HoughSeedFinderAlg::RhoThetaAccumulatorBinMap::iterator& right)
-    {
-        size_t leftSize  = left->second.getAccumulatorValues().size();
-        size_t rightSize = right->second.getAccumulatorValues().size();
-     
-        return  leftSize > rightSize;
-    }
-};
-     
-    
-void HoughSeedFinderAlg::HoughRegionQuery(BinIndex&                  curBin,
-                                          RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap,
-                                          HoughCluster&              neighborPts,
-                                          size_t                     threshold) const
+void HoughSeedFinderAlg::HoughRegionQuery(BinIndex                curBin,
+                                          const HoughAccumulator& accumulator,
+                                          HoughCluster&           neighborPts,
+                                          size_t                  threshold) const
 {
     /**
      *   @brief Does a query of nearest neighbors to look for matching bins
      */
     
+    int curRhoIdx   = accumulator.getRhoIdx(curBin);
+    int curThetaIdx = accumulator.getThetaIdx(curBin);
+    
     // We simply loop over the nearest indices and see if we have any friends over threshold
-    for(int rhoIdx = curBin.first - 1; rhoIdx <= curBin.first + 1; rhoIdx++)
+    for(int rhoIdx = curRhoIdx - 1; rhoIdx <= curRhoIdx + 1; rhoIdx++)
     {
-        for(int jdx = curBin.second - 1; jdx <= curBin.second + 1; jdx++)
+        for(int jdx = curThetaIdx - 1; jdx <= curThetaIdx + 1; jdx++)
         {
             // Skip the self reference
-            if (rhoIdx == curBin.first && jdx == curBin.second) continue;
+            if (rhoIdx == curRhoIdx && jdx == curThetaIdx) continue;
             
             // Theta bin needs to handle the wrap.
             int thetaIdx(jdx);
@@ -212,12 +264,11 @@ void HoughSeedFinderAlg::HoughRegionQuery(BinIndex&                  curBin,
             if      (thetaIdx < 0)             thetaIdx = m_thetaBins - 1;
             else if (thetaIdx > m_thetaBins -1) thetaIdx = 0;
             
-            BinIndex                            binIndex(rhoIdx,thetaIdx);
-            RhoThetaAccumulatorBinMap::iterator mapItr = rhoThetaAccumulatorBinMap.find(binIndex);
+            BinIndex binIndex;
             
-            if (mapItr != rhoThetaAccumulatorBinMap.end())
+            if (accumulator.findBin(rhoIdx, thetaIdx, binIndex))
             {
-                if (mapItr->second.getAccumulatorValues().size() >= threshold) neighborPts.push_back(binIndex);
+                if (accumulator.getCount(binIndex) >= threshold) neighborPts.push_back(binIndex);
             }
         }
     }
@@ -225,10 +276,10 @@ void HoughSeedFinderAlg::HoughRegionQuery(BinIndex&                  curBin,
     return;
 }
     
-void HoughSeedFinderAlg::expandHoughCluster(BinIndex&                  curBin,
+void HoughSeedFinderAlg::expandHoughCluster(BinIndex                   curBin,
                                             HoughCluster&              neighborPts,
                                             HoughCluster&              houghCluster,
-                                            RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap,
+                                            HoughAccumulator&          accumulator,
                                             size_t                     threshold) const
 {
     /** 
@@ -238,31 +289,22 @@ void HoughSeedFinderAlg::expandHoughCluster(BinIndex&                  curBin,
     // Start by adding the input point to our Hough Cluster
     houghCluster.push_back(curBin);
     
-    for(auto& binIndex : neighborPts)
+    // Note that the neighborhood grows as we go so index rather than iterate
+    for(size_t neighborIdx = 0; neighborIdx < neighborPts.size(); neighborIdx++)
     {
-        AccumulatorBin& accBin = rhoThetaAccumulatorBinMap[binIndex];
+        BinIndex binIndex = neighborPts[neighborIdx];
         
-        if (!accBin.isVisited())
+        if (!accumulator.isVisited(binIndex))
         {
-            accBin.setVisited();
-            
-            HoughCluster nextNeighborPts;
-            
-            HoughRegionQuery(binIndex, rhoThetaAccumulatorBinMap, nextNeighborPts, threshold);
+            accumulator.setVisited(binIndex);
             
-            if(!nextNeighborPts.empty())
-            {
-                for(auto& neighborIdx : nextNeighborPts)
-                {
-                    neighborPts.push_back(neighborIdx);
-                }
-            }
+            HoughRegionQuery(binIndex, accumulator, neighborPts, threshold);
         }
         
-        if (!accBin.isInCluster())
+        if (!accumulator.isInCluster(binIndex))
         {
             houghCluster.push_back(binIndex);
-            accBin.setInCluster();
+            accumulator.setInCluster(binIndex);
         }
     }
     
@@ -374,7 +416,7 @@ void HoughSeedFinderAlg::findHitGaps(reco::HitPairListPtr&      inputHitList,
 void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairListPtr,
                                            reco::PrincipalComponents&  pca,
                                            int&                        nLoops,
-                                           RhoThetaAccumulatorBinMap&  rhoThetaAccumulatorBinMap,
+                                           HoughAccumulator&           accumulator,
                                            HoughClusterList&           houghClusters) const
 {
     // The goal of this function is to do a basic Hough Transform on the input list of 3D hits.
@@ -387,8 +429,6 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
     //
     // Define some constants
     static int   histCount(0);
-    const double maxTheta(M_PI);                               // Obviously, 180 degrees
-    const double thetaBinSize(maxTheta/double(m_thetaBins));    // around 4 degrees (45 bins)
     const double rhoBinSizeMin(m_geometry->WirePitch());       // Wire spacing gives a natural bin size?
     
     // Recover the parameters from the Principal Components Analysis that we need to project and accumulate
@@ -407,55 +447,56 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
     // Part I: Accumulate values in the rho-theta map
     // **********************************************************************
     
-    size_t maxBinCount(0);
-    int    nAccepted3DHits(0);
+    std::vector<const reco::ClusterHit3D*> acceptedHitVec;
+    std::vector<int>                       rhoIdxVec;
+    
+    acceptedHitVec.reserve(hitPairListPtr.size());
+    rhoIdxVec.reserve(hitPairListPtr.size() * m_thetaBins);
     
-    // Commence looping over the input 3D hits and fill our accumulator bins
-    for(reco::HitPairListPtr::const_iterator hit3DItr  = hitPairListPtr.begin();
-                                             hit3DItr != hitPairListPtr.end();
-                                             hit3DItr++)
+    int rhoIdxMin(0);
+    int rhoIdxMax(0);
+    
+    // Commence looping over the input 3D hits and compute the rho index for each theta bin
+    for(const auto& hit3D : hitPairListPtr)
     {
-        // Recover the hit
-        const reco::ClusterHit3D* hit3D(*hit3DItr);
-        
         // Skip hits which are not skeleton points
         if (!(hit3D->getStatusBits() & 0x10000000)) continue;
         
-        nAccepted3DHits++;
-        
         TVector3 hit3DPosition(hit3D->getPosition()[0], hit3D->getPosition()[1], hit3D->getPosition()[2]);
         TVector3 pcaToHitVec = hit3DPosition - pcaCenter;
-        TVector3 pcaToHitPlaneVec(pcaToHitVec.Dot(planeVec0), pcaToHitVec.Dot(planeVec1), 0.);
         
-        double   xPcaToHit = pcaToHitPlaneVec[0];
-        double   yPcaToHit = pcaToHitPlaneVec[1];
+        double   xPcaToHit = pcaToHitVec.Dot(planeVec0);
+        double   yPcaToHit = pcaToHitVec.Dot(planeVec1);
         
-        // Create an accumulator value
-        AccumulatorValues accValue(pcaToHitPlaneVec, hit3DItr);
+        acceptedHitVec.push_back(hit3D);
+        rhoIdxVec.resize(rhoIdxVec.size() + m_thetaBins);
         
-        // Commence loop over theta to fill accumulator bins
-        // Note that with theta in the range 0-pi then we can have negative values for rho
+        const double* cosTheta = m_cosTheta.data();
+        const double* sinTheta = m_sinTheta.data();
+        int*          rhoIdx   = &rhoIdxVec[rhoIdxVec.size() - m_thetaBins];
+        
+        // Loop over theta, note that with theta in the range 0-pi then we can have negative values for rho.
+        // The rounding is written out (half away from zero, as std::round) so that the compiler can vectorize it
         for(int thetaIdx  = 0; thetaIdx < m_thetaBins; thetaIdx++)
         {
-            // We need to convert our theta index to an angle
-            double theta  = thetaBinSize * double(thetaIdx);
-            
-            // calculate rho for this angle
-            double rho    = xPcaToHit * std::cos(theta) + yPcaToHit * std::sin(theta);
-            
-            // Get the rho index
-            int    rhoIdx = std::round(rho / rhoBinSize);
+            double rho      = xPcaToHit * cosTheta[thetaIdx] + yPcaToHit * sinTheta[thetaIdx];
+            double rhoBins  = rho / rhoBinSize;
+            int    absIdx   = int(std::fabs(rhoBins) + 0.49999999999999994);
             
-            // Accumulate
-            BinIndex binIndex(rhoIdx, thetaIdx);
-            
-            rhoThetaAccumulatorBinMap[binIndex].addAccumulatorValue(accValue);
-            
-            if (rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues().size() > maxBinCount)
-                maxBinCount = rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues().size();
+            rhoIdx[thetaIdx] = rhoBins < 0. ? -absIdx : absIdx;
         }
+        
+        const auto minMax = std::minmax_element(rhoIdx, rhoIdx + m_thetaBins);
+        
+        if (acceptedHitVec.size() == 1 || *minMax.first  < rhoIdxMin) rhoIdxMin = *minMax.first;
+        if (acceptedHitVec.size() == 1 || *minMax.second > rhoIdxMax) rhoIdxMax = *minMax.second;
     }
     
+    int nAccepted3DHits(acceptedHitVec.size());
+    
+    // Now accumulate
+    accumulator.fill(acceptedHitVec, rhoIdxVec, m_thetaBins, rhoIdxMin, rhoIdxMax);
+    
     // Accumulation done, if asked now display the hist
     if (m_displayHist)
     {
@@ -484,9 +525,11 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
         
         TH2D* houghHist = new TH2D("HoughHist", "Hough Space", 2*m_rhoBins, -m_rhoBins+0.5, m_rhoBins+0.5, m_thetaBins, 0., m_thetaBins);
         
-        for(const auto& rhoThetaMap : rhoThetaAccumulatorBinMap)
+        for(BinIndex binIndex = 0; binIndex < accumulator.getNumBins(); binIndex++)
         {
-            houghHist->Fill(rhoThetaMap.first.first, rhoThetaMap.first.second+0.5, rhoThetaMap.second.getAccumulatorValues().size());
+            if (!accumulator.getCount(binIndex)) continue;
+            
+            houghHist->Fill(accumulator.getRhoIdx(binIndex), accumulator.getThetaIdx(binIndex)+0.5, accumulator.getCount(binIndex));
         }
         
         houghHist->SetBit(kCanDelete);
@@ -499,52 +542,51 @@ void HoughSeedFinderAlg::findHoughClusters(const reco::HitPairListPtr& hitPairLi
     // **********************************************************************
     
     size_t thresholdLo = std::max(size_t(m_hiThresholdFrac*nAccepted3DHits), m_hiThresholdMin);
-    size_t thresholdHi = m_loThresholdFrac * maxBinCount;
+    size_t thresholdHi(0);
     
-    std::list<RhoThetaAccumulatorBinMap::iterator> binIndexList;
+    // Order the occupied bins by decreasing count, equal counts stay in (rho, theta) order
+    std::vector<BinIndex> binIndexVec;
     
-    for(RhoThetaAccumulatorBinMap::iterator mapItr  = rhoThetaAccumulatorBinMap.begin();
-        mapItr != rhoThetaAccumulatorBinMap.end();
-        mapItr++)
-        binIndexList.push_back(mapItr);
+    for(BinIndex binIndex = 0; binIndex < accumulator.getNumBins(); binIndex++)
+        if (accumulator.getCount(binIndex)) binIndexVec.push_back(binIndex);
     
-    binIndexList.sort(SortBinIndexList());
+    std::stable_sort(binIndexVec.begin(), binIndexVec.end(),
+                     [&accumulator](BinIndex left, BinIndex right){return accumulator.getCount(left) > accumulator.getCount(right);});
     
-    for(auto& mapItr : binIndexList)
+    for(const auto& binIndex : binIndexVec)
     {
         // If we have been here before we skip
-        //if (mapItr.second.isVisited()) continue;
-        if (mapItr->second.isInCluster()) continue;
+        //if (accumulator.isVisited(binIndex)) continue;
+        if (accumulator.isInCluster(binIndex)) continue;
         
         // Mark this bin as visited
         // Actually, don't mark it since we are double thresholding and don't want it missed
-        //mapItr.second.setVisited();
+        //accumulator.setVisited(binIndex);
         
         // Make sure over threshold
-        if (mapItr->second.getAccumulatorValues().size() < thresholdLo)
+        if (accumulator.getCount(binIndex) < thresholdLo)
         {
-            mapItr->second.setNoise();
+            accumulator.setNoise(binIndex);
             continue;
         }
         
         // Set the low threshold to make sure we merge bins that might be either side of a boundary trajectory
-        thresholdHi = std::max(size_t(m_loThresholdFrac * mapItr->second.getAccumulatorValues().size()), m_hiThresholdMin);
+        thresholdHi = std::max(size_t(m_loThresholdFrac * accumulator.getCount(binIndex)), m_hiThresholdMin);
         
         // Recover our neighborhood
         HoughCluster neighborhood;
-        BinIndex     curBin(mapItr->first);
         
-        HoughRegionQuery(curBin, rhoThetaAccumulatorBinMap, neighborhood, thresholdHi);
+        HoughRegionQuery(binIndex, accumulator, neighborhood, thresholdHi);
         
         houghClusters.push_back(HoughCluster());
         
         HoughCluster& houghCluster = houghClusters.back();
         
-        expandHoughCluster(curBin, neighborhood, houghCluster, rhoThetaAccumulatorBinMap, thresholdHi);
+        expandHoughCluster(binIndex, neighborhood, houghCluster, accumulator, thresholdHi);
     }
     
     // Sort the clusters using the SortHoughClusterList metric
-    if (!houghClusters.empty()) houghClusters.sort(SortHoughClusterList(rhoThetaAccumulatorBinMap));
+    if (!houghClusters.empty()) houghClusters.sort(SortHoughClusterList(accumulator));
     
     return;
 }
@@ -697,6 +739,9 @@ bool HoughSeedFinderAlg::findTrackSeeds(reco::HitPairListPtr&      inputHitPairL
     // Make a local copy of the input PCA
     reco::PrincipalComponents pca = inputPCA;
     
+    // The Hough space accumulator, kept outside the loop so its storage is reused
+    HoughAccumulator accumulator;
+    
     // We loop over hits in our list until there are no more
     while(!hitPairListPtr.empty())
     {
@@ -709,10 +754,9 @@ bool HoughSeedFinderAlg::findTrackSeeds(reco::HitPairListPtr&      inputHitPairL
             // **********************************************************************
             // Part I: Build Hough space and find Hough clusters
             // **********************************************************************
-            RhoThetaAccumulatorBinMap rhoThetaAccumulatorBinMap;
             HoughClusterList          houghClusters;
             
-            findHoughClusters(hitPairListPtr, pca, nLoops, rhoThetaAccumulatorBinMap, houghClusters);
+            findHoughClusters(hitPairListPtr, pca, nLoops, accumulator, houghClusters);
             
             // If no clusters then done
             if (houghClusters.empty()) break;
@@ -745,12 +789,9 @@ bool HoughSeedFinderAlg::findTrackSeeds(reco::HitPairListPtr&      inputHitPairL
                     std::set<const reco::ClusterHit3D*> tempHitPtrList;
                     
                     // Recover the hits associated to this cluster
-                    for(auto& hitItr : rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues())
-                    {
-                        reco::HitPairListPtr::const_iterator hit3DItr = hitItr.getHitIterator();
-                        
-                        tempHitPtrList.insert(*hit3DItr);
-                    }
+                    std::pair<HoughAccumulator::HitIterator, HoughAccumulator::HitIterator> hitRange = accumulator.getHits(binIndex);
+                    
+                    tempHitPtrList.insert(hitRange.first, hitRange.second);
                     
                     // count hits before we remove any
                     totalHits += tempHitPtrList.size();
@@ -893,10 +934,10 @@ bool HoughSeedFinderAlg::findTrackHits(reco::HitPairListPtr&      inputHitPairLi
         // **********************************************************************
         // Part I: Build Hough space and find Hough clusters
         // **********************************************************************
-        RhoThetaAccumulatorBinMap rhoThetaAccumulatorBinMap;
+        HoughAccumulator          accumulator;
         HoughClusterList          houghClusters;
         
-        findHoughClusters(hitPairListPtr, pca, nLoops, rhoThetaAccumulatorBinMap, houghClusters);
+        findHoughClusters(hitPairListPtr, pca, nLoops, accumulator, houghClusters);
         
         // **********************************************************************
         // Part II: Go through the clusters to find the peak bins
@@ -926,12 +967,9 @@ bool HoughSeedFinderAlg::findTrackHits(reco::HitPairListPtr&      inputHitPairLi
                 std::set<const reco::ClusterHit3D*> tempHitPtrList;
                 
                 // Recover the hits associated to this cluster
-                for(auto& hitItr : rhoThetaAccumulatorBinMap[binIndex].getAccumulatorValues())
-                {
-                    reco::HitPairListPtr::const_iterator hit3DItr = hitItr.getHitIterator();
-                    
-                    tempHitPtrList.insert(*hit3DItr);
-                }
+                std::pair<HoughAccumulator::HitIterator, HoughAccumulator::HitIterator> hitRange = accumulator.getHits(binIndex);
+                
+                tempHitPtrList.insert(hitRange.first, hitRange.second);
                 
                 // count hits before we remove any
                 totalHits += tempHitPtrList.size();
@@ -77,29 +77,27 @@ private:
      *  @brief Forward declaration of some of the objects necessary for hough transform
      */
 
-    class  AccumulatorBin;
+    class  HoughAccumulator;
     class  SortHoughClusterList;
-    struct SortBinIndexList;
     
-    // Basic structure for holding our accumlator bins (to avoid a full array)
-    // structure will be rho bin for first key, theta bin for second key
-    typedef std::pair<int, int>                BinIndex;
-    typedef std::map<BinIndex, AccumulatorBin> RhoThetaAccumulatorBinMap;
-    typedef std::list<BinIndex>                HoughCluster;
+    // Bins of the rho-theta accumulator are referred to by their linear index in the dense
+    // accumulator array, which runs over theta bins fastest
+    typedef size_t                             BinIndex;
+    typedef std::vector<BinIndex>              HoughCluster;
     typedef std::list<HoughCluster >           HoughClusterList;
     
-    void HoughRegionQuery(BinIndex& curBin, RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap, HoughCluster& neighborPts, size_t threshold) const;
+    void HoughRegionQuery(BinIndex curBin, const HoughAccumulator& accumulator, HoughCluster& neighborPts, size_t threshold) const;
     
-    void expandHoughCluster(BinIndex&                  curBin,
+    void expandHoughCluster(BinIndex                   curBin,
                             HoughCluster&              neighborPts,
                             HoughCluster&              houghCluster,
-                            RhoThetaAccumulatorBinMap& rhoThetaAccumulatorBinMap,
+                            HoughAccumulator&          accumulator,
                             size_t                     threshold) const;
     
     void findHoughClusters(const reco::HitPairListPtr& inputHits,
                            reco::PrincipalComponents&  pca,
                            int&                        nLoops,
-                           RhoThetaAccumulatorBinMap&  rhoThetaMap,
+                           HoughAccumulator&           accumulator,
                            HoughClusterList&           clusterList) const;
     
     /**
@@ -120,6 +118,8 @@ private:
     int                                            m_numSkippedHits;     ///<
     int                                            m_maxLoopsPerCluster; ///<
     double                                         m_maximumGap;         ///<
+    std::vector<double>                            m_cosTheta;           ///< cos(theta) for each theta bin
+    std::vector<double>                            m_sinTheta;           ///< sin(theta) for each theta bin
 
     geo::Geometry*                                 m_geometry;           // pointer to the Geometry service
     //    const detinfo::DetectorProperties*            m_detector;           // Pointer to the detector properties
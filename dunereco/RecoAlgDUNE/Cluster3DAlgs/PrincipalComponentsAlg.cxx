@@ -28,6 +28,8 @@
 #include "TDecompSVD.h"
 
 // std includes
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <functional>
 #include <iostream>
@@ -53,7 +55,8 @@ void PrincipalComponentsAlg::reconfigure(fhicl::ParameterSet const &pset)
 {
     art::ServiceHandle<geo::Geometry>            geometry;
     
-    m_parallel = pset.get<double>("ParallelLines", 0.00001);
+    m_parallel      = pset.get<double>("ParallelLines", 0.00001);
+    m_useTDecompSVD = pset.get<bool>  ("UseTDecompSVD",   false);
     m_geometry = &*geometry;
 }
     
@@ -222,75 +225,87 @@ void PrincipalComponentsAlg::PCAAnalysis(const reco::HitPairListPtr& hitPairVect
     return;
 }
     
-void PrincipalComponentsAlg::PCAAnalysis_3D(const reco::HitPairListPtr& hitPairVector, reco::PrincipalComponents& pca, bool skeletonOnly) const
+namespace
 {
-    // We want to run a PCA on the input TkrVecPoints...
-    // The steps are:
-    // 1) do a mean normalization of the input vec points
-    // 2) compute the covariance matrix
-    // 3) run the SVD
-    // 4) extract the eigen vectors and values
-    // see what happens
-    
-    // Run through the HitPairList and get the mean position of all the hits
-    double meanPos[] = {0.,0.,0.};
-    int    numPairsInt(0);
-    
-    for (const auto& hit : hitPairVector)
+    /**
+     *  @brief Single pass (Welford) accumulation of the mean position and the sums of the products
+     *         of the deviations from the mean, which is stable even far from the origin
+     */
+    class MomentAccumulator
     {
-        if (skeletonOnly && !((hit->getStatusBits() & 0x10000000) == 0x10000000)) continue;
+    public:
+        MomentAccumulator() : m_count(0), m_mean{0.,0.,0.}, m_sums{0.,0.,0.,0.,0.,0.} {}
         
-        meanPos[0] += hit->getPosition()[0];
-        meanPos[1] += hit->getPosition()[1];
-        meanPos[2] += hit->getPosition()[2];
-        numPairsInt++;
-    }
-    
-    double numPairs = double(numPairsInt);
-    
-    meanPos[0] /= numPairs;
-    meanPos[1] /= numPairs;
-    meanPos[2] /= numPairs;
-    
-    // Define elements of our covariance matrix
-    double xi2  = 0.;
-    double xiyi = 0.;
-    double xizi = 0.;
-    double yi2  = 0.;
-    double yizi = 0.;
-    double zi2  = 0.;
-    
-    // Back through the hits to build the matrix
-    for (const auto& hit : hitPairVector)
-    {
-        if (skeletonOnly && !((hit->getStatusBits() & 0x10000000) == 0x10000000)) continue;
+        void add(double x, double y, double z)
+        {
+            m_count++;
+            
+            double dx = x - m_mean[0];
+            double dy = y - m_mean[1];
+            double dz = z - m_mean[2];
+            double scl = 1. / double(m_count);
+            
+            m_mean[0] += dx * scl;
+            m_mean[1] += dy * scl;
+            m_mean[2] += dz * scl;
+            
+            // Deviations from the old and the new mean
+            double ex = x - m_mean[0];
+            double ey = y - m_mean[1];
+            double ez = z - m_mean[2];
+            
+            m_sums[0] += dx * ex;
+            m_sums[1] += dx * ey;
+            m_sums[2] += dx * ez;
+            m_sums[3] += dy * ey;
+            m_sums[4] += dy * ez;
+            m_sums[5] += dz * ez;
+        }
+        
+        int           getCount() const {return m_count;}
+        const double* getMean()  const {return m_mean;}
         
-        double x = hit->getPosition()[0] - meanPos[0];
-        double y = hit->getPosition()[1] - meanPos[1];
-        double z = hit->getPosition()[2] - meanPos[2];
+        /**
+         *  @brief The covariance matrix about the given center, scaled by 1/(n-1)
+         */
+        void getCovariance(const double center[3], double covariance[3][3]) const
+        {
+            // Shift the sums from the mean to the requested center
+            double dx  = m_mean[0] - center[0];
+            double dy  = m_mean[1] - center[1];
+            double dz  = m_mean[2] - center[2];
+            double n   = double(m_count);
+            double scl = 1. / (n - 1.);
+            
+            covariance[0][0] =                    (m_sums[0] + n * dx * dx) * scl;
+            covariance[0][1] = covariance[1][0] = (m_sums[1] + n * dx * dy) * scl;
+            covariance[0][2] = covariance[2][0] = (m_sums[2] + n * dx * dz) * scl;
+            covariance[1][1] =                    (m_sums[3] + n * dy * dy) * scl;
+            covariance[1][2] = covariance[2][1] = (m_sums[4] + n * dy * dz) * scl;
+            covariance[2][2] =                    (m_sums[5] + n * dz * dz) * scl;
+        }
         
-        xi2  += x * x;
-        xiyi += x * y;
-        xizi += x * z;
-        yi2  += y * y;
-        yizi += y * z;
-        zi2  += z * z;
+    private:
+        int    m_count;
+        double m_mean[3];
+        double m_sums[6];   ///< xx, xy, xz, yy, yz, zz
+    };
+    
+    reco::PrincipalComponents::EigenVectors MakeEigenVectors(const double eigenVecs[3][3])
+    {
+        return reco::PrincipalComponents::EigenVectors{{eigenVecs[0][0], eigenVecs[0][1], eigenVecs[0][2]},
+                                                       {eigenVecs[1][0], eigenVecs[1][1], eigenVecs[1][2]},
+                                                       {eigenVecs[2][0], eigenVecs[2][1], eigenVecs[2][2]}};
     }
+}
     
-    // Create the actual matrix
+bool PrincipalComponentsAlg::svdEigen3x3(const double covariance[3][3], double eigenVals[3], double eigenVecs[3][3])
+{
     TMatrixD sigma(3, 3);
     
-    sigma(0,0) = xi2;
-    sigma(0,1) = sigma(1,0) = xiyi;
-    sigma(0,2) = sigma(2,0) = xizi;
-    sigma(1,1) = yi2;
-    sigma(1,2) = sigma(2,1) = yizi;
-    sigma(2,2) = zi2;
-    
-    // Scale by number of pairs
-    sigma *= (1./(numPairs - 1.));
+    for(int row = 0; row < 3; row++)
+        for(int col = 0; col < 3; col++) sigma(row, col) = covariance[row][col];
     
-    // Set up the SVD
     TDecompSVD rootSVD(sigma);
     
     // run the decomposition
@@ -303,69 +318,207 @@ void PrincipalComponentsAlg::PCAAnalysis_3D(const reco::HitPairListPtr& hitPairV
     catch(...)
     {
         svdOk = false;
-        mf::LogDebug("Cluster3D") << "PCA decompose failure, numPairs = " << numPairs << std::endl;
     }
     
     if (svdOk)
     {
-        // Extract results
-        TVectorD eigenVals = rootSVD.GetSig();
-        TMatrixD eigenVecs = rootSVD.GetU();
-        
-        // Get the eigen values
-        double recobEigenVals[] = {eigenVals[0], eigenVals[1], eigenVals[2]};
-        
-        // Grab the principle axes
-        reco::PrincipalComponents::EigenVectors recobEigenVecs;
-        std::vector<double> tempVec;
-        
-        // Get the first column vector
-        tempVec.push_back(eigenVecs(0, 0));
-        tempVec.push_back(eigenVecs(1, 0));
-        tempVec.push_back(eigenVecs(2, 0));
-        recobEigenVecs.push_back(tempVec);
-        
-        // Now the second
-        tempVec.clear();
-        tempVec.push_back(eigenVecs(0, 1));
-        tempVec.push_back(eigenVecs(1, 1));
-        tempVec.push_back(eigenVecs(2, 1));
-        recobEigenVecs.push_back(tempVec);
-        
-        // And the last
-        tempVec.clear();
-        tempVec.push_back(eigenVecs(0, 2));
-        tempVec.push_back(eigenVecs(1, 2));
-        tempVec.push_back(eigenVecs(2, 2));
-        recobEigenVecs.push_back(tempVec);
+        // Extract results, the eigen vectors are the columns of U
+        const TVectorD& sigVals = rootSVD.GetSig();
+        const TMatrixD& uMatrix = rootSVD.GetU();
+        
+        for(int idx = 0; idx < 3; idx++)
+        {
+            eigenVals[idx] = sigVals[idx];
+            
+            for(int k = 0; k < 3; k++) eigenVecs[idx][k] = uMatrix(k, idx);
+        }
+        
+        canonicalEigenSigns(eigenVecs);
+    }
+    
+    return svdOk;
+}
+    
+bool PrincipalComponentsAlg::jacobiEigen3x3(const double covariance[3][3], double eigenVals[3], double eigenVecs[3][3])
+{
+    double a[3][3];
+    double v[3][3] = {{1.,0.,0.},{0.,1.,0.},{0.,0.,1.}};
+    
+    for(int row = 0; row < 3; row++)
+    {
+        for(int col = 0; col < 3; col++)
+        {
+            if (!std::isfinite(covariance[row][col])) return false;
+            
+            a[row][col] = covariance[row][col];
+        }
+    }
+    
+    // Off diagonal elements below rounding of the matrix norm are dropped, this gives the
+    // same (absolute) accuracy as an SVD
+    double norm = 0.;
+    
+    for(int row = 0; row < 3; row++)
+        for(int col = 0; col < 3; col++) norm += std::fabs(a[row][col]);
+    
+    bool converged(false);
+    
+    // Typically converges in three or four sweeps
+    for(int sweep = 0; sweep < 50; sweep++)
+    {
+        double offDiag = std::fabs(a[0][1]) + std::fabs(a[0][2]) + std::fabs(a[1][2]);
+        
+        if (norm + 100. * offDiag == norm)
+        {
+            converged = true;
+            break;
+        }
+        
+        for(int p = 0; p < 2; p++)
+        {
+            for(int q = p + 1; q < 3; q++)
+            {
+                double apq = a[p][q];
+                
+                if (norm + 100. * std::fabs(apq) == norm)
+                {
+                    a[p][q] = a[q][p] = 0.;
+                    continue;
+                }
+                
+                // Rotation angle which zeroes a[p][q]
+                double theta = (a[q][q] - a[p][p]) / (2. * apq);
+                double t     = std::fabs(theta) > 1.e150 ? 0.5 / theta
+                             : std::copysign(1., theta) / (std::fabs(theta) + std::sqrt(theta * theta + 1.));
+                double c     = 1. / std::sqrt(t * t + 1.);
+                double s     = t * c;
+                double tau   = s / (1. + c);
+                
+                a[p][p] -= t * apq;
+                a[q][q] += t * apq;
+                a[p][q]  = a[q][p] = 0.;
+                
+                int r = 3 - p - q;
+                
+                double arp = a[r][p];
+                double arq = a[r][q];
+                
+                a[r][p] = a[p][r] = arp - s * (arq + arp * tau);
+                a[r][q] = a[q][r] = arq + s * (arp - arq * tau);
+                
+                for(int k = 0; k < 3; k++)
+                {
+                    double vkp = v[k][p];
+                    double vkq = v[k][q];
+                    
+                    v[k][p] = vkp - s * (vkq + vkp * tau);
+                    v[k][q] = vkq + s * (vkp - vkq * tau);
+                }
+            }
+        }
+    }
+    
+    if (!converged) return false;
+    
+    // Order by decreasing magnitude
+    int order[3] = {0, 1, 2};
+    
+    std::sort(order, order + 3, [&a](int left, int right){return std::fabs(a[left][left]) > std::fabs(a[right][right]);});
+    
+    for(int idx = 0; idx < 3; idx++)
+    {
+        eigenVals[idx] = std::fabs(a[order[idx]][order[idx]]);
+        
+        for(int k = 0; k < 3; k++) eigenVecs[idx][k] = v[k][order[idx]];
+    }
+    
+    canonicalEigenSigns(eigenVecs);
+    
+    return true;
+}
+    
+void PrincipalComponentsAlg::canonicalEigenSigns(double eigenVecs[3][3])
+{
+    for(int idx = 0; idx < 3; idx++)
+    {
+        int maxIdx = 0;
+        
+        for(int k = 1; k < 3; k++)
+            if (std::fabs(eigenVecs[idx][k]) > std::fabs(eigenVecs[idx][maxIdx])) maxIdx = k;
+        
+        if (eigenVecs[idx][maxIdx] < 0.)
+            for(int k = 0; k < 3; k++) eigenVecs[idx][k] = -eigenVecs[idx][k];
+    }
+}
+    
+bool PrincipalComponentsAlg::decomposeCovariance(const double covariance[3][3], double eigenVals[3], double eigenVecs[3][3]) const
+{
+    if (m_useTDecompSVD) return svdEigen3x3(covariance, eigenVals, eigenVecs);
+    
+    return jacobiEigen3x3(covariance, eigenVals, eigenVecs);
+}
+    
+void PrincipalComponentsAlg::PCAAnalysis_3D(const reco::HitPairListPtr& hitPairVector, reco::PrincipalComponents& pca, bool skeletonOnly) const
+{
+    // We want to run a PCA on the input TkrVecPoints...
+    // The steps are:
+    // 1) accumulate the mean position and the covariance matrix in a single pass
+    // 2) run the eigen decomposition
+    // 3) extract the eigen vectors and values
+    // see what happens
+    
+    // Run through the HitPairList and accumulate the mean position and covariance of the hits
+    MomentAccumulator moments;
+    
+    for (const auto& hit : hitPairVector)
+    {
+        if (skeletonOnly && !((hit->getStatusBits() & 0x10000000) == 0x10000000)) continue;
         
+        moments.add(hit->getPosition()[0], hit->getPosition()[1], hit->getPosition()[2]);
+    }
+    
+    int    numPairsInt(moments.getCount());
+    double meanPos[] = {moments.getMean()[0], moments.getMean()[1], moments.getMean()[2]};
+    
+    // Run the decomposition, we need at least two hits to have a covariance
+    double recobEigenVals[3];
+    double eigenVecs[3][3];
+    bool   svdOk(false);
+    
+    if (numPairsInt > 1)
+    {
+        double sigma[3][3];
+        
+        moments.getCovariance(meanPos, sigma);
+        
+        svdOk = decomposeCovariance(sigma, recobEigenVals, eigenVecs);
+    }
+    
+    if (svdOk)
+    {
         // Store away
-        pca = reco::PrincipalComponents(svdOk, numPairsInt, recobEigenVals, recobEigenVecs, meanPos);
+        pca = reco::PrincipalComponents(svdOk, numPairsInt, recobEigenVals, MakeEigenVectors(eigenVecs), meanPos);
     }
     else
     {
+        mf::LogDebug("Cluster3D") << "PCA decompose failure, numPairs = " << numPairsInt << std::endl;
         pca = reco::PrincipalComponents();
     }
     
     return;
 }
     
+    
 void PrincipalComponentsAlg::PCAAnalysis_2D(const reco::HitPairListPtr& hitPairVector, reco::PrincipalComponents& pca, bool updateAvePos) const
 {
     // Once an axis has been found our goal is to refine it by using only the 2D hits
     // We'll get 3D information for each of these by using the axis as a reference and use
     // the point of closest approach as the 3D position
     
-    // Define elements of our covariance matrix
-    double xi2(0.);
-    double xiyi(0.);
-    double xizi(0.);
-    double yi2(0.);
-    double yizi(0.);
-    double zi2(0.);
+    // Running mean and covariance sums of the accepted hit positions
+    MomentAccumulator moments;
     
     double   aveHitDoca(0.);
-    TVector3 avePosUpdate(0.,0.,0.);
     int      nHits(0);
     
     // Recover existing line parameters for current cluster
@@ -373,11 +526,6 @@ void PrincipalComponentsAlg::PCAAnalysis_2D(const reco::HitPairListPtr& hitPairV
     TVector3                         avePosition(inputPca.getAvePosition()[0], inputPca.getAvePosition()[1], inputPca.getAvePosition()[2]);
     TVector3                         axisDirVec(inputPca.getEigenVectors()[0][0], inputPca.getEigenVectors()[0][1], inputPca.getEigenVectors()[0][2]);
     
-    // We double loop here so we can use this method for both the first time through
-    // and a second time through where we re-calculate the mean position
-    // So, we need to keep track of the poca which we do with a double vector
-    std::vector<TVector3> hitPosVec;
-    
     // Outer loop over 3D hits
     for (const auto& hit3D : hitPairVector)
     {
@@ -497,18 +645,14 @@ void PrincipalComponentsAlg::PCAAnalysis_2D(const reco::HitPairListPtr& hitPairV
 
             //hitPosTVec = hitPos;
             
-            avePosUpdate += hitPosTVec;
-            
-            hitPosVec.push_back(hitPosTVec);
+            moments.add(hitPosTVec[0], hitPosTVec[1], hitPosTVec[2]);
             
             nHits++;
         }
     }
     
     // Get updated average position
-    avePosUpdate[0] /= double(nHits);
-    avePosUpdate[1] /= double(nHits);
-    avePosUpdate[2] /= double(nHits);
+    TVector3 avePosUpdate(moments.getMean()[0], moments.getMean()[1], moments.getMean()[2]);
     
     // Get the average hit doca
     aveHitDoca /= double(nHits);
@@ -518,85 +662,24 @@ void PrincipalComponentsAlg::PCAAnalysis_2D(const reco::HitPairListPtr& hitPairV
         avePosition = avePosUpdate;
     }
     
-    // Now loop through the hits and build out the covariance matrix
-    for(auto& hitPos : hitPosVec)
-    {
-        // And increment the values in the covariance matrix
-        double x = hitPos[0] - avePosition[0];
-        double y = hitPos[1] - avePosition[1];
-        double z = hitPos[2] - avePosition[2];
-            
-        xi2  += x * x;
-        xiyi += x * y;
-        xizi += x * z;
-        yi2  += y * y;
-        yizi += y * z;
-        zi2  += z * z;
-    }
-    
-    // Accumulation done, now do the actual work
-               
-    // Create the actual matrix
-    TMatrixD sigma(3, 3);
-               
-    sigma(0,0) = xi2;
-    sigma(0,1) = sigma(1,0) = xiyi;
-    sigma(0,2) = sigma(2,0) = xizi;
-    sigma(1,1) = yi2;
-    sigma(1,2) = sigma(2,1) = yizi;
-    sigma(2,2) = zi2;
-               
-    // Scale by number of pairs
-    sigma *= (1./(nHits - 1.));
-               
-    // Set up the SVD
-    TDecompSVD rootSVD(sigma);
-               
-    // run the decomposition
-    bool svdOk(false);
+    // The covariance matrix is taken about the axis position, we need at least two hits
+    double recobEigenVals[3];
+    double eigenVecs[3][3];
+    bool   svdOk(false);
     
-    try
-    {
-        svdOk = rootSVD.Decompose();
-    }
-    catch(...)
+    if (nHits > 1)
     {
-        svdOk = false;
-        mf::LogDebug("Cluster3D") << "PCA decompose failure, nhits = " << nHits << std::endl;
+        double center[] = {avePosition[0], avePosition[1], avePosition[2]};
+        double sigma[3][3];
+        
+        moments.getCovariance(center, sigma);
+        
+        svdOk = decomposeCovariance(sigma, recobEigenVals, eigenVecs);
     }
     
     if (svdOk)
     {
-        // Extract results
-        TVectorD eigenVals = rootSVD.GetSig();
-        TMatrixD eigenVecs = rootSVD.GetU();
-                   
-        // Get the eigen values
-        double recobEigenVals[] = {eigenVals[0], eigenVals[1], eigenVals[2]};
-                   
-        // Grab the principle axes
-        reco::PrincipalComponents::EigenVectors recobEigenVecs;
-        std::vector<double> tempVec;
-                   
-        // Get the first column vector
-        tempVec.push_back(eigenVecs(0, 0));
-        tempVec.push_back(eigenVecs(1, 0));
-        tempVec.push_back(eigenVecs(2, 0));
-        recobEigenVecs.push_back(tempVec);
-                   
-        // Now the second
-        tempVec.clear();
-        tempVec.push_back(eigenVecs(0, 1));
-        tempVec.push_back(eigenVecs(1, 1));
-        tempVec.push_back(eigenVecs(2, 1));
-        recobEigenVecs.push_back(tempVec);
-                   
-        // And the last
-        tempVec.clear();
-        tempVec.push_back(eigenVecs(0, 2));
-        tempVec.push_back(eigenVecs(1, 2));
-        tempVec.push_back(eigenVecs(2, 2));
-        recobEigenVecs.push_back(tempVec);
+        reco::PrincipalComponents::EigenVectors recobEigenVecs = MakeEigenVectors(eigenVecs);
         
         // Save the average position
         double avePosToSave[] = {avePosition[0],avePosition[1],avePosition[2]};
@@ -606,6 +689,7 @@ void PrincipalComponentsAlg::PCAAnalysis_2D(const reco::HitPairListPtr& hitPairV
     }
     else
     {
+        mf::LogDebug("Cluster3D") << "PCA decompose failure, nhits = " << nHits << std::endl;
         pca = reco::PrincipalComponents();
     }
     
@@ -24,6 +24,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -71,9 +72,38 @@ public:
     
     int  PCAAnalysis_reject3DOutliers(const reco::HitPairListPtr& hitPairVector, const reco::PrincipalComponents& pca, double aveHitDoca) const;
     
+    /**
+     *  @brief Eigen decomposition of a symmetric 3x3 matrix with ROOT's TDecompSVD
+     *
+     *  @param covariance - the (scaled) covariance matrix
+     *  @param eigenVals  - output eigen values, ordered largest to smallest
+     *  @param eigenVecs  - output eigen vectors, the columns of U, one per row in the order of the eigen values,
+     *                      with canonical signs
+     *
+     *  @return false if the decomposition failed
+     */
+    static bool svdEigen3x3(const double covariance[3][3], double eigenVals[3], double eigenVecs[3][3]);
+    
+    /**
+     *  @brief Cyclic Jacobi eigen decomposition of a symmetric 3x3 matrix, nothing is allocated
+     *
+     *         The eigen values and vectors, including their canonical signs, agree with svdEigen3x3
+     */
+    static bool jacobiEigen3x3(const double covariance[3][3], double eigenVals[3], double eigenVecs[3][3]);
     
 
 private:
+    /**
+     *  @brief Flip each eigen vector so that its largest magnitude component is positive, solvers
+     *         only fix the vectors up to their sign
+     */
+    static void canonicalEigenSigns(double eigenVecs[3][3]);
+    
+    /**
+     *  @brief Eigen decomposition of the covariance matrix with the configured solver
+     */
+    bool decomposeCovariance(const double covariance[3][3], double eigenVals[3], double eigenVecs[3][3]) const;
+    
     /**
      *  @brief This is used to get the poca, doca and arclen along cluster axis to 2D hit
      */
@@ -85,7 +115,8 @@ private:
                             double&                   arcLenWire,
                             double&                   doca);
     
-    double                                 m_parallel;  ///< means lines are parallel
+    double                                 m_parallel;      ///< means lines are parallel
+    bool                                   m_useTDecompSVD; ///< Use ROOT's TDecompSVD rather than the Jacobi eigen solver
     
     geo::Geometry*                         m_geometry;  // pointer to the Geometry service
     const detinfo::DetectorProperties*    m_detector;  // Pointer to the detector properties
@@ -22,6 +22,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <algorithm>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -47,26 +48,120 @@ void SkeletonAlg::reconfigure(fhicl::ParameterSet const &pset)
     m_maximumDeltaTicks = pset.get<double>("MaximumDeltaTicks", 10.0 );
 }
     
-double SkeletonAlg::FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>& hitVec,
-                                          int                                     viewToCheck,
-                                          int                                     referenceWire,
-                                          double                                  referenceTicks,
-                                          int&                                    firstWire,
-                                          int&                                    lastWire) const
+void Hit2DToHit3DTable::build(const reco::HitPairListPtr& hitPairList)
+{
+    m_hit3DVec.clear();
+    m_hit3DToIdx.clear();
+    m_hit2DOffsets.assign(1, 0);
+    m_hit2DView.clear();
+    m_hit2DIdx.clear();
+    m_hit2DWire.clear();
+    m_hit2DTicks.clear();
+    
+    m_hit3DVec.reserve(hitPairList.size());
+    m_hit3DToIdx.reserve(hitPairList.size());
+    
+    for(size_t view = 0; view < 3; view++)
+    {
+        m_hit2DToIdx[view].clear();
+        m_hit3DOffsets[view].assign(1, 0);
+    }
+    
+    // Number the hits, counting the 3D hits using each 2D hit as we go
+    for(const auto& hitPair : hitPairList)
+    {
+        // Don't consider points "rejected" earlier
+        if (hitPair->bitsAreSet(reco::ClusterHit3D::REJECTEDHIT)) continue;
+        
+        m_hit3DToIdx[hitPair] = m_hit3DVec.size();
+        m_hit3DVec.push_back(hitPair);
+        
+        for(const auto& hit2D : hitPair->getHits())
+        {
+            size_t view        = hit2D->getHit().View();
+            auto   insertState = m_hit2DToIdx[view].emplace(hit2D, m_hit2DToIdx[view].size());
+            size_t hit2DIdx    = insertState.first->second;
+            
+            // Counts are kept one entry ahead so that the partial sums give the offsets
+            if (insertState.second) m_hit3DOffsets[view].push_back(0);
+            
+            m_hit3DOffsets[view][hit2DIdx + 1]++;
+            
+            m_hit2DView.push_back(view);
+            m_hit2DIdx.push_back(hit2DIdx);
+            m_hit2DWire.push_back(hit2D->getHit().WireID().Wire);
+            m_hit2DTicks.push_back(hit2D->getTimeTicks());
+        }
+        
+        m_hit2DOffsets.push_back(m_hit2DView.size());
+    }
+    
+    // Now fill the lists of 3D hits using each 2D hit
+    std::vector<size_t> nextSlot[3];
+    
+    for(size_t view = 0; view < 3; view++)
+    {
+        std::vector<size_t>& offsets = m_hit3DOffsets[view];
+        
+        for(size_t idx = 1; idx < offsets.size(); idx++) offsets[idx] += offsets[idx - 1];
+        
+        m_hit3DIdx[view].resize(offsets.back());
+        nextSlot[view].assign(offsets.begin(), offsets.end() - 1);
+    }
+    
+    for(size_t hit3DIdx = 0; hit3DIdx < m_hit3DVec.size(); hit3DIdx++)
+    {
+        for(size_t hit2DPos = 0; hit2DPos < getNumHit2D(hit3DIdx); hit2DPos++)
+        {
+            size_t view = getHit2DView(hit3DIdx, hit2DPos);
+            
+            m_hit3DIdx[view][nextSlot[view][getHit2DIdx(hit3DIdx, hit2DPos)]++] = hit3DIdx;
+        }
+    }
+    
+    return;
+}
+    
+size_t Hit2DToHit3DTable::findHit3D(const reco::ClusterHit3D* hit3D) const
+{
+    std::unordered_map<const reco::ClusterHit3D*, size_t>::const_iterator hit3DItr = m_hit3DToIdx.find(hit3D);
+    
+    return hit3DItr != m_hit3DToIdx.end() ? hit3DItr->second : NOINDEX;
+}
+    
+size_t Hit2DToHit3DTable::findHit2D(size_t view, const reco::ClusterHit2D* hit2D) const
+{
+    if (view > 2) return NOINDEX;
+    
+    std::unordered_map<const reco::ClusterHit2D*, size_t>::const_iterator hit2DItr = m_hit2DToIdx[view].find(hit2D);
+    
+    return hit2DItr != m_hit2DToIdx[view].end() ? hit2DItr->second : NOINDEX;
+}
+    
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double SkeletonAlg::FindFirstAndLastWires(const Hit2DToHit3DTable& hit2DToHit3DTable,
+                                          const size_t*            hit3DIdxBegin,
+                                          const size_t*            hit3DIdxEnd,
+                                          int                      viewToCheck,
+                                          int                      referenceWire,
+                                          double                   referenceTicks,
+                                          int&                     firstWire,
+                                          int&                     lastWire) const
 {
     // In the simple case the first and last wires are simply the front and back of the input vector
-    firstWire = hitVec.front()->getHits()[viewToCheck]->getHit().WireID().Wire;
-    lastWire  = hitVec.back()->getHits()[viewToCheck]->getHit().WireID().Wire;
+    firstWire = hit2DToHit3DTable.getWire(*hit3DIdxBegin,     viewToCheck);
+    lastWire  = hit2DToHit3DTable.getWire(*(hit3DIdxEnd - 1), viewToCheck);
     
-    double maxDeltaTicks = referenceTicks - hitVec.front()->getHits()[viewToCheck]->getTimeTicks();
-    double minDeltaTicks = referenceTicks - hitVec.back()->getHits()[viewToCheck]->getTimeTicks();
+    double maxDeltaTicks = referenceTicks - hit2DToHit3DTable.getTimeTicks(*hit3DIdxBegin,     viewToCheck);
+    double minDeltaTicks = referenceTicks - hit2DToHit3DTable.getTimeTicks(*(hit3DIdxEnd - 1), viewToCheck);
     
     if (minDeltaTicks > maxDeltaTicks) std::swap(maxDeltaTicks, minDeltaTicks);
 
     double bestDeltaTicks = 1000000.;
     
     // Can't have a gap if only one element
-    if (hitVec.size() > 1)
+    if (hit3DIdxEnd - hit3DIdxBegin > 1)
     {
         // The issue is that there may be a gap in wires which we need to find.
         // Reset the last wire
@@ -75,10 +170,10 @@ double SkeletonAlg::FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>
         // Keep track of all the deltas
         double nextBestDeltaTicks = bestDeltaTicks;
         
-        for(const auto& hitPair : hitVec)
+        for(const size_t* hit3DIdx = hit3DIdxBegin; hit3DIdx != hit3DIdxEnd; hit3DIdx++)
         {
-            int    curWire    = hitPair->getHits()[viewToCheck]->getHit().WireID().Wire;
-            double deltaTicks = referenceTicks - hitPair->getHits()[viewToCheck]->getTimeTicks();
+            int    curWire    = hit2DToHit3DTable.getWire(*hit3DIdx, viewToCheck);
+            double deltaTicks = referenceTicks - hit2DToHit3DTable.getTimeTicks(*hit3DIdx, viewToCheck);
             
             maxDeltaTicks = std::max(maxDeltaTicks, deltaTicks);
             minDeltaTicks = std::min(minDeltaTicks, deltaTicks);
@@ -121,20 +216,43 @@ double SkeletonAlg::FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>
     return bestDeltaTicks;
 }
     
-class OrderHitsAlongWire
+void SkeletonAlg::SortHit3DAlongWires(const Hit2DToHit3DTable& hit2DToHit3DTable,
+                                      const std::vector<bool>* selected,
+                                      std::vector<size_t>      hit3DOffsets[3],
+                                      std::vector<size_t>      hit3DIdx[3]) const
 {
-public:
-    OrderHitsAlongWire(int view = 0) : m_view(view) {}
-    
-    bool operator()(const reco::ClusterHit3D* left, const reco::ClusterHit3D* right)
+    for(size_t view = 0; view < 3; view++)
     {
-        int viewToCheck = (m_view + 1) % 3;
+        const std::vector<size_t>& tableOffsets = hit2DToHit3DTable.getHit3DOffsets(view);
+        const std::vector<size_t>& tableHit3Ds  = hit2DToHit3DTable.getHit3DIndices(view);
+        
+        // Hits are ordered by the wire in the next view
+        size_t viewToCheck = (view + 1) % 3;
+        auto   orderAlongWire = [&hit2DToHit3DTable, viewToCheck](size_t left, size_t right)
+                                {return hit2DToHit3DTable.getWire(left, viewToCheck) < hit2DToHit3DTable.getWire(right, viewToCheck);};
+        
+        hit3DOffsets[view].assign(1, 0);
+        hit3DIdx[view].clear();
+        hit3DOffsets[view].reserve(tableOffsets.size());
+        hit3DIdx[view].reserve(tableHit3Ds.size());
         
-        return left->getHits()[viewToCheck]->getHit().WireID().Wire < right->getHits()[viewToCheck]->getHit().WireID().Wire;
+        for(size_t hit2DIdx = 0; hit2DIdx + 1 < tableOffsets.size(); hit2DIdx++)
+        {
+            for(size_t idx = tableOffsets[hit2DIdx]; idx < tableOffsets[hit2DIdx + 1]; idx++)
+            {
+                if (!selected || (*selected)[tableHit3Ds[idx]]) hit3DIdx[view].push_back(tableHit3Ds[idx]);
+            }
+            
+            size_t numHitPairs = hit3DIdx[view].size() - hit3DOffsets[view].back();
+            
+            if (numHitPairs > 1) std::sort(hit3DIdx[view].begin() + hit3DOffsets[view].back(), hit3DIdx[view].end(), orderAlongWire);
+            
+            hit3DOffsets[view].push_back(hit3DIdx[view].size());
+        }
     }
-private:
-    int m_view;
-};
+    
+    return;
+}
     
 struct OrderBestViews
 {
@@ -146,50 +264,35 @@ struct OrderBestViews
 };
     
 int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
+{
+    Hit2DToHit3DTable hit2DToHit3DTable(hitPairList);
+    
+    return FindMedialSkeleton(hit2DToHit3DTable);
+}
+    
+int SkeletonAlg::FindMedialSkeleton(const Hit2DToHit3DTable& hit2DToHit3DTable) const
 {
     // Our mission is to try to find the medial skeletion of the input list of hits
     // We define that as the set of hit pairs where the pairs share the same hit in a given direction
     // and the selected medial hit is equal distance from the edges.
-    // The first step in trying to do this is to build a map which relates a give 2D hit to an ordered list of hitpairs using it
-    typedef std::map<const reco::ClusterHit2D*, std::vector<const reco::ClusterHit3D*> > Hit2DtoHit3DMapU;
+    // The first step in trying to do this is to relate a given 2D hit to an ordered list of hitpairs using it,
+    // the table gives us the lists and here we order them
+    std::vector<size_t> hit3DOffsets[3];
+    std::vector<size_t> hit3DIdxVec[3];
     
-    Hit2DtoHit3DMapU hit2DToHit3DMap[3];
-    
-    for(const auto& hitPair : hitPairList)
-    {
-        // Don't consider points "rejected" earlier
-        if (hitPair->bitsAreSet(reco::ClusterHit3D::REJECTEDHIT)) continue;
-        
-        for(const auto& hit2D : hitPair->getHits())
-        {
-            size_t view = hit2D->getHit().View();
-            
-            hit2DToHit3DMap[view][hit2D].push_back(hitPair);
-        }
-    }
-    
-    // Do an explicit loop through to sort?
-    for(size_t idx = 0; idx < 3; idx++)
-    {
-        for(auto& mapPair : hit2DToHit3DMap[idx])
-        {
-            size_t numHitPairs = mapPair.second.size();
-            
-            if (numHitPairs > 1) std::sort(mapPair.second.begin(), mapPair.second.end(), OrderHitsAlongWire(idx));
-        }
-    }
+    SortHit3DAlongWires(hit2DToHit3DTable, nullptr, hit3DOffsets, hit3DIdxVec);
     
     // Keep a count of the number of skeleton points to be returned
     int nSkeletonPoints(0);
     
     // The idea is go through all the hits again and determine if they could be "skeleton" elements
-    for(const auto& hitPair : hitPairList)
+    // Note that the table only holds the hits not "rejected" earlier
+    for(size_t hit3DIdx = 0; hit3DIdx < hit2DToHit3DTable.getNumHit3D(); hit3DIdx++)
     {
-        // Don't consider points "rejected" earlier
-        if (hitPair->bitsAreSet(reco::ClusterHit3D::REJECTEDHIT)) continue;
+        const reco::ClusterHit3D* hitPair = hit2DToHit3DTable.getHit3D(hit3DIdx);
         
         // If a hit pair we skip for now
-        if (hitPair->getHits().size() < 3) continue;
+        if (hit2DToHit3DTable.getNumHit2D(hit3DIdx) < 3) continue;
         
         // Hopefully I am not confusing myself here.
         // The goal is to know, for a given 3D hit, how many other 3D hits share the 2D hits that it is made of
@@ -207,21 +310,29 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
         int    deltaWires[3]     = {0,  0,  0};
         double viewDeltaT[3]     = {0., 0., 0.};
         double bestDeltaTicks[3] = {0., 0., 0.};
-        int    wireNumByView[3]  = {int(hitPair->getHits()[0]->getHit().WireID().Wire),
-                                    int(hitPair->getHits()[1]->getHit().WireID().Wire),
-                                    int(hitPair->getHits()[2]->getHit().WireID().Wire)};
+        int    wireNumByView[3]  = {hit2DToHit3DTable.getWire(hit3DIdx, 0),
+                                    hit2DToHit3DTable.getWire(hit3DIdx, 1),
+                                    hit2DToHit3DTable.getWire(hit3DIdx, 2)};
         
         size_t bestViewIdx(0);
         
         // Initiate the loop over views
         for(size_t viewIdx = 0; viewIdx < 3; viewIdx++)
         {
-            const reco::ClusterHit2D* hit2D          = hitPair->getHits()[viewIdx];
-            double                    hit2DTimeTicks = hit2D->getTimeTicks();
+            double        hit2DTimeTicks = hit2DToHit3DTable.getTimeTicks(hit3DIdx, viewIdx);
+            const size_t* hitVecBegin    = nullptr;
+            const size_t* hitVecEnd      = nullptr;
             
-            std::vector<const reco::ClusterHit3D*>& hitVec(hit2DToHit3DMap[viewIdx][hit2D]);
+            // Recover the 3D hits sharing this 2D hit (none if this is not the expected view)
+            if (hit2DToHit3DTable.getHit2DView(hit3DIdx, viewIdx) == viewIdx)
+            {
+                size_t hit2DIdx = hit2DToHit3DTable.getHit2DIdx(hit3DIdx, viewIdx);
+                
+                hitVecBegin = hit3DIdxVec[viewIdx].data() + hit3DOffsets[viewIdx][hit2DIdx];
+                hitVecEnd   = hit3DIdxVec[viewIdx].data() + hit3DOffsets[viewIdx][hit2DIdx + 1];
+            }
             
-            numHitPairs[viewIdx] = hitVec.size();
+            numHitPairs[viewIdx] = hitVecEnd - hitVecBegin;
             
             if (numHitPairs[viewIdx] > 1)
             {
@@ -229,7 +340,9 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
                 int firstWire;
                 int lastWire;
                 
-                bestDeltaTicks[viewIdx] = FindFirstAndLastWires(hitVec,
+                bestDeltaTicks[viewIdx] = FindFirstAndLastWires(hit2DToHit3DTable,
+                                                                hitVecBegin,
+                                                                hitVecEnd,
                                                                 viewToCheck,
                                                                 wireNumByView[viewToCheck],
                                                                 hit2DTimeTicks,
@@ -244,7 +357,7 @@ int SkeletonAlg::FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const
                 
                 deltaWires[viewIdx]  = deltaFirst + deltaLast;
                 numHitPairs[viewIdx] = lastWire - firstWire + 1;
-                viewDeltaT[viewIdx]  = fabs(hit2DTimeTicks - hitPair->getHits()[viewToCheck]->getTimeTicks());
+                viewDeltaT[viewIdx]  = fabs(hit2DTimeTicks - hit2DToHit3DTable.getTimeTicks(hit3DIdx, viewToCheck));
             }
             // Otherwise, by definition, it is both a skeleton point and an edge point
             else hitPair->setStatusBit(reco::ClusterHit3D::SKELETONHIT | reco::ClusterHit3D::EDGEHIT);
@@ -312,20 +425,28 @@ void SkeletonAlg::GetSkeletonHits(const reco::HitPairListPtr& inputHitList, reco
 }
 
 void SkeletonAlg::AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList) const
+{
+    // Build the table from the skeleton hits alone
+    Hit2DToHit3DTable hit2DToHit3DTable(skeletonHitList);
+    
+    AverageSkeletonPositions(skeletonHitList, hit2DToHit3DTable);
+    
+    return;
+}
+
+void SkeletonAlg::AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList, const Hit2DToHit3DTable& hit2DToHit3DTable) const
 {
     // NOTE: This method assumes the list being given to it is comprised of skeleton hits
     //       YMMV if you send in a complete hit collection!
 
-    // Define a mapping between 2D hits and the 3D hits they make
-    typedef std::map<const reco::ClusterHit2D*, std::vector<const reco::ClusterHit3D*> > Hit2DtoHit3DMap;
-    
-    // We want to keep track of this mapping by view
-    Hit2DtoHit3DMap hit2DToHit3DMap[3];
+    // We want the mapping between 2D hits and the 3D hits they make for the skeleton hits only,
+    // so select those from the table
+    std::vector<bool> selected(hit2DToHit3DTable.getNumHit3D(), false);
     
     // Keep count of the number of skeleton hits selected
     unsigned int nSkeletonHits(0);
     
-    // Execute the first loop through the hits to build the map
+    // Execute the first loop through the hits to select them
     for(const auto& hitPair : skeletonHitList)
     {
         // Don't consider points "rejected" earlier
@@ -334,28 +455,29 @@ void SkeletonAlg::AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList
         // Count only those skeleton hits which have not been averaged
         if (!hitPair->bitsAreSet(reco::ClusterHit3D::SKELETONPOSAVE)) nSkeletonHits++;
         
-        for(const auto& hit2D : hitPair->getHits())
-        {
-            size_t view = hit2D->getHit().View();
-            
-            hit2DToHit3DMap[view][hit2D].push_back(hitPair);
-        }
+        size_t hit3DIdx = hit2DToHit3DTable.findHit3D(hitPair);
+        
+        if (hit3DIdx != Hit2DToHit3DTable::NOINDEX) selected[hit3DIdx] = true;
     }
     
     // Exit early if no skeleton hits to process
     if (!nSkeletonHits) return;
     
     // The list of 3D hits associated to any given 2D hit is most useful to us if it is ordered
-    // So this will loop through entries in the map and do the ordering
-    for(size_t idx = 0; idx < 3; idx++)
+    std::vector<size_t> hit3DOffsets[3];
+    std::vector<size_t> hit3DIdxVec[3];
+    
+    SortHit3DAlongWires(hit2DToHit3DTable, &selected, hit3DOffsets, hit3DIdxVec);
+    
+    // Index of the 2D hit in position hit2DPos of the given 3D hit in the given view, NOINDEX if none.
+    // Hits not in the table (rejected) need to be looked up
+    auto findHit2DIdx = [&hit2DToHit3DTable](const reco::ClusterHit3D* hit3D, size_t hit3DIdx, size_t hit2DPos, size_t view)
     {
-        for(auto& mapPair : hit2DToHit3DMap[idx])
-        {
-            size_t numHitPairs = mapPair.second.size();
-            
-            if (numHitPairs > 1) std::sort(mapPair.second.begin(), mapPair.second.end(), OrderHitsAlongWire(idx));
-        }
-    }
+        if (hit3DIdx != Hit2DToHit3DTable::NOINDEX)
+            return hit2DToHit3DTable.getHit2DView(hit3DIdx, hit2DPos) == view ? hit2DToHit3DTable.getHit2DIdx(hit3DIdx, hit2DPos) : Hit2DToHit3DTable::NOINDEX;
+        
+        return hit2DToHit3DTable.findHit2D(view, hit3D->getHits()[hit2DPos]);
+    };
     
     // Ok, so the basic strategy is not entirely different from that used to build the skeleton hits in the first
     // place. The idea is to loop through all skeleton hits and then determine the average position for the hit
@@ -369,19 +491,25 @@ void SkeletonAlg::AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList
     for(int bestViewVecIdx = 0; bestViewVecIdx < 2; bestViewVecIdx++)
     {
         std::list<reco::ClusterHit3D> tempHitPairList;
-        reco::HitPairListPtr          tempHitPairListPtr;
         
-        std::map<const reco::ClusterHit3D*, const reco::ClusterHit3D*> hit3DToHit3DMap;
+        std::vector<std::pair<const reco::ClusterHit3D*, const reco::ClusterHit3D*> > hit3DToHit3DVec;
         
         while(hitPairItr != skeletonHitList.end())
         {
-            const reco::ClusterHit3D* hit3D = *hitPairItr++;
+            const reco::ClusterHit3D* hit3D    = *hitPairItr++;
+            size_t                    hit3DIdx = hit2DToHit3DTable.findHit3D(hit3D);
+            
+            if (hit3DIdx != Hit2DToHit3DTable::NOINDEX && !selected[hit3DIdx]) hit3DIdx = Hit2DToHit3DTable::NOINDEX;
             
             std::vector<std::pair<size_t,size_t> > bestViewVec;
             
-            for(const auto& hit2D : hit3D->getHits())
+            for(size_t hit2DPos = 0; hit2DPos < hit3D->getHits().size(); hit2DPos++)
             {
-                bestViewVec.push_back(std::pair<size_t,size_t>(hit2D->getHit().View(),hit2DToHit3DMap[hit2D->getHit().View()][hit2D].size()));
+                size_t view     = hit3D->getHits()[hit2DPos]->getHit().View();
+                size_t hit2DIdx = findHit2DIdx(hit3D, hit3DIdx, hit2DPos, view);
+                size_t count    = hit2DIdx != Hit2DToHit3DTable::NOINDEX ? hit3DOffsets[view][hit2DIdx + 1] - hit3DOffsets[view][hit2DIdx] : 0;
+                
+                bestViewVec.push_back(std::pair<size_t,size_t>(view, count));
             }
             
             std::sort(bestViewVec.begin(), bestViewVec.end(), OrderBestViews());
@@ -391,18 +519,28 @@ void SkeletonAlg::AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList
             
             if (bestViewCnt > 5) continue;
             
-            std::vector<const reco::ClusterHit3D*>& hit3DVec = hit2DToHit3DMap[bestViewIdx][hit3D->getHits()[bestViewIdx]];
+            size_t        hit2DIdx    = findHit2DIdx(hit3D, hit3DIdx, bestViewIdx, bestViewIdx);
+            const size_t* hitVecBegin = nullptr;
+            const size_t* hitVecEnd   = nullptr;
+            
+            if (hit2DIdx != Hit2DToHit3DTable::NOINDEX)
+            {
+                hitVecBegin = hit3DIdxVec[bestViewIdx].data() + hit3DOffsets[bestViewIdx][hit2DIdx];
+                hitVecEnd   = hit3DIdxVec[bestViewIdx].data() + hit3DOffsets[bestViewIdx][hit2DIdx + 1];
+            }
             
             double avePosition[3] = {hit3D->getPosition()[0],0.,0.};
             
-            for(const auto& tempHit3D : hit3DVec)
+            for(const size_t* tempHit3DIdx = hitVecBegin; tempHit3DIdx != hitVecEnd; tempHit3DIdx++)
             {
+                const reco::ClusterHit3D* tempHit3D = hit2DToHit3DTable.getHit3D(*tempHit3DIdx);
+                
                 avePosition[1] += tempHit3D->getPosition()[1];
                 avePosition[2] += tempHit3D->getPosition()[2];
             }
             
-            avePosition[1] *= 1./double(hit3DVec.size());
-            avePosition[2] *= 1./double(hit3DVec.size());
+            avePosition[1] *= 1./double(hitVecEnd - hitVecBegin);
+            avePosition[2] *= 1./double(hitVecEnd - hitVecBegin);
             
             tempHitPairList.emplace_back(reco::ClusterHit3D(hit3D->getID(),
                                                             hit3D->getStatusBits(),
@@ -416,12 +554,10 @@ void SkeletonAlg::AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList
                                                             hit3D->getOverlapFraction(),
                                                             hit3D->getHits()));
             
-            tempHitPairListPtr.push_back(&tempHitPairList.back());
-            
-            hit3DToHit3DMap[tempHitPairListPtr.back()] = hit3D;
+            hit3DToHit3DVec.emplace_back(&tempHitPairList.back(), hit3D);
         }
         
-        for(const auto& pair : hit3DToHit3DMap)
+        for(const auto& pair : hit3DToHit3DVec)
         {
             pair.second->setPosition(pair.first->getPosition());
             pair.second->setStatusBit(reco::ClusterHit3D::SKELETONPOSAVE);
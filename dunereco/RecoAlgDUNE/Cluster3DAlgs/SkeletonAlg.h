@@ -19,12 +19,80 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 namespace lar_cluster3d
 {
 
+/**
+ *  @brief  A flat table relating the 2D hits of a cluster to the 3D hits which use them
+ *
+ *          The 3D hits and, separately in each view, the 2D hits are numbered densely in input order.
+ *          The 3D hits using each 2D hit are stored contiguously (compressed row storage), in input
+ *          order, and the wire and time of the 2D hits of each 3D hit are kept in arrays alongside.
+ *          The intent is to build this once per cluster and share it between the skeleton passes.
+ */
+class Hit2DToHit3DTable
+{
+public:
+    static const size_t NOINDEX = ~size_t(0);
+
+    Hit2DToHit3DTable() {}
+    
+    /**
+     *  @brief Build the table from the hits of a cluster, hits marked as rejected are skipped
+     */
+    explicit Hit2DToHit3DTable(const reco::HitPairListPtr& hitPairList) {build(hitPairList);}
+    
+    void build(const reco::HitPairListPtr& hitPairList);
+    
+    size_t                    getNumHit3D()                                  const {return m_hit3DVec.size();}
+    const reco::ClusterHit3D* getHit3D(size_t hit3DIdx)                      const {return m_hit3DVec[hit3DIdx];}
+    
+    /**
+     *  @brief Index of a 3D hit in the table, NOINDEX if it is not there
+     */
+    size_t findHit3D(const reco::ClusterHit3D* hit3D) const;
+    
+    /**
+     *  @brief Index of a 2D hit in its view, NOINDEX if no 3D hit in the table uses it
+     */
+    size_t findHit2D(size_t view, const reco::ClusterHit2D* hit2D) const;
+    
+    // Accessors for the 2D hit in position hit2DPos of the getHits() vector of a 3D hit
+    size_t getNumHit2D(size_t hit3DIdx)                     const {return m_hit2DOffsets[hit3DIdx + 1] - m_hit2DOffsets[hit3DIdx];}
+    size_t getHit2DView(size_t hit3DIdx, size_t hit2DPos)   const {return m_hit2DView[m_hit2DOffsets[hit3DIdx] + hit2DPos];}
+    size_t getHit2DIdx(size_t hit3DIdx, size_t hit2DPos)    const {return m_hit2DIdx[m_hit2DOffsets[hit3DIdx] + hit2DPos];}
+    int    getWire(size_t hit3DIdx, size_t hit2DPos)        const {return m_hit2DWire[m_hit2DOffsets[hit3DIdx] + hit2DPos];}
+    double getTimeTicks(size_t hit3DIdx, size_t hit2DPos)   const {return m_hit2DTicks[m_hit2DOffsets[hit3DIdx] + hit2DPos];}
+    
+    /**
+     *  @brief The 3D hits (as indices) using a given 2D hit, in input order
+     */
+    size_t        getNumHit2DInView(size_t view)                  const {return m_hit3DOffsets[view].size() - 1;}
+    const size_t* beginHit3D(size_t view, size_t hit2DIdx)        const {return m_hit3DIdx[view].data() + m_hit3DOffsets[view][hit2DIdx];}
+    const size_t* endHit3D(size_t view, size_t hit2DIdx)          const {return m_hit3DIdx[view].data() + m_hit3DOffsets[view][hit2DIdx + 1];}
+    const std::vector<size_t>& getHit3DOffsets(size_t view)       const {return m_hit3DOffsets[view];}
+    const std::vector<size_t>& getHit3DIndices(size_t view)       const {return m_hit3DIdx[view];}
+    
+private:
+    std::vector<const reco::ClusterHit3D*>                    m_hit3DVec;        ///< The accepted 3D hits
+    std::unordered_map<const reco::ClusterHit3D*, size_t>     m_hit3DToIdx;      ///< 3D hit to its index
+    std::unordered_map<const reco::ClusterHit2D*, size_t>     m_hit2DToIdx[3];   ///< 2D hit to its index, by view
+    
+    std::vector<size_t>                                       m_hit2DOffsets;    ///< Start of the 2D hits of each 3D hit
+    std::vector<size_t>                                       m_hit2DView;       ///< View of each 2D hit of each 3D hit
+    std::vector<size_t>                                       m_hit2DIdx;        ///< Index in its view of each 2D hit of each 3D hit
+    std::vector<int>                                          m_hit2DWire;       ///< Wire of each 2D hit of each 3D hit
+    std::vector<double>                                       m_hit2DTicks;      ///< Time of each 2D hit of each 3D hit
+    
+    std::vector<size_t>                                       m_hit3DOffsets[3]; ///< Start of the 3D hits using each 2D hit, by view
+    std::vector<size_t>                                       m_hit3DIdx[3];     ///< The 3D hits using each 2D hit, by view
+};
+
 /**
  *  @brief  Cluster3D class
  */
@@ -55,6 +123,13 @@ public:
      */
     int FindMedialSkeleton(reco::HitPairListPtr& hitPairList) const;
     
+    /**
+     *  @brief Find the medial skeleton using a table built from the list of input hit pairs
+     *
+     *  @param hit2DToHit3DTable - 2D to 3D hit table of the cluster
+     */
+    int FindMedialSkeleton(const Hit2DToHit3DTable& hit2DToHit3DTable) const;
+    
     /**
      *  @brief Return the skeleton hits from the input list
      *         - note that this presumes the skeleton hits have been found already
@@ -72,18 +147,37 @@ public:
      */
     void AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList) const;
     
+    /**
+     *  @brief As above but reusing the table built for the skeleton search of the whole cluster
+     *
+     *  @param skeletonHitList   - input list of skeleton hits, drawn (in order) from the hits of the table
+     *  @param hit2DToHit3DTable - 2D to 3D hit table of the cluster
+     */
+    void AverageSkeletonPositions(reco::HitPairListPtr& skeletonHitList, const Hit2DToHit3DTable& hit2DToHit3DTable) const;
+    
 private:
     
     /**
      *  @brief A function to find the bounding wires in a given view 
      *
      */
-    double FindFirstAndLastWires(std::vector<const reco::ClusterHit3D*>& hitVec,
-                                 int                                     viewToCheck,
-                                 int                                     referenceWire,
-                                 double                                  referenceTicks,
-                                 int&                                    firstWire,
-                                 int&                                    lastWire) const;
+    double FindFirstAndLastWires(const Hit2DToHit3DTable& hit2DToHit3DTable,
+                                 const size_t*            hit3DIdxBegin,
+                                 const size_t*            hit3DIdxEnd,
+                                 int                      viewToCheck,
+                                 int                      referenceWire,
+                                 double                   referenceTicks,
+                                 int&                     firstWire,
+                                 int&                     lastWire) const;
+    
+    /**
+     *  @brief Copy of the 3D hit lists of the table keeping only the selected 3D hits, with the
+     *         hits using each 2D hit ordered along the wires of the next view
+     */
+    void SortHit3DAlongWires(const Hit2DToHit3DTable& hit2DToHit3DTable,
+                             const std::vector<bool>* selected,
+                             std::vector<size_t>      hit3DOffsets[3],
+                             std::vector<size_t>      hit3DIdx[3]) const;
     
     double                    m_minimumDeltaTicks;
     double                    m_maximumDeltaTicks;
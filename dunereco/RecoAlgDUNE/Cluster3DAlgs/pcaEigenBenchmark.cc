@@ -0,0 +1,151 @@
+/**
+ *  @file   pcaEigenBenchmark.cc
+ *
+ *  @brief  Compares the Jacobi eigen solver of PrincipalComponentsAlg with the TDecompSVD path
+ *          on the covariance matrices of random track like clusters
+ *
+ *          Usage: pcaEigenBenchmark [number of clusters] [hits per cluster]
+ */
+
+#include "dunereco/RecoAlgDUNE/Cluster3DAlgs/PrincipalComponentsAlg.h"
+
+// std includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Covariance
+    {
+        double m[3][3];
+    };
+
+    /// Covariance of a line of hits with some transverse spread, in a random direction
+    Covariance MakeCluster(std::mt19937& engine, int nHits)
+    {
+        std::uniform_real_distribution<double> flat(-1., 1.);
+        std::normal_distribution<double>       gauss(0., 1.);
+
+        double dir[3]  = {flat(engine), flat(engine), flat(engine)};
+        double norm    = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+        double length  = 10. + 190. * (0.5 * flat(engine) + 0.5);
+        double spread  = 0.1 + 0.9 * (0.5 * flat(engine) + 0.5);
+        double mean[3] = {0., 0., 0.};
+        double sums[3][3] = {{0.,0.,0.},{0.,0.,0.},{0.,0.,0.}};
+
+        std::vector<double> hits(3 * nHits);
+
+        for(int hit = 0; hit < nHits; hit++)
+        {
+            double arcLen = length * flat(engine);
+
+            for(int k = 0; k < 3; k++)
+            {
+                hits[3 * hit + k] = arcLen * dir[k] / norm + spread * gauss(engine);
+                mean[k] += hits[3 * hit + k] / nHits;
+            }
+        }
+
+        for(int hit = 0; hit < nHits; hit++)
+            for(int row = 0; row < 3; row++)
+                for(int col = 0; col < 3; col++)
+                    sums[row][col] += (hits[3 * hit + row] - mean[row]) * (hits[3 * hit + col] - mean[col]);
+
+        Covariance covariance;
+
+        for(int row = 0; row < 3; row++)
+            for(int col = 0; col < 3; col++) covariance.m[row][col] = sums[row][col] / (nHits - 1);
+
+        return covariance;
+    }
+
+    template <class Solver>
+    double TimeSolver(Solver solver, const std::vector<Covariance>& clusters, std::vector<double>& results)
+    {
+        results.assign(12 * clusters.size(), 0.);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for(size_t idx = 0; idx < clusters.size(); idx++)
+        {
+            double eigenVals[3];
+            double eigenVecs[3][3];
+
+            if (!solver(clusters[idx].m, eigenVals, eigenVecs)) continue;
+
+            for(int k = 0; k < 3; k++)
+            {
+                results[12 * idx + k] = eigenVals[k];
+
+                for(int l = 0; l < 3; l++) results[12 * idx + 3 + 3 * k + l] = eigenVecs[k][l];
+            }
+        }
+
+        auto stop = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::micro>(stop - start).count() / clusters.size();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int nClusters = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int nHits     = argc > 2 ? std::atoi(argv[2]) : 50;
+
+    if (nClusters < 1 || nHits < 2)
+    {
+        std::cerr << "Usage: pcaEigenBenchmark [number of clusters] [hits per cluster > 1]" << std::endl;
+        return 1;
+    }
+
+    std::mt19937            engine(12345);
+    std::vector<Covariance> clusters;
+
+    clusters.reserve(nClusters);
+
+    for(int idx = 0; idx < nClusters; idx++) clusters.push_back(MakeCluster(engine, nHits));
+
+    std::vector<double> svdResults;
+    std::vector<double> jacobiResults;
+
+    double svdTime    = TimeSolver(lar_cluster3d::PrincipalComponentsAlg::svdEigen3x3,    clusters, svdResults);
+    double jacobiTime = TimeSolver(lar_cluster3d::PrincipalComponentsAlg::jacobiEigen3x3, clusters, jacobiResults);
+
+    // Eigen values and vectors, with their canonical signs, should agree to rounding
+    double maxValDiff(0.);
+    double maxAxisDiff(0.);
+    int    nFlipped(0);
+
+    for(int idx = 0; idx < nClusters; idx++)
+    {
+        const double* svd    = &svdResults[12 * idx];
+        const double* jacobi = &jacobiResults[12 * idx];
+
+        for(int k = 0; k < 3; k++)
+        {
+            maxValDiff = std::max(maxValDiff, std::fabs(svd[k] - jacobi[k]) / std::max(svd[0], 1.e-12));
+
+            double dot = 0.;
+
+            for(int l = 0; l < 3; l++) dot += svd[3 + 3 * k + l] * jacobi[3 + 3 * k + l];
+
+            maxAxisDiff = std::max(maxAxisDiff, 1. - std::fabs(dot));
+
+            if (dot < 0.) nFlipped++;
+        }
+    }
+
+    std::cout << "Clusters: " << nClusters << ", hits per cluster: " << nHits << std::endl;
+    std::cout << "TDecompSVD : " << svdTime    << " us per cluster" << std::endl;
+    std::cout << "Jacobi     : " << jacobiTime << " us per cluster" << std::endl;
+    std::cout << "Max eigen value difference, relative to the largest: " << maxValDiff  << std::endl;
+    std::cout << "Max 1 - |cos| between eigen vectors                 : " << maxAxisDiff << std::endl;
+    std::cout << "Eigen vectors with opposite signs                   : " << nFlipped    << std::endl;
+
+    return nFlipped == 0 ? 0 : 1;
+}
@@ -10,6 +10,7 @@
 
 // C/C++ includes
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // ROOT includes
@@ -20,12 +21,13 @@
 #include "TVectorD.h"
 
 // Framework includes
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art_root_io/TFileDirectory.h"
 #include "art_root_io/TFileService.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Utilities/Globals.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art/Framework/Core/ModuleMacros.h"
@@ -53,20 +55,21 @@
 
 namespace cnn {
 
-  class RegCNNEvaluator : public art::EDProducer {
+  class RegCNNEvaluator : public art::SharedProducer {
 
     public:
 
-      explicit RegCNNEvaluator(fhicl::ParameterSet const& pset);
+      explicit RegCNNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&);
       ~RegCNNEvaluator();
 
-      void produce(art::Event& evt);
-      void beginJob();
-      void endJob();
+      void produce(art::Event& evt, art::ProcessingFrame const& frame) override;
+      void beginJob(art::ProcessingFrame const&) override;
+      void endJob(art::ProcessingFrame const&) override;
 
     private:
 
-      void PrepareEvent(const art::Event& event);
+      /// Returns whether the longest track is contained
+      bool PrepareEvent(const art::Event& event);
       bool insideContVol(const double posX, const double posY, const double posZ);
 
       art::ServiceHandle<geo::Geometry> fGeom;
@@ -77,36 +80,49 @@ namespace cnn {
       std::string fCNNType;
       std::string fTarget;
 
-      cnn::TFRegNetHandler fTFHandler;
-      cnn::RegCNNVtxHandler fRegCNNVtxHandler;
-      cnn::RegCNNNumuHandler fRegCNNNumuHandler;
+      /// Network handlers, one set per schedule. Handlers using the same
+      /// network share a single Tensorflow session through the session pool.
+      struct Handlers {
+        explicit Handlers(fhicl::ParameterSet const& pset);
+        cnn::TFRegNetHandler fTFHandler;
+        cnn::RegCNNVtxHandler fRegCNNVtxHandler;
+        cnn::RegCNNNumuHandler fRegCNNNumuHandler;
+      };
+      std::vector< std::unique_ptr<Handlers> > fHandlers;
 
       std::string fHitsModuleLabel;
       std::string fTrackModuleLabel;
 
       double fContVolCut;
 
-      // for checking track status
-      bool fLongestTrackContained;
-
       void getCM(const RegPixelMap& pm, std::vector<float> &cm_list);
   }; // class RegCNNEvaluator
 
   //.......................................................................
-  RegCNNEvaluator::RegCNNEvaluator(fhicl::ParameterSet const& pset):
-    EDProducer(pset),
+  RegCNNEvaluator::Handlers::Handlers(fhicl::ParameterSet const& pset):
+    fTFHandler         (pset.get<fhicl::ParameterSet> ("TFNetHandler")),
+    fRegCNNVtxHandler  (pset.get<fhicl::ParameterSet> ("RegCNNVtxHandler")),
+    fRegCNNNumuHandler (pset.get<fhicl::ParameterSet> ("RegCNNNumuHandler"))
+  {
+  }
+
+  //.......................................................................
+  RegCNNEvaluator::RegCNNEvaluator(fhicl::ParameterSet const& pset, art::ProcessingFrame const&):
+    SharedProducer(pset),
     fPixelMapInput     (pset.get<std::string>         ("PixelMapInput")),
     fResultLabel       (pset.get<std::string>         ("ResultLabel")),
     fCNNType           (pset.get<std::string>         ("CNNType")),
     fTarget            (pset.get<std::string>         ("Target")),
-    fTFHandler         (pset.get<fhicl::ParameterSet> ("TFNetHandler")),
-    fRegCNNVtxHandler  (pset.get<fhicl::ParameterSet> ("RegCNNVtxHandler")),
-    fRegCNNNumuHandler (pset.get<fhicl::ParameterSet> ("RegCNNNumuHandler")),
     fHitsModuleLabel   (pset.get<std::string>         ("HitsModuleLabel")),
     fTrackModuleLabel  (pset.get<std::string>         ("TrackModuleLabel")),
     fContVolCut        (pset.get<double>              ("ContVolCut"))
   {
     produces< std::vector<cnn::RegCNNResult> >(fResultLabel);
+
+    for (unsigned int s = 0; s < art::Globals::instance()->nschedules(); ++s){
+      fHandlers.push_back(std::make_unique<Handlers>(pset));
+    }
+    async<art::InEvent>();
   }
 
   //......................................................................
@@ -118,12 +134,12 @@ namespace cnn {
   }
 
   //......................................................................
-  void RegCNNEvaluator::beginJob()
+  void RegCNNEvaluator::beginJob(art::ProcessingFrame const&)
   {  
   }
 
   //......................................................................
-  void RegCNNEvaluator::endJob()
+  void RegCNNEvaluator::endJob(art::ProcessingFrame const&)
   {
   }
 
@@ -141,10 +157,11 @@ namespace cnn {
   }
 
   //......................................................................
-  void RegCNNEvaluator::produce(art::Event& evt)
+  void RegCNNEvaluator::produce(art::Event& evt, art::ProcessingFrame const& frame)
   {
 
-    this->PrepareEvent(evt);
+    const bool longestTrackContained = this->PrepareEvent(evt);
+    Handlers& handlers = *fHandlers[frame.scheduleID().id()];
 
     /// Define containers for the things we're going to produce
     std::unique_ptr< std::vector<RegCNNResult> >
@@ -172,23 +189,23 @@ namespace cnn {
         if(pixelmaplist.size() > 0){
             std::vector<float> networkOutput;
             if (fTarget == "nueenergy"){
-                networkOutput = fTFHandler.Predict(*pixelmaplist[0]);
+                networkOutput = handlers.fTFHandler.Predict(*pixelmaplist[0]);
                 //std::cout << "-->" << networkOutput[0] << std::endl;
             }
             else if (fTarget == "nuevertex"){
                 std::vector<float> center_of_mass(6,0);
                 getCM(*pixelmaplist[0], center_of_mass);
                 std::cout << "cm: " << center_of_mass[0] << " " << center_of_mass[1] << " " << center_of_mass[2] << std::endl;
-                networkOutput = fTFHandler.Predict(*pixelmaplist[0], center_of_mass);
+                networkOutput = handlers.fTFHandler.Predict(*pixelmaplist[0], center_of_mass);
                 std::cout << "cnn nuevertex : "<<networkOutput[0] << " " << networkOutput[1] << " " << networkOutput[2] << std::endl;
             }
             else if (fTarget == "nuevertex_on_img"){
                 auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
                 auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt, clockData);
-                networkOutput = fRegCNNVtxHandler.GetVertex(clockData, detProp, evt, *pixelmaplist[0]);
+                networkOutput = handlers.fRegCNNVtxHandler.GetVertex(clockData, detProp, evt, *pixelmaplist[0]);
             } 
             else if (fTarget == "numuenergy") {
-                networkOutput = fRegCNNNumuHandler.Predict(*pixelmaplist[0], fLongestTrackContained);
+                networkOutput = handlers.fRegCNNNumuHandler.Predict(*pixelmaplist[0], longestTrackContained);
             }
             else {
                 std::cout << "Wrong Target with 2D 3-view pixel maps" << std::endl;
@@ -207,7 +224,7 @@ namespace cnn {
     evt.put(std::move(resultCol), fResultLabel);
   }
 
-  void RegCNNEvaluator::PrepareEvent(const art::Event& evt) {
+  bool RegCNNEvaluator::PrepareEvent(const art::Event& evt) {
       // Hits
       auto hitListHandle = evt.getValidHandle<std::vector<recob::Hit>>(fHitsModuleLabel);
 
@@ -233,7 +250,7 @@ namespace cnn {
           }
       }
 
-      fLongestTrackContained = true;
+      bool longestTrackContained = true;
       if (iLongestTrack >= 0 && iLongestTrack <= ntracks-1) {
           if (fmth.isValid()) {
               std::vector< art::Ptr<recob::Hit> > vhit = fmth.at(iLongestTrack);
@@ -242,12 +259,14 @@ namespace cnn {
                       std::vector< art::Ptr<recob::SpacePoint> > spts = fmhs.at(vhit[h].key());
                       if (spts.size()) {
                           if (!insideContVol(spts[0]->XYZ()[0], spts[0]->XYZ()[1], spts[0]->XYZ()[2]))
-                              fLongestTrackContained = false;
+                              longestTrackContained = false;
                       }
                   }
               }
           }
       } // End of search longestTrack
+
+      return longestTrackContained;
   }
 
   bool RegCNNEvaluator::insideContVol(const double posX, const double posY, const double posZ) {
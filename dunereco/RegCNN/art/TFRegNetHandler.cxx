@@ -34,7 +34,9 @@ namespace cnn
     mf::LogInfo("TFRegNetHandler") << "Loading network: " << fTFProtoBuf << std::endl;
     std::cout<<"Loading network: "<<fTFProtoBuf<<std::endl;
     //fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,{});
-    fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,fOutputName);
+    // Handlers using the same file and thread counts share one session
+    fTFGraph = tf::RegCNNGraph::create(fTFProtoBuf.c_str(),fInputs,fOutputName,
+                                       pset.get<int>("IntraOpThreads", 0),pset.get<int>("InterOpThreads", 0));
     if(!fTFGraph){
       art::Exception(art::errors::Unknown) << "Tensorflow model not found or incorrect";
     }
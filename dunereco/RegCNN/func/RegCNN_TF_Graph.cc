@@ -17,24 +17,16 @@
 //#include "tensorflow/core/kernels/conv_3d.h"
 
 // -------------------------------------------------------------------
-tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs, bool & success)
+tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs, bool & success,
+                             int intra_op_threads, int inter_op_threads)
 {
     success = false; // until all is done correctly
 
-    auto status = tensorflow::NewSession(tensorflow::SessionOptions(), &fSession);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    fSharedSession = SessionPool::get(graph_file_name, intra_op_threads, inter_op_threads);
+    if (!fSharedSession) { return; }
+    fSession = fSharedSession->session;
 
-    tensorflow::GraphDef graph_def;
-    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    const tensorflow::GraphDef & graph_def = *fSharedSession->graph_def;
 
     size_t ng = graph_def.node().size();
 
@@ -95,25 +87,13 @@ tf::RegCNNGraph::RegCNNGraph(const char* graph_file_name, const unsigned int &ni
         return;
     }
 
-
-    status = fSession->Create(graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
     success = true; // ok, graph loaded from the file
     std::cout<<"ok, graph loaded from the file"<<std::endl;
 }
 
 tf::RegCNNGraph::~RegCNNGraph()
 {
-    auto status = fSession->Close();
-    if (!status.ok()) {
-      std::cout << "RegCNNGraph::dtor: " << "Close failed." << std::endl;
-    }
-    delete fSession;
+    // the session is closed by the pool once its last user is gone
 }
 // -------------------------------------------------------------------
 
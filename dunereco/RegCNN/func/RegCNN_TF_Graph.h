@@ -16,6 +16,8 @@
 #include <vector>
 #include <string>
 
+#include "dunereco/CVN/tf/tf_session_pool.h"
+
 namespace tensorflow
 {
     class Session;
@@ -28,10 +30,13 @@ namespace tf
 class RegCNNGraph
 {
 public:
-    static std::unique_ptr<RegCNNGraph> create(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs = {})
+    // the session is shared with every other graph object using the same file and thread
+    // counts; 0 threads leaves the choice to Tensorflow
+    static std::unique_ptr<RegCNNGraph> create(const char* graph_file_name, const unsigned int &ninputs, const std::vector<std::string> & outputs = {},
+                                               int intra_op_threads = 0, int inter_op_threads = 0)
     {
         bool success;
-        std::unique_ptr<RegCNNGraph> ptr(new RegCNNGraph(graph_file_name, ninputs, outputs,  success));
+        std::unique_ptr<RegCNNGraph> ptr(new RegCNNGraph(graph_file_name, ninputs, outputs,  success, intra_op_threads, inter_op_threads));
         if (success) { return ptr; }
         else { return nullptr; }
     }
@@ -59,8 +64,10 @@ public:
 
 private:
     /// Not-throwing constructor.
-    RegCNNGraph(const char* graph_file_name, const unsigned int& ninputs, const std::vector<std::string> & outputs, bool & success);
+    RegCNNGraph(const char* graph_file_name, const unsigned int& ninputs, const std::vector<std::string> & outputs, bool & success,
+                int intra_op_threads, int inter_op_threads);
 
+    std::shared_ptr<SharedSession> fSharedSession;
     tensorflow::Session* fSession;
     std::vector<std::string> fInputNames;
     std::vector< std::string > fOutputNames;
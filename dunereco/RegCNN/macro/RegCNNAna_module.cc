@@ -285,6 +285,9 @@ void myana::RegCNNAna::beginSubRun(const art::SubRun& sr) {
 
 void myana::RegCNNAna::analyze(art::Event const& evt)
 {
+  // Reuse the association finders of the dune_ana utilities for the rest of this event
+  dune_ana::DUNEAnaAssocCache assocCache(evt);
+
   this->reset();
   ievt = evt.id().event();
   bool isMC = !evt.isRealData(); 
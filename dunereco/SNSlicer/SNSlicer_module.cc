@@ -42,6 +42,11 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
 
 #include "lardataobj/RecoBase/Cluster.h"
 #include "lardataobj/RecoBase/Hit.h"
@@ -64,6 +69,33 @@ namespace
     int idx; // index into original hits array
   };
 
+  /// Uniform grid over a contiguous range of the time ordered points, with
+  /// cells at least eps on a side so that a neighbour search only has to
+  /// look at the 3x3 cells around a point.
+  class PtGrid
+  {
+  public:
+    PtGrid(const std::vector<Pt2D>& D, const std::vector<int>& order,
+           unsigned int begin, unsigned int end, double eps);
+
+    /// Call f(j) for every point j in the grid closer than eps to p,
+    /// including p itself
+    template<class F> void ForEachNeighbour(const Pt2D& p, F f) const;
+
+  protected:
+    std::pair<int64_t, int64_t> Cell(const Pt2D& p) const;
+    uint64_t Key(int64_t ix, int64_t iy) const {return (uint64_t(iy) << 32) | uint64_t(ix);}
+
+    const std::vector<Pt2D>& fD;
+    double fEps2;
+    double fCellSize;
+    double fMinX, fMinY;
+    int64_t fNCellsX, fNCellsY;
+
+    std::vector<int> fPts; ///< Indices into D, sorted by cell
+    std::unordered_map<uint64_t, std::pair<unsigned int, unsigned int>> fCells; ///< Occupied cells
+  };
+
   class SNSlicer: public art::EDProducer 
   {
   public:
@@ -72,15 +104,15 @@ namespace
     void produce(art::Event&) override;
    
   protected:
-    std::vector<int> regionQuery(const std::vector<Pt2D>& D, const Pt2D& p) const;
-
-    void expandCluster(const std::vector<Pt2D>& D,
-                       int ip,
-                       std::vector<int> neiPts, int C,
-                       std::vector<bool>& visited,
-                       std::vector<int>& inClust) const;
+    /// Call f(grid, i) for every point i, building grids over windows of
+    /// the given length along y (the whole range if window <= 0) plus a
+    /// margin of eps either side, so that each i sees all its neighbours
+    template<class F> void ForEachWindow(const std::vector<Pt2D>& D,
+                                         double window, F f) const;
 
-    std::vector<std::vector<Pt2D>> DBSCAN(const std::vector<Pt2D>& D) const;
+    /// Clusters are returned in the order of their lowest index core point,
+    /// with their points in index order
+    std::vector<std::vector<Pt2D>> DBSCAN(const std::vector<Pt2D>& D, double window) const;
 
     //    std::string fDetSimProducerLabel;
 
@@ -94,6 +126,7 @@ namespace
     // DBScan params
     double fEps;
     int fMinPts;
+    double fTimeWindow; ///< Length of the time windows to cluster in turn, 0 for the whole readout
   };
 
 }
@@ -121,89 +154,169 @@ namespace {
 
     fEps = pset.get<double>("Eps");
     fMinPts = pset.get<int>("MinPts");
+    fTimeWindow = pset.get<double>("TimeWindow", 0);
   }
 
   //---------------------------------------------------------------------------
-  std::vector<int> SNSlicer::regionQuery(const std::vector<Pt2D>& D, const Pt2D& p) const
+  PtGrid::PtGrid(const std::vector<Pt2D>& D, const std::vector<int>& order,
+                 unsigned int begin, unsigned int end, double eps)
+    : fD(D), fEps2(eps*eps), fMinX(0), fMinY(0)
   {
-    std::vector<int> ret;
-    for(unsigned int i = 0; i < D.size(); ++i){
-      if((D[i].x-p.x)*(D[i].x-p.x) + (D[i].y-p.y)*(D[i].y-p.y) < fEps*fEps)
-        ret.push_back(i);
+    double maxX = 0, maxY = 0;
+    if(begin < end){
+      fMinX = maxX = D[order[begin]].x;
+      fMinY = maxY = D[order[begin]].y;
+    }
+    for(unsigned int o = begin; o < end; ++o){
+      const Pt2D& p = D[order[o]];
+      fMinX = std::min(fMinX, p.x); maxX = std::max(maxX, p.x);
+      fMinY = std::min(fMinY, p.y); maxY = std::max(maxY, p.y);
+    }
+
+    // Keep the cell numbers within 32 bits
+    const double maxCells = 1 << 30;
+    fCellSize = std::max({std::sqrt(fEps2), (maxX-fMinX)/maxCells, (maxY-fMinY)/maxCells, 1e-6});
+    fNCellsX = int64_t((maxX-fMinX)/fCellSize) + 1;
+    fNCellsY = int64_t((maxY-fMinY)/fCellSize) + 1;
+
+    std::vector<std::pair<uint64_t, int>> keyed;
+    keyed.reserve(end-begin);
+    for(unsigned int o = begin; o < end; ++o){
+      const std::pair<int64_t, int64_t> c = Cell(D[order[o]]);
+      keyed.emplace_back(Key(c.first, c.second), order[o]);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    fPts.resize(keyed.size());
+    fCells.reserve(keyed.size());
+    for(unsigned int i = 0; i < keyed.size(); ++i){
+      fPts[i] = keyed[i].second;
+      if(i == 0 || keyed[i].first != keyed[i-1].first){
+        fCells[keyed[i].first] = std::make_pair(i, i);
+      }
+      ++fCells[keyed[i].first].second;
     }
-    return ret;
   }
 
   //---------------------------------------------------------------------------
-  std::vector<int> Join(const std::vector<int> a, const std::vector<int> b)
+  std::pair<int64_t, int64_t> PtGrid::Cell(const Pt2D& p) const
   {
-    std::set<int> s(a.begin(), a.end());
-    s.insert(b.begin(), b.end());
-
-    return std::vector<int>(s.begin(), s.end());
+    return std::make_pair(std::min(fNCellsX-1, std::max(int64_t(0), int64_t((p.x-fMinX)/fCellSize))),
+                          std::min(fNCellsY-1, std::max(int64_t(0), int64_t((p.y-fMinY)/fCellSize))));
   }
 
   //---------------------------------------------------------------------------
-  void SNSlicer::expandCluster(const std::vector<Pt2D>& D,
-                               int ip,
-                               std::vector<int> neiPts, int C,
-                               std::vector<bool>& visited,
-                               std::vector<int>& inClust) const
+  template<class F> void PtGrid::ForEachNeighbour(const Pt2D& p, F f) const
   {
-    inClust[ip] = C;
-
-    bool any = true;
-    while(any){
-      any = false;
-      for(unsigned int iNP = 0; iNP < neiPts.size(); ++iNP){ // P'
-        if(inClust[neiPts[iNP]] == -1){
-          inClust[neiPts[iNP]] = C;
+    const std::pair<int64_t, int64_t> c = Cell(p);
+    for(int64_t iy = std::max(int64_t(0), c.second-1); iy <= std::min(fNCellsY-1, c.second+1); ++iy){
+      for(int64_t ix = std::max(int64_t(0), c.first-1); ix <= std::min(fNCellsX-1, c.first+1); ++ix){
+        auto it = fCells.find(Key(ix, iy));
+        if(it == fCells.end()) continue;
+        for(unsigned int k = it->second.first; k < it->second.second; ++k){
+          const Pt2D& q = fD[fPts[k]];
+          if((q.x-p.x)*(q.x-p.x) + (q.y-p.y)*(q.y-p.y) < fEps2) f(fPts[k]);
         }
+      }
+    }
+  }
 
-        if(!visited[neiPts[iNP]]){
-          visited[neiPts[iNP]] = true;
-          std::vector<int> neiPts2 = regionQuery(D, D[neiPts[iNP]]);
-          //        double Q = 0;
-          //        for(int i: neiPts2) Q += D[i].q;
-          const int Q = neiPts2.size();
-          if(Q >= fMinPts){
-            neiPts = Join(neiPts, neiPts2);
-            any = true;
-            break; // restart the while loop
-          }
-        }
+  //---------------------------------------------------------------------------
+  template<class F> void SNSlicer::ForEachWindow(const std::vector<Pt2D>& D,
+                                                 double window, F f) const
+  {
+    std::vector<int> order(D.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&D](int a, int b){return D[a].y < D[b].y;});
+
+    const double margin = std::abs(fEps);
+    unsigned int loadBegin = 0, loadEnd = 0;
+    for(unsigned int begin = 0; begin < order.size(); ){
+      // The points owned by this window
+      unsigned int end = order.size();
+      if(window > 0){
+        const double yEnd = D[order[begin]].y + window;
+        end = begin+1;
+        while(end < order.size() && D[order[end]].y < yEnd) ++end;
       }
+
+      // Plus the ones near enough to be their neighbours
+      const double yLo = D[order[begin]].y - margin;
+      const double yHi = D[order[end-1]].y + margin;
+      while(loadBegin < begin && D[order[loadBegin]].y < yLo) ++loadBegin;
+      loadEnd = std::max(loadEnd, end);
+      while(loadEnd < order.size() && D[order[loadEnd]].y <= yHi) ++loadEnd;
+
+      const PtGrid grid(D, order, loadBegin, loadEnd, fEps);
+      for(unsigned int o = begin; o < end; ++o) f(grid, order[o]);
+
+      begin = end;
     }
   }
 
   //---------------------------------------------------------------------------
-  std::vector<std::vector<Pt2D>> SNSlicer::DBSCAN(const std::vector<Pt2D>& D) const
+  int FindRoot(std::vector<int>& parent, int i)
   {
-    std::vector<bool> visited(D.size(), false);
-    //    std::vector<bool> noise(D.size(), false);
-    std::vector<int> inclust(D.size(), -1);
+    while(parent[i] != i){
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
 
-    int C = 0; // TODO, should this be -1 since we ++ below?
-    for(unsigned int iD = 0; iD < D.size(); ++iD){
-      if(visited[iD]) continue;
-      visited[iD] = true;
-
-      std::vector<int> neiPts = regionQuery(D, D[iD]);
-      //      double Q = 0;
-      //      for(int i: neiPts) Q += /D[i].q;
-      const int Q = neiPts.size();
-      if(Q < fMinPts){
-        //        noise[iD] = true;
-      }
-      else {
-        ++C;
-        expandCluster(D, iD, neiPts, C, visited, inclust);
+  //---------------------------------------------------------------------------
+  std::vector<std::vector<Pt2D>> SNSlicer::DBSCAN(const std::vector<Pt2D>& D, double window) const
+  {
+    // Core points have at least fMinPts points (themselves included) closer than fEps
+    std::vector<bool> isCore(D.size(), false);
+    ForEachWindow(D, window, [&](const PtGrid& grid, int i){
+        int Q = 0;
+        grid.ForEachNeighbour(D[i], [&Q](int){++Q;});
+        isCore[i] = (Q >= fMinPts);
+      });
+
+    // Neighbouring core points belong to the same cluster. The root of each
+    // set is kept at its lowest index, which is where the sequential
+    // algorithm would have started the cluster.
+    std::vector<int> parent(D.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    ForEachWindow(D, window, [&](const PtGrid& grid, int i){
+        if(!isCore[i]) return;
+        grid.ForEachNeighbour(D[i], [&](int j){
+            if(!isCore[j]) return;
+            const int ri = FindRoot(parent, i);
+            const int rj = FindRoot(parent, j);
+            if(ri < rj) parent[rj] = ri;
+            if(rj < ri) parent[ri] = rj;
+          });
+      });
+
+    // Other points go to the earliest started cluster with a core point
+    // nearby, or are noise
+    std::vector<int> inclust(D.size(), -1);
+    ForEachWindow(D, window, [&](const PtGrid& grid, int i){
+        if(isCore[i]){
+          inclust[i] = FindRoot(parent, i);
+          return;
+        }
+        grid.ForEachNeighbour(D[i], [&](int j){
+            if(!isCore[j]) return;
+            const int rj = FindRoot(parent, j);
+            if(inclust[i] == -1 || rj < inclust[i]) inclust[i] = rj;
+          });
+      });
+
+    std::vector<int> clustIdx(D.size(), -1);
+    std::vector<std::vector<Pt2D>> ret;
+    for(unsigned int i = 0; i < D.size(); ++i){
+      if(isCore[i] && inclust[i] == int(i)){
+        clustIdx[i] = ret.size();
+        ret.emplace_back();
       }
     }
-
-    std::vector<std::vector<Pt2D>> ret(C+1);
     for(unsigned int i = 0; i < D.size(); ++i){
-      if(inclust[i] >= 0) ret[inclust[i]].push_back(D[i]);
+      if(inclust[i] >= 0) ret[clustIdx[inclust[i]]].push_back(D[i]);
     }
     return ret;
   }
@@ -305,7 +418,7 @@ namespace {
       if(isSig) totTrueQ += q;
     }
 
-    std::vector<std::vector<Pt2D>> slices = DBSCAN(pts);
+    std::vector<std::vector<Pt2D>> slices = DBSCAN(pts, fTimeWindow*driftVel);
 
     for(const std::vector<Pt2D>& slice: slices){
       if(slice.empty()) continue; // TODO - how does this happen?
@@ -31,6 +31,7 @@
 #include "dunereco/AnaUtils/DUNEAnaTrackUtils.h"
 
 #include "cetlib/getenv.h"
+#include "cetlib_except/exception.h"
 
 namespace ctp
 {
@@ -48,6 +49,8 @@ namespace ctp
     fQMax = pset.get<float>("MaxCharge",1000);
     fQJump = pset.get<float>("MaxChargeJump",500);
     fNormalise = pset.get<bool>("NormaliseInputs",true);
+    fIntraOpThreads = pset.get<int>("IntraOpThreads",1);
+    fInterOpThreads = pset.get<int>("InterOpThreads",1);
   }
 
   CTPHelper::~CTPHelper(){
@@ -56,25 +59,56 @@ namespace ctp
   // Function to calculate the PID for a given track
   const ctp::CTPResult CTPHelper::RunConvolutionalTrackPID(const art::Ptr<recob::PFParticle> part, const art::Event &evt) const{
 
-    // Get the inputs to the network
+    return RunConvolutionalTrackPID(std::vector<art::Ptr<recob::PFParticle>>(1,part),evt).at(0);
+  }
+
+  // Function to calculate the PID for all of the given particles at once
+  const std::vector<ctp::CTPResult> CTPHelper::RunConvolutionalTrackPID(const std::vector<art::Ptr<recob::PFParticle>> &particles, const art::Event &evt) const{
+
+    std::vector<ctp::CTPResult> results(particles.size());
+
+    // Get the inputs to the network, remembering which particle each belongs to
     std::vector< std::vector< std::vector<float> > > finalInputs;
+    std::vector<unsigned int> inputParticles;
+
+    for(unsigned int p = 0; p < particles.size(); ++p){
+      std::vector< std::vector<float> > twoVecs = GetNetworkInputs(particles.at(p),evt);
+      if(twoVecs.empty()) continue;
+
+      finalInputs.push_back(twoVecs);
+      inputParticles.push_back(p);
+    }
+
+    if(finalInputs.empty()) return results;
 
-    std::vector< std::vector<float> > twoVecs = GetNetworkInputs(part,evt);
-    if(twoVecs.empty()) return ctp::CTPResult();
+    // Run the network once for all of the particles
+    std::vector< std::vector< std::vector<float> > > convNetOutput = GetNetwork().run(finalInputs);
 
-    finalInputs.push_back(twoVecs);
+    if(convNetOutput.size() != finalInputs.size()){
+      throw cet::exception("CTPHelper") << "Network returned " << convNetOutput.size()
+                                        << " results for " << finalInputs.size() << " tracks\n";
+    }
+
+    for(unsigned int i = 0; i < inputParticles.size(); ++i){
+      results.at(inputParticles.at(i)) = ctp::CTPResult(convNetOutput.at(i).at(0));
+    }
+
+    return results;
+  }
+
+  tf::CTPGraph& CTPHelper::GetNetwork() const{
 
-//    std::cout << "We have sensible inputs... building TF object" << std::endl;
-    // Load the network and run it
-    const std::string fullPath = cet::getenv(fNetDir) + "/" + fNetName;
-    std::unique_ptr<tf::CTPGraph> convNet = tf::CTPGraph::create(fullPath.c_str(),std::vector<std::string>(),2,1);
-//    std::cout << "Calling TF interface" << std::endl;
-    std::vector< std::vector< std::vector<float> > > convNetOutput = convNet->run(finalInputs);
+    // Loading the graph is expensive, so only do it once and only if it is needed
+    std::call_once(fConvNetFlag, [this](){
+      const std::string fullPath = cet::getenv(fNetDir) + "/" + fNetName;
+      fConvNet = tf::CTPGraph::create(fullPath.c_str(),std::vector<std::string>(),2,1,fIntraOpThreads,fInterOpThreads);
+    });
+
+    if(!fConvNet){
+      throw cet::exception("CTPHelper") << "Unable to load the track PID network " << fNetName << " from " << fNetDir << "\n";
+    }
 
-//    std::cout << "Got result from TF" << std::endl;
-    ctp::CTPResult result(convNetOutput.at(0).at(0));
-//    std::cout << "Returning CTPResult" << std::endl;
-    return result;
+    return *fConvNet;
   }
 
   // Calculate the features for the track PID
@@ -10,6 +10,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "TVector3.h"
 
@@ -23,6 +25,11 @@
 
 #include "dunereco/TrackPID/products/CTPResult.h"
 
+namespace tf
+{
+  class CTPGraph;
+}
+
 namespace ctp
 {
 
@@ -36,6 +43,10 @@ namespace ctp
     // Function to calculate the PID for a given track
     const ctp::CTPResult RunConvolutionalTrackPID(const art::Ptr<recob::PFParticle> particle, const art::Event &evt) const;
 
+    // Calculate the PID for a set of particles with a single network call. The results are in the
+    // order of the particles, with a dummy result for those that are not suitable tracks
+    const std::vector<ctp::CTPResult> RunConvolutionalTrackPID(const std::vector<art::Ptr<recob::PFParticle>> &particles, const art::Event &evt) const;
+
     // Calculate the features for the track PID
     const std::vector<std::vector<float>> GetNetworkInputs(const art::Ptr<recob::PFParticle>, const art::Event &evt) const;
     const std::vector<float> GetDeDxVector(const art::Ptr<recob::PFParticle>, const art::Event &evt) const;
@@ -56,9 +67,16 @@ namespace ctp
 
     void NormaliseInputs(std::vector<std::vector<float>> &netInputs) const;
 
+    // The network, loaded on first use and kept for the rest of the job
+    tf::CTPGraph& GetNetwork() const;
+
     // Variables for accessing the network architecture
     std::string fNetDir;
     std::string fNetName;
+    int fIntraOpThreads; // Tensorflow threads for the shared session
+    int fInterOpThreads;
+    mutable std::unique_ptr<tf::CTPGraph> fConvNet;
+    mutable std::once_flag fConvNetFlag;
 
     // Module names
     std::string fParticleLabel; 
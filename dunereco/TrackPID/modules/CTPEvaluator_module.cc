@@ -148,6 +148,9 @@ void CTPEvaluator::endJob()
 
 void CTPEvaluator::produce(art::Event &evt)
 {
+    // Reuse the association finders of the dune_ana utilities for the rest of this event
+    dune_ana::DUNEAnaAssocCache assocCache(evt);
+
     // Define containers for the things we're going to produce
     std::unique_ptr< std::vector<ctp::CTPResult> > resultCol(new std::vector<ctp::CTPResult>);
     std::unique_ptr< art::Assns<recob::Track,ctp::CTPResult> > trackResultAssn(new art::Assns<recob::Track,ctp::CTPResult>);
@@ -168,29 +171,35 @@ void CTPEvaluator::produce(art::Event &evt)
     const std::string trkLabel = fHelperPars.get<std::string>("TrackLabel");
     const std::vector<art::Ptr<recob::Track>> tracks = dune_ana::DUNEAnaEventUtils::GetTracks(evt,trkLabel);
 
+    // Find the track-like particles
+    const std::string caloLabel = fHelperPars.get<std::string>("CalorimetryLabel");
+    std::vector<art::Ptr<recob::PFParticle>> trackParticles;
+    std::vector<int> trackIDs;
+    std::vector<unsigned int> caloPoints;
+
     for (const art::Ptr<recob::PFParticle> &particle : particles)
     {
-        int thisTrackID = -999;
-      
         // Get the track if this particle is track-like
-        unsigned int nCaloPoints = 0;
-        if (dune_ana::DUNEAnaPFParticleUtils::IsTrack(particle,evt,fParticleLabel,trkLabel))
-        {
-            const art::Ptr<recob::Track> trk = dune_ana::DUNEAnaPFParticleUtils::GetTrack(particle,evt,fParticleLabel,trkLabel);
-            const std::string caloLabel = fHelperPars.get<std::string>("CalorimetryLabel");
-            const art::Ptr<anab::Calorimetry> calo = dune_ana::DUNEAnaTrackUtils::GetCalorimetry(trk,evt,trkLabel,caloLabel);
+        if (!dune_ana::DUNEAnaPFParticleUtils::IsTrack(particle,evt,fParticleLabel,trkLabel)) continue;
 
-            thisTrackID = trk.key();
-            nCaloPoints = calo->dEdx().size();
-        }
-        else continue;
+        const art::Ptr<recob::Track> trk = dune_ana::DUNEAnaPFParticleUtils::GetTrack(particle,evt,fParticleLabel,trkLabel);
+        const art::Ptr<anab::Calorimetry> calo = dune_ana::DUNEAnaTrackUtils::GetCalorimetry(trk,evt,trkLabel,caloLabel);
 
-        // Returns a dummy value if not a track or not suitable
-        CTPResult thisPID = fConvTrackPID.RunConvolutionalTrackPID(particle,evt);
+        trackParticles.push_back(particle);
+        trackIDs.push_back(trk.key());
+        caloPoints.push_back(calo->dEdx().size());
+    }
+
+    // Evaluate all of them with a single network call. Dummy values for tracks that are not suitable
+    const std::vector<CTPResult> pids = fConvTrackPID.RunConvolutionalTrackPID(trackParticles,evt);
+    auto const ptrMaker = art::PtrMaker<ctp::CTPResult>(evt);
+
+    for (unsigned int t = 0; t < trackParticles.size(); ++t)
+    {
+        const CTPResult &thisPID = pids.at(t);
         resultCol->push_back(thisPID);
-        auto const ptrMaker = art::PtrMaker<ctp::CTPResult>(evt);
         art::Ptr<ctp::CTPResult> ptrResult = ptrMaker(resultCol->size()-1);
-        art::Ptr<recob::Track> thisTrack = tracks.at(thisTrackID);
+        art::Ptr<recob::Track> thisTrack = tracks.at(trackIDs.at(t));
 
 //        std::cout << "Making association between track " << thisTrack.key() << " and PID result " << ptrResult.key() << std::endl;
 
@@ -202,14 +211,14 @@ void CTPEvaluator::produce(art::Event &evt)
             if (!thisPID.IsValid()) continue;
             int pdg = 0;
             if(!evt.isRealData()){
-                pdg = fConvTrackPID.GetTruePDGCode(particle,evt);
+                pdg = fConvTrackPID.GetTruePDGCode(trackParticles.at(t),evt);
             }
             std::cout << "Got a track PID for particle of type " << pdg << ": " << thisPID.GetMuonScore() << ", " << thisPID.GetPionScore() << ", " << thisPID.GetProtonScore() << std::endl;       
             fMuonScoreVector.push_back(thisPID.GetMuonScore());
             fPionScoreVector.push_back(thisPID.GetPionScore());
             fProtonScoreVector.push_back(thisPID.GetProtonScore());
             fPDGVector.push_back(pdg);
-            fCaloPoints.push_back(nCaloPoints);
+            fCaloPoints.push_back(caloPoints.at(t));
         }
     }
     if (fWriteTree) fPIDTree->Fill();
@@ -127,6 +127,8 @@ void CTPTrackDump::endJob()
 
 void CTPTrackDump::analyze(const art::Event &evt)
 {
+    // Reuse the association finders of the dune_ana utilities for the rest of this event
+    dune_ana::DUNEAnaAssocCache assocCache(evt);
 
     // Get all of the PFParticles
     const std::vector<art::Ptr<recob::PFParticle>> particles = dune_ana::DUNEAnaEventUtils::GetPFParticles(evt,fParticleLabel);
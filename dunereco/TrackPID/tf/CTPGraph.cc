@@ -15,7 +15,8 @@
 #include "tensorflow/core/public/session_options.h"
 
 // -------------------------------------------------------------------
-tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs)
+tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+                       int intra_op_threads, int inter_op_threads)
 {
 
 //    std::cout << "Starting to build the graph" << std::endl;
@@ -24,29 +25,12 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
     n_inputs = ninputs;
     n_outputs = noutputs;
 
-    // Force tf to only use a single core so it doesn't eat batch farms
-    tensorflow::SessionOptions options;
-    tensorflow::ConfigProto &config = options.config;
-    config.set_inter_op_parallelism_threads(1);
-    config.set_intra_op_parallelism_threads(1);
-    config.set_use_per_session_threads(false);
+    // Thread counts default to a single core so tf doesn't eat batch farms
+    fSharedSession = SessionPool::get(graph_file_name, intra_op_threads, inter_op_threads);
+    if (!fSharedSession) { return; }
+    fSession = fSharedSession->session;
 
-//    std::cout << "Starting tf session" << std::endl;
-    auto status = tensorflow::NewSession(options, &fSession);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
-//    std::cout << "Session started... reading network architecture" << std::endl;
-    tensorflow::GraphDef graph_def;
-    status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(), graph_file_name, &graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
+    const tensorflow::GraphDef & graph_def = *fSharedSession->graph_def;
 
 //    std::cout << "Extracting input names" << std::endl;
     size_t ng = graph_def.node().size();
@@ -100,15 +84,6 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
         return;
     }
 
-//    std::cout << "About to create graph" << std::endl;
-
-    status = fSession->Create(graph_def);
-    if (!status.ok())
-    {
-        std::cout << status.ToString() << std::endl;
-        return;
-    }
-
     success = true; // ok, graph loaded from the file
 
 //    std::cout << "Graph success? " << success << std::endl;
@@ -116,11 +91,7 @@ tf::CTPGraph::CTPGraph(const char* graph_file_name, const std::vector<std::strin
 
 tf::CTPGraph::~CTPGraph()
 {
-    auto status = fSession->Close();
-    if (!status.ok()) {
-      std::cout << "tf::CTPGraph::dtor: " << "Close failed." << std::endl;
-    }
-    delete fSession;
+    // the session is closed by the pool once its last user is gone
 }
 
 // -------------------------------------------------------------------
@@ -14,6 +14,8 @@
 #include <vector>
 #include <string>
 
+#include "dunereco/CVN/tf/tf_session_pool.h"
+
 namespace tensorflow
 {
     class Session;
@@ -29,10 +31,12 @@ public:
    int n_inputs = 1;
    int n_outputs = 1;
 
-   static std::unique_ptr<CTPGraph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1)
+   // the session is shared with every other graph object using the same file and thread counts
+   static std::unique_ptr<CTPGraph> create(const char* graph_file_name, const std::vector<std::string> & outputs = {}, int ninputs = 1, int noutputs = 1,
+                                           int intra_op_threads = 1, int inter_op_threads = 1)
     {
         bool success;
-        std::unique_ptr<CTPGraph> ptr(new CTPGraph(graph_file_name, outputs, success, ninputs, noutputs));
+        std::unique_ptr<CTPGraph> ptr(new CTPGraph(graph_file_name, outputs, success, ninputs, noutputs, intra_op_threads, inter_op_threads));
         if (success) { return ptr; }
         else { return nullptr; }
     }
@@ -49,8 +53,10 @@ public:
 
 private:
     /// Not-throwing constructor.
-    CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs);
+    CTPGraph(const char* graph_file_name, const std::vector<std::string> & outputs, bool & success, int ninputs, int noutputs,
+             int intra_op_threads, int inter_op_threads);
 
+    std::shared_ptr<SharedSession> fSharedSession;
     tensorflow::Session* fSession;
     //std::vector< std::string > fInputNames;
     std::vector< std::string > fInputNames;
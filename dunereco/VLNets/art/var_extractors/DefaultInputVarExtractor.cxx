@@ -1,5 +1,7 @@
 #include "DefaultInputVarExtractor.h"
 
+#include "dunereco/AnaUtils/DUNEAnaUtilsBase.h"
+
 namespace VLN {
 
 DefaultInputVarExtractor::DefaultInputVarExtractor(
@@ -29,6 +31,9 @@ void DefaultInputVarExtractor::extractVars(
     const art::Event &evt, VarDict &vars
 )
 {
+    // The particle variables look up the same associations for every particle
+    dune_ana::DUNEAnaAssocCache assocCache(evt);
+
     addrVarExtractor    .extract(evt, vars);
     recoVarExtractor    .extract(evt, vars);
     particleVarExtractor.extract(evt, vars);